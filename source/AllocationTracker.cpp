@@ -0,0 +1,204 @@
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace dae
+{
+	namespace
+	{
+		constexpr int AMOUNT_OF_PHASES{ static_cast<int>(AllocationTracker::Phase::Count) };
+
+		//constant initialized, operator new can run before any dynamic initializer
+		struct AtomicCounters
+		{
+			std::atomic<uint64_t> allocations{};
+			std::atomic<uint64_t> bytes{};
+		};
+
+		AtomicCounters g_Total{};
+		AtomicCounters g_Frame[AMOUNT_OF_PHASES]{};
+		std::atomic<int64_t> g_LiveAllocations{};
+		std::atomic<uint8_t> g_Phase{};
+
+		void Count(size_t size)
+		{
+			const int phase{ g_Phase.load(std::memory_order_relaxed) };
+
+			g_Total.allocations.fetch_add(1, std::memory_order_relaxed);
+			g_Total.bytes.fetch_add(size, std::memory_order_relaxed);
+			g_Frame[phase].allocations.fetch_add(1, std::memory_order_relaxed);
+			g_Frame[phase].bytes.fetch_add(size, std::memory_order_relaxed);
+			g_LiveAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void* Allocate(size_t size)
+		{
+			Count(size);
+			return std::malloc(size == 0 ? 1 : size);
+		}
+
+		void* AllocateAligned(size_t size, std::align_val_t alignment)
+		{
+			Count(size);
+
+			const size_t alignmentValue{ static_cast<size_t>(alignment) };
+#ifdef _WIN32
+			return _aligned_malloc(size == 0 ? 1 : size, alignmentValue);
+#else
+			//aligned_alloc wants a multiple of the alignment
+			const size_t alignedSize{ ((size == 0 ? 1 : size) + alignmentValue - 1) / alignmentValue * alignmentValue };
+			return std::aligned_alloc(alignmentValue, alignedSize);
+#endif
+		}
+
+		void Free(void* pMemory)
+		{
+			if (pMemory == nullptr) return;
+
+			g_LiveAllocations.fetch_sub(1, std::memory_order_relaxed);
+			std::free(pMemory);
+		}
+
+		void FreeAligned(void* pMemory)
+		{
+			if (pMemory == nullptr) return;
+
+			g_LiveAllocations.fetch_sub(1, std::memory_order_relaxed);
+#ifdef _WIN32
+			_aligned_free(pMemory);
+#else
+			std::free(pMemory);
+#endif
+		}
+	}
+
+	namespace AllocationTracker
+	{
+		const char* ToString(Phase phase)
+		{
+			switch (phase)
+			{
+			case Phase::Update:
+				return "update";
+			case Phase::Lights:
+				return "lights";
+			case Phase::Trace:
+				return "trace";
+			case Phase::Present:
+				return "present";
+			case Phase::Other:
+			default:
+				return "other";
+			}
+		}
+
+		Counters GetTotal()
+		{
+			return { g_Total.allocations.load(std::memory_order_relaxed), g_Total.bytes.load(std::memory_order_relaxed) };
+		}
+
+		int64_t GetLiveAllocations()
+		{
+			return g_LiveAllocations.load(std::memory_order_relaxed);
+		}
+
+		void BeginFrame()
+		{
+			for (AtomicCounters& counters : g_Frame)
+			{
+				counters.allocations.store(0, std::memory_order_relaxed);
+				counters.bytes.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		FrameReport EndFrame()
+		{
+			FrameReport report{};
+			for (int phase{}; phase < AMOUNT_OF_PHASES; ++phase)
+			{
+				report.phases[phase] = { g_Frame[phase].allocations.load(std::memory_order_relaxed), g_Frame[phase].bytes.load(std::memory_order_relaxed) };
+				report.total.allocations += report.phases[phase].allocations;
+				report.total.bytes += report.phases[phase].bytes;
+			}
+
+			return report;
+		}
+
+		ScopedPhase::ScopedPhase(Phase phase)
+			: m_PreviousPhase{ static_cast<Phase>(g_Phase.exchange(static_cast<uint8_t>(phase), std::memory_order_relaxed)) }
+		{
+		}
+
+		ScopedPhase::~ScopedPhase()
+		{
+			g_Phase.store(static_cast<uint8_t>(m_PreviousPhase), std::memory_order_relaxed);
+		}
+	}
+}
+
+#pragma region GLOBAL OPERATOR NEW AND DELETE
+//every replaceable form, so nothing reaches the default ones that would go uncounted
+void* operator new(size_t size)
+{
+	void* pMemory{ dae::Allocate(size) };
+	if (pMemory == nullptr) throw std::bad_alloc{};
+	return pMemory;
+}
+
+void* operator new[](size_t size)
+{
+	void* pMemory{ dae::Allocate(size) };
+	if (pMemory == nullptr) throw std::bad_alloc{};
+	return pMemory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return dae::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return dae::Allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* pMemory{ dae::AllocateAligned(size, alignment) };
+	if (pMemory == nullptr) throw std::bad_alloc{};
+	return pMemory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	void* pMemory{ dae::AllocateAligned(size, alignment) };
+	if (pMemory == nullptr) throw std::bad_alloc{};
+	return pMemory;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return dae::AllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return dae::AllocateAligned(size, alignment);
+}
+
+void operator delete(void* pMemory) noexcept { dae::Free(pMemory); }
+void operator delete[](void* pMemory) noexcept { dae::Free(pMemory); }
+void operator delete(void* pMemory, size_t) noexcept { dae::Free(pMemory); }
+void operator delete[](void* pMemory, size_t) noexcept { dae::Free(pMemory); }
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept { dae::Free(pMemory); }
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept { dae::Free(pMemory); }
+
+void operator delete(void* pMemory, std::align_val_t) noexcept { dae::FreeAligned(pMemory); }
+void operator delete[](void* pMemory, std::align_val_t) noexcept { dae::FreeAligned(pMemory); }
+void operator delete(void* pMemory, size_t, std::align_val_t) noexcept { dae::FreeAligned(pMemory); }
+void operator delete[](void* pMemory, size_t, std::align_val_t) noexcept { dae::FreeAligned(pMemory); }
+void operator delete(void* pMemory, std::align_val_t, const std::nothrow_t&) noexcept { dae::FreeAligned(pMemory); }
+void operator delete[](void* pMemory, std::align_val_t, const std::nothrow_t&) noexcept { dae::FreeAligned(pMemory); }
+#pragma endregion
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	//Counts every operator new of the program (AllocationTracker.cpp replaces the global ones), per frame and per phase of it
+	//The steady state frames of the renderer shouldn't allocate at all, main's allocation test mode fails when they do.
+	//Only the heap allocations of C++ code are counted, the ones of SDL and the OS go through malloc directly
+	namespace AllocationTracker
+	{
+		//Parts of a frame, set by whoever runs them (see ScopedPhase), allocations of any thread go to the current phase
+		enum class Phase : uint8_t
+		{
+			Other, //outside of a frame, or not in one of the phases below
+			Update, //scene update and async mesh loads
+			Lights, //light grid or light bvh build
+			Trace, //rays and shading of every pixel, on the render threads
+			Present, //packing the pixels and updating the window surface
+
+			Count
+		};
+
+		struct Counters
+		{
+			uint64_t allocations{};
+			uint64_t bytes{};
+		};
+
+		struct FrameReport
+		{
+			Counters phases[static_cast<int>(Phase::Count)]{};
+			Counters total{};
+		};
+
+		const char* ToString(Phase phase);
+
+		//since the program started
+		Counters GetTotal();
+		//allocated and not freed yet, comparing two of these brackets a leak check
+		int64_t GetLiveAllocations();
+
+		//Zeroes the counters of the frame, EndFrame returns what was allocated since
+		void BeginFrame();
+		FrameReport EndFrame();
+
+		//Sets the phase for its lifetime, nested phases restore the outer one
+		class ScopedPhase final
+		{
+		public:
+			explicit ScopedPhase(Phase phase);
+			~ScopedPhase();
+
+			ScopedPhase(const ScopedPhase&) = delete;
+			ScopedPhase(ScopedPhase&&) noexcept = delete;
+			ScopedPhase& operator=(const ScopedPhase&) = delete;
+			ScopedPhase& operator=(ScopedPhase&&) noexcept = delete;
+
+		private:
+			Phase m_PreviousPhase;
+		};
+	}
+}
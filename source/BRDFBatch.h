@@ -0,0 +1,400 @@
+#pragma once
+#include <cmath>
+#include "Math.h"
+#include "FastMath.h"
+#include "BRDFTables.h"
+
+namespace dae
+{
+	//8 floats fill one AVX register, every lane is one hit
+	constexpr int BATCH_WIDTH{ 8 };
+
+#pragma region SoA BATCH TYPES
+	struct alignas(32) Vector3Batch
+	{
+		float x[BATCH_WIDTH]{};
+		float y[BATCH_WIDTH]{};
+		float z[BATCH_WIDTH]{};
+
+		void Set(int lane, const Vector3& v)
+		{
+			x[lane] = v.x;
+			y[lane] = v.y;
+			z[lane] = v.z;
+		}
+
+		Vector3 Get(int lane) const
+		{
+			return { x[lane], y[lane], z[lane] };
+		}
+	};
+
+	struct alignas(32) ColorRGBBatch
+	{
+		float r[BATCH_WIDTH]{};
+		float g[BATCH_WIDTH]{};
+		float b[BATCH_WIDTH]{};
+
+		void Set(int lane, const ColorRGB& c)
+		{
+			r[lane] = c.r;
+			g[lane] = c.g;
+			b[lane] = c.b;
+		}
+
+		ColorRGB Get(int lane) const
+		{
+			return { r[lane], g[lane], b[lane] };
+		}
+	};
+
+	//Everything a BRDF needs for up to BATCH_WIDTH hits, filled lane by lane (see Material::SetBatchLane)
+	//view is the ray direction (pointing towards the surface) like the scalar Shade functions expect
+	struct alignas(32) ShadingBatch
+	{
+		Vector3Batch normal{};
+		Vector3Batch view{};
+		Vector3Batch toLight{};
+
+		ColorRGBBatch color{}; //solid color, diffuse color or albedo
+		float diffuseReflectance[BATCH_WIDTH]{};
+		float specularReflectance[BATCH_WIDTH]{};
+		float phongExponent[BATCH_WIDTH]{};
+		float metalness[BATCH_WIDTH]{};
+		float roughness[BATCH_WIDTH]{};
+		const CookTorranceTable* pCookTorranceTable[BATCH_WIDTH]{}; //only read by ShadingPrecision::Tabulated
+
+		int count{}; //used lanes, the rest is shaded as well but ignored
+	};
+#pragma endregion
+
+	//Batched versions of the BRDF functions, every loop runs over all lanes without branches so the compiler turns it into SIMD
+	//(needs AVX enabled for 8 wide, /arch:AVX2 on MSVC or -mavx2 -fno-math-errno on GCC/Clang, otherwise it becomes 2x SSE)
+	//Everything in here has internal linkage and only touches plain floats, the kernel translation units compile it once per instruction set (see Kernels.h)
+	namespace BRDF
+	{
+		namespace Batch
+		{
+			//same result as std::max, kept local so no inline function with external linkage gets compiled for a wider instruction set
+			static float Max(float a, float b)
+			{
+				return a < b ? b : a;
+			}
+
+			static void Dot(const Vector3Batch& v1, const Vector3Batch& v2, float* dot)
+			{
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					dot[lane] = v1.x[lane] * v2.x[lane] + v1.y[lane] * v2.y[lane] + v1.z[lane] * v2.z[lane];
+				}
+			}
+
+			static void ClampedDot(const Vector3Batch& v1, const Vector3Batch& v2, float* dot)
+			{
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					dot[lane] = Max(v1.x[lane] * v2.x[lane] + v1.y[lane] * v2.y[lane] + v1.z[lane] * v2.z[lane], 0.f);
+				}
+			}
+
+			//a / b per lane, the fast version multiplies with the refined reciprocal estimate
+			template<ShadingPrecision precision>
+			static void Divide(const float* a, const float* b, float* result)
+			{
+				if constexpr (precision == ShadingPrecision::Fast)
+				{
+					alignas(32) float reciprocal[BATCH_WIDTH];
+					FastMath::Reciprocal(b, reciprocal, BATCH_WIDTH);
+
+					for (int lane{}; lane < BATCH_WIDTH; ++lane)
+					{
+						result[lane] = a[lane] * reciprocal[lane];
+					}
+				}
+				else
+				{
+					for (int lane{}; lane < BATCH_WIDTH; ++lane)
+					{
+						result[lane] = a[lane] / b[lane];
+					}
+				}
+			}
+
+			static void Lambert(const float* kd, const ColorRGBBatch& cd, ColorRGBBatch& result)
+			{
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					result.r[lane] = kd[lane] * cd.r[lane] / static_cast<float>(M_PI);
+					result.g[lane] = kd[lane] * cd.g[lane] / static_cast<float>(M_PI);
+					result.b[lane] = kd[lane] * cd.b[lane] / static_cast<float>(M_PI);
+				}
+			}
+
+			static void Lambert(const ColorRGBBatch& kd, const ColorRGBBatch& cd, ColorRGBBatch& result)
+			{
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					result.r[lane] = kd.r[lane] * cd.r[lane] / static_cast<float>(M_PI);
+					result.g[lane] = kd.g[lane] * cd.g[lane] / static_cast<float>(M_PI);
+					result.b[lane] = kd.b[lane] * cd.b[lane] / static_cast<float>(M_PI);
+				}
+			}
+
+			//v points away from the surface (same as the scalar Phong), the specular term is grey so it is returned as one float per lane
+			template<ShadingPrecision precision>
+			static void Phong(const float* ks, const float* exp, const Vector3Batch& l, const Vector3Batch& v, const Vector3Batch& n, float* result)
+			{
+				alignas(32) float nDotL[BATCH_WIDTH];
+				ClampedDot(n, l, nDotL);
+
+				alignas(32) float reflectDotV[BATCH_WIDTH];
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					const float reflectScale{ 2 * nDotL[lane] };
+					reflectDotV[lane] = Max((reflectScale * n.x[lane] - l.x[lane]) * v.x[lane]
+										   + (reflectScale * n.y[lane] - l.y[lane]) * v.y[lane]
+										   + (reflectScale * n.z[lane] - l.z[lane]) * v.z[lane], 0.f);
+				}
+
+				//no vector powf, the exact loop stays scalar, the fast pow is plain arithmetic and vectorizes
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					result[lane] = ks[lane] * FastMath::Pow<precision>(reflectDotV[lane], exp[lane]);
+				}
+			}
+
+			static void FresnelFunction_Schlick(const float* hDotV, const ColorRGBBatch& f0, ColorRGBBatch& result)
+			{
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					const float oneMinusHDotV{ 1 - hDotV[lane] };
+					const float oneMinusHDotV5{ oneMinusHDotV * oneMinusHDotV * oneMinusHDotV * oneMinusHDotV * oneMinusHDotV };
+
+					result.r[lane] = f0.r[lane] + (1.f - f0.r[lane]) * oneMinusHDotV5;
+					result.g[lane] = f0.g[lane] + (1.f - f0.g[lane]) * oneMinusHDotV5;
+					result.b[lane] = f0.b[lane] + (1.f - f0.b[lane]) * oneMinusHDotV5;
+				}
+			}
+
+			template<ShadingPrecision precision>
+			static void NormalDistribution_GGX(const float* nDotH, const float* roughness, float* result)
+			{
+				alignas(32) float alpha2[BATCH_WIDTH];
+				alignas(32) float denominator[BATCH_WIDTH];
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					alpha2[lane] = roughness[lane] * roughness[lane] * roughness[lane] * roughness[lane];
+					const float base{ nDotH[lane] * nDotH[lane] * (alpha2[lane] - 1) + 1 };
+
+					denominator[lane] = static_cast<float>(M_PI) * (base * base);
+				}
+
+				Divide<precision>(alpha2, denominator, result);
+			}
+
+			template<ShadingPrecision precision>
+			static void GeometryFunction_Smith(const float* nDotV, const float* nDotL, const float* roughness, float* result)
+			{
+				alignas(32) float clampedNDotV[BATCH_WIDTH];
+				alignas(32) float clampedNDotL[BATCH_WIDTH];
+				alignas(32) float denominatorV[BATCH_WIDTH];
+				alignas(32) float denominatorL[BATCH_WIDTH];
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					const float k{ (roughness[lane] * roughness[lane] + 1) * (roughness[lane] * roughness[lane] + 1) / 8 };
+
+					clampedNDotV[lane] = Max(nDotV[lane], 0.f);
+					clampedNDotL[lane] = Max(nDotL[lane], 0.f);
+					denominatorV[lane] = clampedNDotV[lane] * (1 - k) + k;
+					denominatorL[lane] = clampedNDotL[lane] * (1 - k) + k;
+				}
+
+				alignas(32) float geometryV[BATCH_WIDTH];
+				alignas(32) float geometryL[BATCH_WIDTH];
+				Divide<precision>(clampedNDotV, denominatorV, geometryV);
+				Divide<precision>(clampedNDotL, denominatorL, geometryL);
+
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					result[lane] = geometryV[lane] * geometryL[lane];
+				}
+			}
+
+			//Table versions, every used lane reads the table of its own material, the unused ones have none and are set to 0
+			static void NormalDistribution_GGX(const float* nDotH, const CookTorranceTable* const* pTables, int count, float* result)
+			{
+				for (int lane{}; lane < count; ++lane)
+				{
+					result[lane] = Tables::NormalDistribution_GGX(*pTables[lane], nDotH[lane]);
+				}
+
+				for (int lane{ count }; lane < BATCH_WIDTH; ++lane) result[lane] = 0.f;
+			}
+
+			static void GeometryFunction_Smith(const float* nDotV, const float* nDotL, const CookTorranceTable* const* pTables, int count, float* result)
+			{
+				for (int lane{}; lane < count; ++lane)
+				{
+					result[lane] = Tables::GeometryFunction_SchlickGGX(*pTables[lane], Max(nDotV[lane], 0.f))
+								 * Tables::GeometryFunction_SchlickGGX(*pTables[lane], Max(nDotL[lane], 0.f));
+				}
+
+				for (int lane{ count }; lane < BATCH_WIDTH; ++lane) result[lane] = 0.f;
+			}
+
+			//Full Cook-Torrance (same math as Material_CookTorrence::Shade), every dot product is computed once per lane
+			template<ShadingPrecision precision>
+			static void CookTorrence(const ShadingBatch& batch, ColorRGBBatch& result)
+			{
+				Vector3Batch toView{};
+				Vector3Batch halfVector{};
+				alignas(32) float sqrLength[BATCH_WIDTH];
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					toView.x[lane] = -batch.view.x[lane];
+					toView.y[lane] = -batch.view.y[lane];
+					toView.z[lane] = -batch.view.z[lane];
+
+					halfVector.x[lane] = toView.x[lane] + batch.toLight.x[lane];
+					halfVector.y[lane] = toView.y[lane] + batch.toLight.y[lane];
+					halfVector.z[lane] = toView.z[lane] + batch.toLight.z[lane];
+					sqrLength[lane] = halfVector.x[lane] * halfVector.x[lane] + halfVector.y[lane] * halfVector.y[lane] + halfVector.z[lane] * halfVector.z[lane];
+				}
+
+				if constexpr (precision == ShadingPrecision::Fast)
+				{
+					alignas(32) float inverseLength[BATCH_WIDTH];
+					FastMath::Rsqrt(sqrLength, inverseLength, BATCH_WIDTH);
+
+					for (int lane{}; lane < BATCH_WIDTH; ++lane)
+					{
+						halfVector.x[lane] *= inverseLength[lane];
+						halfVector.y[lane] *= inverseLength[lane];
+						halfVector.z[lane] *= inverseLength[lane];
+					}
+				}
+				else
+				{
+					for (int lane{}; lane < BATCH_WIDTH; ++lane)
+					{
+						const float length{ sqrtf(sqrLength[lane]) };
+
+						halfVector.x[lane] /= length;
+						halfVector.y[lane] /= length;
+						halfVector.z[lane] /= length;
+					}
+				}
+
+				alignas(32) float nDotV[BATCH_WIDTH];
+				alignas(32) float nDotL[BATCH_WIDTH];
+				alignas(32) float nDotH[BATCH_WIDTH];
+				alignas(32) float hDotV[BATCH_WIDTH];
+				Dot(batch.normal, toView, nDotV);
+				Dot(batch.normal, batch.toLight, nDotL);
+				ClampedDot(batch.normal, halfVector, nDotH);
+				ClampedDot(halfVector, toView, hDotV);
+
+				//dielectrics use a fixed base reflectivity of 0.04
+				ColorRGBBatch f0{};
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					const bool isDielectric{ batch.metalness[lane] == 0.f };
+					f0.r[lane] = isDielectric ? 0.04f : batch.color.r[lane];
+					f0.g[lane] = isDielectric ? 0.04f : batch.color.g[lane];
+					f0.b[lane] = isDielectric ? 0.04f : batch.color.b[lane];
+				}
+
+				ColorRGBBatch fresnel{};
+				alignas(32) float normalDistribution[BATCH_WIDTH];
+				alignas(32) float geometry[BATCH_WIDTH];
+				FresnelFunction_Schlick(hDotV, f0, fresnel);
+				if constexpr (precision == ShadingPrecision::Tabulated)
+				{
+					NormalDistribution_GGX(nDotH, batch.pCookTorranceTable, batch.count, normalDistribution);
+					GeometryFunction_Smith(nDotV, nDotL, batch.pCookTorranceTable, batch.count, geometry);
+				}
+				else
+				{
+					NormalDistribution_GGX<precision>(nDotH, batch.roughness, normalDistribution);
+					GeometryFunction_Smith<precision>(nDotV, nDotL, batch.roughness, geometry);
+				}
+
+				ColorRGBBatch kd{};
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					const bool isDielectric{ batch.metalness[lane] == 0.f };
+					kd.r[lane] = isDielectric ? 1.f - fresnel.r[lane] : 0.f;
+					kd.g[lane] = isDielectric ? 1.f - fresnel.g[lane] : 0.f;
+					kd.b[lane] = isDielectric ? 1.f - fresnel.b[lane] : 0.f;
+				}
+
+				Lambert(kd, batch.color, result);
+
+				alignas(32) float specularDenominator[BATCH_WIDTH];
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					specularDenominator[lane] = 4 * (nDotV[lane] * nDotL[lane]);
+				}
+
+				if constexpr (precision == ShadingPrecision::Fast)
+				{
+					alignas(32) float inverseDenominator[BATCH_WIDTH];
+					FastMath::Reciprocal(specularDenominator, inverseDenominator, BATCH_WIDTH);
+
+					for (int lane{}; lane < BATCH_WIDTH; ++lane)
+					{
+						result.r[lane] += fresnel.r[lane] * normalDistribution[lane] * geometry[lane] * inverseDenominator[lane];
+						result.g[lane] += fresnel.g[lane] * normalDistribution[lane] * geometry[lane] * inverseDenominator[lane];
+						result.b[lane] += fresnel.b[lane] * normalDistribution[lane] * geometry[lane] * inverseDenominator[lane];
+					}
+				}
+				else
+				{
+					for (int lane{}; lane < BATCH_WIDTH; ++lane)
+					{
+						result.r[lane] += fresnel.r[lane] * normalDistribution[lane] * geometry[lane] / specularDenominator[lane];
+						result.g[lane] += fresnel.g[lane] * normalDistribution[lane] * geometry[lane] / specularDenominator[lane];
+						result.b[lane] += fresnel.b[lane] * normalDistribution[lane] * geometry[lane] / specularDenominator[lane];
+					}
+				}
+			}
+
+#pragma region MATERIALS
+			//One function per MaterialType, the Material classes forward to these
+			//(the precision only changes LambertPhong and CookTorrence, the other two have nothing to approximate, the tables only CookTorrence)
+			static void SolidColor(const ShadingBatch& batch, ColorRGBBatch& result)
+			{
+				result = batch.color;
+			}
+
+			static void Lambert(const ShadingBatch& batch, ColorRGBBatch& result)
+			{
+				Lambert(batch.diffuseReflectance, batch.color, result);
+			}
+
+			template<ShadingPrecision precision>
+			static void LambertPhong(const ShadingBatch& batch, ColorRGBBatch& result)
+			{
+				Vector3Batch toView{};
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					toView.x[lane] = -batch.view.x[lane];
+					toView.y[lane] = -batch.view.y[lane];
+					toView.z[lane] = -batch.view.z[lane];
+				}
+
+				alignas(32) float specular[BATCH_WIDTH];
+				Phong<precision>(batch.specularReflectance, batch.phongExponent, batch.toLight, toView, batch.normal, specular);
+				Lambert(batch.diffuseReflectance, batch.color, result);
+
+				for (int lane{}; lane < BATCH_WIDTH; ++lane)
+				{
+					result.r[lane] += specular[lane];
+					result.g[lane] += specular[lane];
+					result.b[lane] += specular[lane];
+				}
+			}
+#pragma endregion
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#include "BRDFTables.h"
+
+#include <deque>
+#include <vector>
+
+namespace dae
+{
+	namespace
+	{
+		struct CachedTable
+		{
+			CookTorranceTable table{};
+			std::vector<float> values{}; //normal distribution followed by visibility, never resized after the build
+		};
+
+		//deque so the tables handed out don't move when a new one is added
+		std::deque<CachedTable> g_CachedTables{};
+		int g_Resolution{ BRDF::Tables::DEFAULT_RESOLUTION };
+
+		//Filled in double precision so the tables only add the interpolation error, same formulas as BRDFs.h (UE4, alpha = roughness^2)
+		void Build(CachedTable& cachedTable, float roughness, int resolution)
+		{
+			constexpr double pi{ 3.14159265358979323846 };
+			const int amountOfEntries{ resolution + 1 };
+			cachedTable.values.resize(2 * static_cast<size_t>(amountOfEntries));
+
+			const double alpha2{ static_cast<double>(roughness) * roughness * roughness * roughness };
+			const double k{ (static_cast<double>(roughness) * roughness + 1) * (static_cast<double>(roughness) * roughness + 1) / 8 };
+
+			float* pNormalDistribution{ cachedTable.values.data() };
+			float* pVisibility{ pNormalDistribution + amountOfEntries };
+			for (int index{}; index < amountOfEntries; ++index)
+			{
+				const double position{ static_cast<double>(index) / resolution };
+
+				//position = (1 - Dot(n, h)^2)^(1/4)
+				const double sinSquared{ position * position * position * position };
+				const double denominator{ (1 - sinSquared) * (alpha2 - 1) + 1 };
+				pNormalDistribution[index] = static_cast<float>(alpha2 / (pi * denominator * denominator));
+
+				//position = Dot(n, v)
+				pVisibility[index] = static_cast<float>(1 / (position * (1 - k) + k));
+			}
+
+			cachedTable.table.roughness = roughness;
+			cachedTable.table.resolution = resolution;
+			cachedTable.table.pNormalDistribution = pNormalDistribution;
+			cachedTable.table.pVisibility = pVisibility;
+		}
+	}
+
+	namespace BRDF
+	{
+		namespace Tables
+		{
+			const CookTorranceTable* Get(float roughness)
+			{
+				//a scene has a handful of roughness values, a linear search is enough
+				for (const CachedTable& cachedTable : g_CachedTables)
+				{
+					if (cachedTable.table.roughness == roughness && cachedTable.table.resolution == g_Resolution) return &cachedTable.table;
+				}
+
+				CachedTable& cachedTable{ g_CachedTables.emplace_back() };
+				Build(cachedTable, roughness, g_Resolution);
+				return &cachedTable.table;
+			}
+
+			void SetResolution(int resolution)
+			{
+				g_Resolution = resolution < 1 ? 1 : resolution;
+			}
+
+			int GetResolution()
+			{
+				return g_Resolution;
+			}
+		}
+	}
+}
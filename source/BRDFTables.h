@@ -0,0 +1,65 @@
+#pragma once
+#include <cmath>
+
+namespace dae
+{
+	//GGX and Smith (Schlick-GGX) of one roughness value sampled at resolution + 1 evenly spaced points, read back with linear interpolation
+	//Built once per roughness and resolution (see BRDF::Tables::Get), the materials keep a pointer to it
+	struct CookTorranceTable
+	{
+		float roughness{};
+		int resolution{};
+		const float* pNormalDistribution{}; //GGX over (1 - Dot(n, h)^2)^(1/4), a smooth surface's peak is too narrow for even steps in Dot(n, h)
+		const float* pVisibility{}; //Schlick-GGX divided by Dot(n, v), over Dot(n, v) (smooth down to 0, unlike the term itself)
+	};
+
+	namespace BRDF
+	{
+		//Lookup tables for the GGX normal distribution and the Schlick-GGX geometry term, an opt-in alternative to the analytic
+		//versions (ShadingPrecision::Tabulated)
+		//Max relative error against double precision for a resolution of 256, GGX: 4.3e-3 for roughness 0.1, 4.5e-4 for 0.3, 1.1e-4 for 0.6
+		//and Schlick-GGX: 1.8e-4 for every roughness. Doubling the resolution divides the error by about 4, below roughness 0.1 it grows fast
+		//(5 times as much for 0.05), the peak gets narrower than the steps
+		namespace Tables
+		{
+			constexpr int DEFAULT_RESOLUTION{ 256 };
+
+			//Table for this roughness at the current resolution, built on the first call and cached after that
+			//The returned table stays valid until the program ends, not thread safe (materials are created on the main thread)
+			const CookTorranceTable* Get(float roughness);
+
+			//Resolution of the tables built from now on, the ones already handed out keep theirs (2 * (resolution + 1) floats per table)
+			void SetResolution(int resolution);
+			int GetResolution();
+
+#pragma region LOOKUP
+			//Internal linkage and plain floats only, the kernel translation units compile these once per instruction set (see Kernels.h),
+			//inline so the translation units that include this without shading with the tables build without unused function warnings
+
+			//Linear interpolation between the two entries around position * resolution, position in [0, 1]
+			static inline float Lookup(const float* pValues, int resolution, float position)
+			{
+				const float scaled{ position * static_cast<float>(resolution) };
+				int index{ static_cast<int>(scaled) };
+				index = index < resolution - 1 ? index : resolution - 1;
+				const float fraction{ scaled - static_cast<float>(index) };
+
+				return pValues[index] + (pValues[index + 1] - pValues[index]) * fraction;
+			}
+
+			//GGX with the clamped Dot(n, h) already computed by the caller
+			static inline float NormalDistribution_GGX(const CookTorranceTable& table, float nDotH)
+			{
+				const float sinSquared{ 1.f - nDotH * nDotH };
+				return Lookup(table.pNormalDistribution, table.resolution, sqrtf(sqrtf(sinSquared < 0.f ? 0.f : sinSquared)));
+			}
+
+			//Schlick-GGX with the clamped Dot(n, v) already computed by the caller
+			static inline float GeometryFunction_SchlickGGX(const CookTorranceTable& table, float nDotV)
+			{
+				return nDotV * Lookup(table.pVisibility, table.resolution, nDotV);
+			}
+#pragma endregion
+		}
+	}
+}
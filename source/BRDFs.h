@@ -1,6 +1,7 @@
 #pragma once
 #include <cassert>
 #include "Math.h"
+#include "FastMath.h"
 
 namespace dae
 {
@@ -11,12 +12,12 @@ namespace dae
 		 * \param cd Diffuse Color
 		 * \return Lambert Diffuse Color
 		 */
-		static ColorRGB Lambert(float kd, const ColorRGB& cd)
+		inline ColorRGB Lambert(float kd, const ColorRGB& cd)
 		{
 			return{ kd * cd / static_cast<float>(M_PI) };
 		}
 
-		static ColorRGB Lambert(const ColorRGB& kd, const ColorRGB& cd)
+		inline ColorRGB Lambert(const ColorRGB& kd, const ColorRGB& cd)
 		{
 			return { kd * cd / static_cast<float>(M_PI) };
 		}
@@ -30,9 +31,19 @@ namespace dae
 		 * \param n Normal of the Surface
 		 * \return Phong Specular Color
 		 */
-		static ColorRGB Phong(float ks, float exp, const Vector3& l, const Vector3& v, const Vector3& n)
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
+		inline ColorRGB Phong(float ks, float exp, const Vector3& l, const Vector3& v, const Vector3& n)
 		{
-			return { ColorRGB{1.f, 1.f, 1.f} * ks * powf(std::max(Vector3::Dot(2 * std::max(Vector3::Dot(n,l), 0.f) * n - l, v), 0.f), exp) };
+			return { ColorRGB{1.f, 1.f, 1.f} * ks * FastMath::Pow<precision>(std::max(Vector3::Dot(2 * std::max(Vector3::Dot(n,l), 0.f) * n - l, v), 0.f), exp) };
+		}
+
+		//Fresnel with the clamped Dot(h, v) already computed by the caller
+		inline ColorRGB FresnelFunction_Schlick(float hDotV, const ColorRGB& f0)
+		{
+			const float oneMinusHDotV{ 1 - hDotV };
+			const float oneMinusHDotV5{ oneMinusHDotV * oneMinusHDotV * oneMinusHDotV * oneMinusHDotV * oneMinusHDotV };
+
+			return { f0 + (ColorRGB{1.f,1.f,1.f} - f0) * oneMinusHDotV5 };
 		}
 
 		/**
@@ -42,14 +53,19 @@ namespace dae
 		 * \param f0 Base reflectivity of a surface based on IOR (Indices Of Refrection), this is different for Dielectrics (Non-Metal) and Conductors (Metal)
 		 * \return
 		 */
-		static ColorRGB FresnelFunction_Schlick(const Vector3& h, const Vector3& v, const ColorRGB& f0)
+		inline ColorRGB FresnelFunction_Schlick(const Vector3& h, const Vector3& v, const ColorRGB& f0)
 		{
-			return { f0 + ( ColorRGB{1.f,1.f,1.f} - f0) *
-					(1 - std::max(Vector3::Dot(h, v), 0.f)) *
-					(1 - std::max(Vector3::Dot(h, v), 0.f)) *
-					(1 - std::max(Vector3::Dot(h, v), 0.f)) *
-					(1 - std::max(Vector3::Dot(h, v), 0.f)) *
-					(1 - std::max(Vector3::Dot(h, v), 0.f))   };
+			return FresnelFunction_Schlick(std::max(Vector3::Dot(h, v), 0.f), f0);
+		}
+
+		//GGX with the clamped Dot(n, h) already computed by the caller
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
+		inline float NormalDistribution_GGX(float nDotH, float roughness)
+		{
+			const float alpha2{ roughness * roughness * roughness * roughness };
+			const float denominator{ nDotH * nDotH * (alpha2 - 1) + 1 };
+
+			return FastMath::Divide<precision>(alpha2, static_cast<float>(M_PI) * (denominator * denominator));
 		}
 
 		/**
@@ -59,18 +75,19 @@ namespace dae
 		 * \param roughness Roughness of the material
 		 * \return BRDF Normal Distribution Term using Trowbridge-Reitz GGX
 		 */
-		static float NormalDistribution_GGX(const Vector3& n, const Vector3& h, float roughness)
+		inline float NormalDistribution_GGX(const Vector3& n, const Vector3& h, float roughness)
 		{
-			return roughness * roughness * roughness * roughness / 
-				   ( static_cast<float>(M_PI) * 
-				   ( (std::max(Vector3::Dot(n,h), 0.f) *
-				   std::max(Vector3::Dot(n,h), 0.f) *
-				   (roughness * roughness * roughness * roughness - 1) + 1) *
-				   (std::max(Vector3::Dot(n,h), 0.f) *
-				   std::max(Vector3::Dot(n,h), 0.f) *
-				   (roughness * roughness * roughness * roughness - 1) + 1) ) );
+			return NormalDistribution_GGX(std::max(Vector3::Dot(n, h), 0.f), roughness);
 		}
 
+		//SchlickGGX with the clamped Dot(n, v) already computed by the caller
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
+		inline float GeometryFunction_SchlickGGX(float nDotV, float roughness)
+		{
+			const float k{ (roughness * roughness + 1) * (roughness * roughness + 1) / 8 };
+
+			return { FastMath::Divide<precision>(nDotV, nDotV * (1 - k) + k) };
+		}
 
 		/**
 		 * \brief BRDF Geometry Function >> Schlick GGX (Direct Lighting + UE4 implementation - squared(roughness))
@@ -79,9 +96,9 @@ namespace dae
 		 * \param roughness Roughness of the material
 		 * \return BRDF Geometry Term using SchlickGGX
 		 */
-		static float GeometryFunction_SchlickGGX(const Vector3& n, const Vector3& v, float roughness)
+		inline float GeometryFunction_SchlickGGX(const Vector3& n, const Vector3& v, float roughness)
 		{
-			return { std::max(Vector3::Dot(n, v), 0.f) / (std::max(Vector3::Dot(n, v), 0.f) * (1 - (roughness * roughness + 1) * (roughness * roughness + 1) / 8) + (roughness * roughness + 1) * (roughness * roughness + 1) / 8) };
+			return GeometryFunction_SchlickGGX(std::max(Vector3::Dot(n, v), 0.f), roughness);
 		}
 
 		/**
@@ -92,7 +109,7 @@ namespace dae
 		 * \param roughness Roughness of the material
 		 * \return BRDF Geometry Term using Smith (> SchlickGGX(n,v,roughness) * SchlickGGX(n,l,roughness))
 		 */
-		static float GeometryFunction_Smith(const Vector3& n, const Vector3& v, const Vector3& l, float roughness)
+		inline float GeometryFunction_Smith(const Vector3& n, const Vector3& v, const Vector3& l, float roughness)
 		{
 			return {GeometryFunction_SchlickGGX(n, v, roughness) * GeometryFunction_SchlickGGX(n, l, roughness)};
 		}
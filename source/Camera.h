@@ -33,19 +33,13 @@ namespace dae
 		float totalPitch{0.f};
 		float totalYaw{0.f};
 
-		Matrix cameraToWorld{};
+		AffineMatrix cameraToWorld{}; //transforms every primary ray, so the affine SIMD version
 
-		Matrix CalculateCameraToWorld()
+		AffineMatrix CalculateCameraToWorld()
 		{
 			const Vector3 right{ Vector3::Cross(up, forward).Normalized() };
 			const Vector3 up{ Vector3::Cross(forward, right).Normalized() };
-			cameraToWorld =
-			{
-				{right, 0},
-				{up, 0},
-				{forward, 0},
-				{origin, 1}
-			};
+			cameraToWorld = AffineMatrix{ Matrix{ right, up, forward, origin } };
 			return cameraToWorld;
 		}
 
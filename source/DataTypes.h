@@ -1,6 +1,14 @@
 #pragma once
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "Math.h"
+#include "MeshCompression.h"
 
 namespace dae
 {
@@ -12,6 +20,13 @@ namespace dae
 		cookTorrence
 	};
 
+	enum class BVHNodeState
+	{
+		Unsplit, //lazy bvh: node has not been reached by a ray yet
+		Splitting,
+		Built
+	};
+
 	struct BVHNode
 	{
 		Vector3 AABBMin;
@@ -19,16 +34,127 @@ namespace dae
 		int leftChildIndex; //rightChildIndex = leftChildIndex + 1
 		int firstMeshIndex;
 		int amountOfMeshes;
+		BVHNodeState state; //only used when the bvh is built lazily
 	};
 
+	//For trees read from a file: every child index stays inside the tree and points further down it (so traversal can't loop),
+	//every leaf range inside [0, amountOfLeafItems)
+	inline bool AreBVHNodesValid(const std::vector<BVHNode>& nodes, int amountOfLeafItems)
+	{
+		const int amountOfNodes{ static_cast<int>(nodes.size()) };
+		for (int nodeIndex{}; nodeIndex < amountOfNodes; ++nodeIndex)
+		{
+			const BVHNode& node{ nodes[nodeIndex] };
+			if (node.amountOfMeshes < 0) return false;
+
+			if (node.amountOfMeshes == 0)
+			{
+				if (node.leftChildIndex <= nodeIndex || node.leftChildIndex >= amountOfNodes - 1) return false;
+			}
+			else if (node.leftChildIndex < 0 || node.amountOfMeshes > amountOfLeafItems - node.leftChildIndex)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 #pragma region GEOMETRY
-	struct Sphere
+	//Widest kernel register in floats, the sphere arrays are padded to a multiple of it (see Kernels.h)
+	constexpr int SPHERE_PADDING{ 16 };
+
+	//All spheres of a scene as separate arrays so the kernels load the centers of a whole register of spheres at once,
+	//the float arrays are padded to a multiple of SPHERE_PADDING with spheres no ray can hit (negative infinite squared radius)
+	struct SphereGeometries
 	{
-		Vector3 origin{};
-		float radius{};
+		std::vector<float> centerX{};
+		std::vector<float> centerY{};
+		std::vector<float> centerZ{};
+		std::vector<float> squaredRadius{};
+		std::vector<uint16_t> materialId{};
+
+		int Size() const { return static_cast<int>(materialId.size()); }
+
+		void Push(const Vector3& center, float radius, uint16_t sphereMaterialId)
+		{
+			const size_t index{ materialId.size() };
+			materialId.push_back(sphereMaterialId);
+
+			const size_t paddedSize{ (materialId.size() + SPHERE_PADDING - 1) / SPHERE_PADDING * SPHERE_PADDING };
+			centerX.resize(paddedSize, 0.f);
+			centerY.resize(paddedSize, 0.f);
+			centerZ.resize(paddedSize, 0.f);
+			squaredRadius.resize(paddedSize, -INFINITY);
+
+			centerX[index] = center.x;
+			centerY[index] = center.y;
+			centerZ[index] = center.z;
+			squaredRadius[index] = radius * radius;
+		}
+
+		Vector3 GetCenter(int index) const { return { centerX[index], centerY[index], centerZ[index] }; }
+	};
+
+	//Extra entries at the end of the triangle arrays, a register load starting at the last triangle stays inside them (see Kernels.h)
+	constexpr int TRIANGLE_PADDING{ 16 };
+
+	//Transformed vertices and normals of a mesh in triangle order as separate arrays, so the kernels load the triangles of a bvh leaf
+	//straight into registers instead of gathering them through the indices, the padding is zero (never hit, the kernels mask it)
+	struct PackedTriangles
+	{
+		std::vector<float> vertexX[3]{}; //[vertex][triangle]
+		std::vector<float> vertexY[3]{};
+		std::vector<float> vertexZ[3]{};
+		std::vector<float> normalX{};
+		std::vector<float> normalY{};
+		std::vector<float> normalZ{};
+
+		void Resize(int amountOfTriangles)
+		{
+			const size_t paddedSize{ static_cast<size_t>(amountOfTriangles) + TRIANGLE_PADDING };
+			for (int vertex{}; vertex < 3; ++vertex)
+			{
+				vertexX[vertex].resize(paddedSize, 0.f);
+				vertexY[vertex].resize(paddedSize, 0.f);
+				vertexZ[vertex].resize(paddedSize, 0.f);
+			}
+			normalX.resize(paddedSize, 0.f);
+			normalY.resize(paddedSize, 0.f);
+			normalZ.resize(paddedSize, 0.f);
+		}
+
+		//Copies triangles [first, first + count), triangle i uses indices[i * 3] to indices[i * 3 + 2] and normals[i]
+		void Pack(const std::vector<Vector3>& positions, const std::vector<int>& indices, const std::vector<Vector3>& normals, int first, int count)
+		{
+			const int end{ first + count };
+			for (int triangle{ first }; triangle < end; ++triangle)
+			{
+				for (int vertex{}; vertex < 3; ++vertex)
+				{
+					const Vector3& position{ positions[indices[triangle * 3 + vertex]] };
+					vertexX[vertex][triangle] = position.x;
+					vertexY[vertex][triangle] = position.y;
+					vertexZ[vertex][triangle] = position.z;
+				}
+
+				normalX[triangle] = normals[triangle].x;
+				normalY[triangle] = normals[triangle].y;
+				normalZ[triangle] = normals[triangle].z;
+			}
+		}
+	};
 
-		unsigned char materialIndex{ 0 };
-		MaterialType materialType{};
+	//Object space attributes of a compressed mesh (see TriangleMesh::Compress), 13 bytes per triangle of a closed mesh with 16 bit
+	//indices (19 with 32 bit ones) instead of about 96 for the float attributes, their transformed and their packed copies
+	//The kernels decode what they test (see MeshCompression.h), there are no float copies
+	struct CompressedTriangles
+	{
+		std::vector<uint16_t> positions{}; //x, y and z of every vertex, quantized over the object space AABB of the mesh
+		std::vector<uint16_t> normals{}; //2 per triangle, octahedral
+		std::vector<uint8_t> indices{}; //indexWidth bytes per index
+		int indexWidth{}; //1, 2 or 4, the narrowest that fits every vertex index
+		TriangleDecoder decoder{};
 	};
 
 	struct Plane
@@ -36,8 +162,7 @@ namespace dae
 		Vector3 origin{};
 		Vector3 normal{};
 
-		unsigned char materialIndex{ 0 };
-		MaterialType materialType{};
+		uint16_t materialId{ 0 };
 	};
 
 	enum class TriangleCullMode
@@ -68,8 +193,7 @@ namespace dae
 		Vector3 normal{};
 
 		TriangleCullMode cullMode{};
-		unsigned char materialIndex{};
-		MaterialType materialType{};
+		uint16_t materialId{};
 	};
 
 	struct AABB
@@ -110,11 +234,9 @@ namespace dae
 		}
 
 		std::vector<Vector3> positions{};
-		std::vector<Vector3> centroids{};
 		std::vector<Vector3> normals{};
 		std::vector<int> indices{};
-		unsigned char materialIndex{};
-		MaterialType materialType{};
+		uint16_t materialId{};
 
 		TriangleCullMode cullMode{TriangleCullMode::BackFaceCulling};
 
@@ -131,9 +253,17 @@ namespace dae
 		std::vector<Vector3> transformedPositions{};
 		std::vector<Vector3> transformedNormals{};
 
+		PackedTriangles packedTriangles{}; //follows transformedPositions, transformedNormals and the triangle order of the bvh
+
+		CompressedTriangles compressedTriangles{};
+		bool compressed{ false }; //set by Compress, every float attribute above is empty from then on
+		bool compressOnLoad{ false }; //Utils::LoadTriangleMeshCached compresses the mesh once it is loaded
+
 		std::vector<BVHNode> bvhNodes;
 		int rootNodeIndex{ 0 }, amountOfUsedNodes{ 1 };
 		bool useBVH{ true };
+		bool lazyBVH{ false }; //only split bvh nodes the first time a ray reaches them, for meshes that are neither cached nor compressed
+		int bvhLeafSize{ 1 }; //triangles the leaf kernel tests at the cost of one (Kernels::Table::triangleLeafSize), the build fills leaves up to it
 
 		void Translate(const Vector3& translation)
 		{
@@ -152,6 +282,8 @@ namespace dae
 
 		void AppendTriangle(const Triangle& triangle, bool ignoreTransformUpdate = false)
 		{
+			assert(!compressed && "a compressed mesh can't be appended to");
+
 			int v0Index{ -1 };
 			int v1Index{ -1 };
 			int v2Index{ -1 };
@@ -181,7 +313,7 @@ namespace dae
 			}
 			else
 			{
-				int newIndex{ static_cast<int>(indices.size()) };
+				int newIndex{ static_cast<int>(positions.size()) };
 				indices.push_back(newIndex);
 				positions.push_back(triangle.v0);
 			}
@@ -192,7 +324,7 @@ namespace dae
 			}
 			else
 			{
-				int newIndex{ static_cast<int>(indices.size()) };
+				int newIndex{ static_cast<int>(positions.size()) };
 				indices.push_back(newIndex);
 				positions.push_back(triangle.v1);
 			}
@@ -203,7 +335,7 @@ namespace dae
 			}
 			else
 			{
-				int newIndex{ static_cast<int>(indices.size()) };
+				int newIndex{ static_cast<int>(positions.size()) };
 				indices.push_back(newIndex);
 				positions.push_back(triangle.v2);
 			}
@@ -215,6 +347,78 @@ namespace dae
 				UpdateTransforms();
 		}
 
+		//Bulk version of AppendTriangle: vertices (also the ones already in the mesh) closer than weldEpsilon are merged through a spatial hash,
+		//weldEpsilon 0 only merges identical positions. The AABB and transforms are updated once at the end, (re)build the bvh afterwards
+		void AppendTriangles(const std::vector<Triangle>& triangles, float weldEpsilon = 0.f)
+		{
+			assert(!compressed && "a compressed mesh can't be appended to");
+
+			//cells are weldEpsilon wide so a match is always in the same or a neighbouring cell
+			const bool exactWeld{ weldEpsilon <= 0.f };
+			const double cellSize{ exactWeld ? 1.0 : static_cast<double>(weldEpsilon) };
+			const float sqrWeldEpsilon{ weldEpsilon * weldEpsilon };
+			const int neighbourRange{ exactWeld ? 0 : 1 };
+
+			const auto toCell = [cellSize](float value) -> int64_t
+			{
+				return static_cast<int64_t>(std::clamp(std::floor(value / cellSize), -1e15, 1e15));
+			};
+
+			const auto hashCell = [](int64_t x, int64_t y, int64_t z) -> uint64_t
+			{
+				return static_cast<uint64_t>(x) * 73856093ull ^ static_cast<uint64_t>(y) * 19349663ull ^ static_cast<uint64_t>(z) * 83492791ull;
+			};
+
+			std::unordered_multimap<uint64_t, int> vertexGrid{};
+			vertexGrid.reserve(positions.size() + triangles.size() * 3);
+
+			const int amountOfPositions{ static_cast<int>(positions.size()) };
+			for (int index{}; index < amountOfPositions; ++index)
+			{
+				const Vector3& position{ positions[index] };
+				vertexGrid.emplace(hashCell(toCell(position.x), toCell(position.y), toCell(position.z)), index);
+			}
+
+			const auto findOrAddVertex = [&](const Vector3& position) -> int
+			{
+				const int64_t cellX{ toCell(position.x) };
+				const int64_t cellY{ toCell(position.y) };
+				const int64_t cellZ{ toCell(position.z) };
+
+				for (int z{ -neighbourRange }; z <= neighbourRange; ++z)
+				for (int y{ -neighbourRange }; y <= neighbourRange; ++y)
+				for (int x{ -neighbourRange }; x <= neighbourRange; ++x)
+				{
+					const auto range{ vertexGrid.equal_range(hashCell(cellX + x, cellY + y, cellZ + z)) };
+					for (auto it{ range.first }; it != range.second; ++it)
+					{
+						const Vector3& candidate{ positions[it->second] };
+						if (exactWeld ? candidate == position : (candidate - position).SqrMagnitude() <= sqrWeldEpsilon) return it->second;
+					}
+				}
+
+				const int newIndex{ static_cast<int>(positions.size()) };
+				positions.push_back(position);
+				vertexGrid.emplace(hashCell(cellX, cellY, cellZ), newIndex);
+				return newIndex;
+			};
+
+			indices.reserve(indices.size() + triangles.size() * 3);
+			normals.reserve(normals.size() + triangles.size());
+
+			for (const Triangle& triangle : triangles)
+			{
+				indices.push_back(findOrAddVertex(triangle.v0));
+				indices.push_back(findOrAddVertex(triangle.v1));
+				indices.push_back(findOrAddVertex(triangle.v2));
+
+				normals.push_back(triangle.normal);
+			}
+
+			UpdateAABB();
+			UpdateTransforms();
+		}
+
 		void CalculateNormals()
 		{
 			const size_t amountOfIndices{ indices.size()};
@@ -233,11 +437,24 @@ namespace dae
 			}
 		}
 
+		Matrix GetFinalTransform() const
+		{
+			return scaleTransform * rotationTransform * translationTransform;
+		}
+
 		void UpdateTransforms()
 		{
 			//Calculate Final Transform 
 			//const auto finalTransform = ...
-			const auto finalTransform = scaleTransform * rotationTransform * translationTransform;
+			const auto finalTransform = GetFinalTransform();
+
+			if (compressed)
+			{
+				UpdateTransformedAABB(finalTransform);
+				UpdateDecoder(finalTransform);
+				return;
+			}
+
 			//Transform Positions (positions > transformedPositions)
 			//...
 			transformedPositions.resize(0);
@@ -245,9 +462,9 @@ namespace dae
 			for(size_t index{}; index < amountOfPositions; ++index)
 			{
 				transformedPositions.emplace_back(finalTransform.TransformPoint(positions[index]));
-
-				UpdateTransformedAABB(finalTransform);
 			}
+
+			UpdateTransformedAABB(finalTransform);
 			//Transform Normals (normals > transformedNormals)
 			//...
 			transformedNormals.resize(0);
@@ -256,6 +473,104 @@ namespace dae
 			{
 				transformedNormals.emplace_back(finalTransform.TransformVector(normals[index]).Normalized());
 			}
+
+			PackTriangles();
+		}
+
+		//the quantization step of every axis goes into the columns, a coordinate of 0 decodes to minAABB
+		void UpdateDecoder(const Matrix& finalTransform)
+		{
+			TriangleDecoder& decoder{ compressedTriangles.decoder };
+			const Vector3 extent{ maxAABB - minAABB };
+			const Vector3 origin{ finalTransform.TransformPoint(minAABB) };
+
+			for (int axis{}; axis < 3; ++axis)
+			{
+				for (int column{}; column < 3; ++column)
+				{
+					decoder.position[axis][column] = finalTransform[column][axis] * (extent[column] / MeshCompression::QUANTIZATION_STEPS);
+					decoder.normal[axis][column] = finalTransform[column][axis];
+				}
+				decoder.position[axis][3] = origin[axis];
+			}
+		}
+
+		//Replaces positions, normals, indices and their transformed and packed copies by 16 bit positions, octahedral normals and
+		//indices of the narrowest width. Decoded positions are off by up to 1/131070 of the AABB (shared vertices stay shared, so
+		//the mesh stays watertight). Needs the complete bvh (not lazy), it can't be appended to or rebuilt afterwards
+		void Compress()
+		{
+			assert(!lazyBVH && "the bvh has to be complete, splits reorder the triangles");
+			if (compressed) return;
+
+			CompressedTriangles& target{ compressedTriangles };
+			const Vector3 extent{ maxAABB - minAABB };
+
+			target.positions.resize(positions.size() * 3);
+			for (size_t index{}; index < positions.size(); ++index)
+			{
+				for (int axis{}; axis < 3; ++axis)
+				{
+					target.positions[index * 3 + axis] = MeshCompression::QuantizeCoordinate(positions[index][axis], minAABB[axis], extent[axis]);
+				}
+			}
+
+			target.normals.resize(normals.size() * 2);
+			for (size_t index{}; index < normals.size(); ++index)
+			{
+				MeshCompression::EncodeNormal(normals[index].x, normals[index].y, normals[index].z, &target.normals[index * 2]);
+			}
+
+			target.indexWidth = positions.size() <= 0x100 ? 1 : (positions.size() <= 0x10000 ? 2 : 4);
+			target.indices.resize(indices.size() * target.indexWidth);
+			for (size_t slot{}; slot < indices.size(); ++slot)
+			{
+				const uint32_t index{ static_cast<uint32_t>(indices[slot]) };
+				std::memcpy(&target.indices[slot * target.indexWidth], &index, target.indexWidth); //little endian
+			}
+
+			//move assignment frees the memory, clear() would keep it
+			positions = std::vector<Vector3>{};
+			normals = std::vector<Vector3>{};
+			indices = std::vector<int>{};
+			transformedPositions = std::vector<Vector3>{};
+			transformedNormals = std::vector<Vector3>{};
+			packedTriangles = PackedTriangles{};
+
+			compressed = true;
+			UpdateTransforms();
+		}
+
+		int GetAmountOfTriangles() const
+		{
+			return compressed ? static_cast<int>(compressedTriangles.normals.size() / 2) : static_cast<int>(indices.size() / 3);
+		}
+
+		Vector3 GetTransformedPosition(int triangle, int vertex) const
+		{
+			if (!compressed) return transformedPositions[indices[triangle * 3 + vertex]];
+
+			const CompressedTriangles& source{ compressedTriangles };
+			Vector3 position{};
+			const uint32_t index{ MeshCompression::ReadIndex(source.indices.data(), source.indexWidth, triangle * 3 + vertex) };
+			MeshCompression::DecodePosition(source.decoder, source.positions.data(), index, position.x, position.y, position.z);
+			return position;
+		}
+
+		Vector3 GetTransformedNormal(int triangle) const
+		{
+			if (!compressed) return transformedNormals[triangle];
+
+			Vector3 normal{};
+			MeshCompression::DecodeNormal(compressedTriangles.decoder, compressedTriangles.normals.data(), triangle, normal.x, normal.y, normal.z);
+			return normal.Normalized();
+		}
+
+		void PackTriangles()
+		{
+			const int amountOfTriangles{ static_cast<int>(indices.size()) / 3 };
+			packedTriangles.Resize(amountOfTriangles);
+			packedTriangles.Pack(transformedPositions, indices, transformedNormals, 0, amountOfTriangles);
 		}
 
 		void UpdateAABB()
@@ -322,6 +637,8 @@ namespace dae
 		//source for bvh: https://jacco.ompf2.com/2022/04/13/how-to-build-a-bvh-part-1-basics/
 		void BuildBVH()
 		{
+			assert(!compressed && "a compressed mesh keeps the tree it was compressed with");
+
 			int amountOfTriangles{ static_cast<int>(indices.size()) / 3 };
 
 			bvhNodes.reserve(amountOfTriangles * 2 - 1);
@@ -336,8 +653,40 @@ namespace dae
 			bvhNodes[rootNodeIndex].amountOfMeshes = amountOfTriangles;
 
 			UpdateNodeBounds(rootNodeIndex);
+
+			//lazy: the root stays unsplit, nodes get subdivided during traversal (see ExpandLazyNode)
+			if (lazyBVH) return;
+
 			//subdivide recursively
 			Subdivide(rootNodeIndex);
+
+			//the splits reordered the triangles
+			PackTriangles();
+		}
+
+		//Called from the (multithreaded) traversal when lazyBVH is on, the first thread to reach an unsplit node splits it one level.
+		//The release store of Built publishes the children (and the triangles the split reordered) to every thread that loads it
+		//with acquire, threads reaching the node while it is split wait for that
+		void ExpandLazyNode(int nodeIndex) const
+		{
+			//the mesh is only logically const during traversal, splitting a node does not change what a ray hits
+			TriangleMesh& mesh{ const_cast<TriangleMesh&>(*this) };
+			std::atomic_ref<BVHNodeState> state{ mesh.bvhNodes[nodeIndex].state };
+
+			if (state.load(std::memory_order_acquire) == BVHNodeState::Built) return;
+
+			BVHNodeState expected{ BVHNodeState::Unsplit };
+			if (state.compare_exchange_strong(expected, BVHNodeState::Splitting, std::memory_order_acquire))
+			{
+				mesh.Subdivide(nodeIndex, false);
+				state.store(BVHNodeState::Built, std::memory_order_release);
+				return;
+			}
+
+			while (state.load(std::memory_order_acquire) != BVHNodeState::Built)
+			{
+				std::this_thread::yield();
+			}
 		}
 
 		void UpdateNodeBounds(int nodeIndex)
@@ -346,17 +695,19 @@ namespace dae
 			node.AABBMin = { INFINITY, INFINITY, INFINITY };
 			node.AABBMax = { -INFINITY, -INFINITY, -INFINITY };
 
-			int start{ node.leftChildIndex * 3 };
-			int end{ start + node.amountOfMeshes * 3 };
-			
-			for (int index{ start }; index < end; ++index)
+			const int end{ node.leftChildIndex + node.amountOfMeshes };
+			for (int triangle{ node.leftChildIndex }; triangle < end; ++triangle)
 			{
-				node.AABBMin = Vector3::Min(node.AABBMin, transformedPositions[indices[index]]);
-				node.AABBMax = Vector3::Max(node.AABBMax, transformedPositions[indices[index]]);
+				for (int vertex{}; vertex < 3; ++vertex)
+				{
+					const Vector3 position{ GetTransformedPosition(triangle, vertex) };
+					node.AABBMin = Vector3::Min(node.AABBMin, position);
+					node.AABBMax = Vector3::Max(node.AABBMax, position);
+				}
 			}
 		}
 
-		void Subdivide(int nodeIndex)
+		void Subdivide(int nodeIndex, bool recurse = true)
 		{
 			BVHNode& node{ bvhNodes[nodeIndex] };
 
@@ -390,7 +741,7 @@ namespace dae
 
 			const Vector3 extentParent{ node.AABBMax - node.AABBMin };
 			const float areaParent{ extentParent.x * extentParent.y + extentParent.y * extentParent.z + extentParent.z * extentParent.x };
-			const float costParent{ node.amountOfMeshes * areaParent };
+			const float costParent{ GetLeafCost(node.amountOfMeshes) * areaParent };
 
 			if (bestCost >= costParent) return;
 
@@ -399,12 +750,14 @@ namespace dae
 
 			SortPrimitives(left, right, bestAxis, bestPos);
 
+			//a lazy split happens after the triangles were packed, the children read the new order (BuildBVH packs everything at the end)
+			if (!recurse) packedTriangles.Pack(transformedPositions, indices, transformedNormals, node.leftChildIndex, node.amountOfMeshes);
+
 			int leftCount{ left - node.leftChildIndex };
 			if (leftCount == 0 || leftCount == node.amountOfMeshes) return;
 
-			//create child nodes
-			int leftChildIndex{ amountOfUsedNodes };
-			amountOfUsedNodes += 2;
+			//create child nodes (atomic because lazy splits run on the render threads, the slots were reserved by BuildBVH)
+			const int leftChildIndex{ std::atomic_ref<int>{ amountOfUsedNodes }.fetch_add(2, std::memory_order_relaxed) };
 			bvhNodes[leftChildIndex].leftChildIndex = node.leftChildIndex;
 			bvhNodes[leftChildIndex].amountOfMeshes = leftCount;
 			bvhNodes[leftChildIndex + 1].leftChildIndex = left; //leftChildIndex + 1 == rightChildIndex (rightChildIndex is not saved in the node)
@@ -416,6 +769,8 @@ namespace dae
 			UpdateNodeBounds(leftChildIndex);
 			UpdateNodeBounds(leftChildIndex + 1);
 
+			if (!recurse) return;
+
 			//recurse
 			Subdivide(leftChildIndex);
 			Subdivide(leftChildIndex + 1);
@@ -455,10 +810,16 @@ namespace dae
 					rightBox.Grow(transformedPositions[indices[triangleIndex * 3 + 2]]);
 				}
 			}
-			float cost{ leftCount * leftBox.Area() + rightCount * rightBox.Area() };
+			float cost{ GetLeafCost(leftCount) * leftBox.Area() + GetLeafCost(rightCount) * rightBox.Area() };
 			return cost > 0 ? cost : INFINITY;
 		}
 
+		//a leaf is tested bvhLeafSize triangles at a time, so up to that many cost the same as one
+		float GetLeafCost(int amountOfTriangles) const
+		{
+			return static_cast<float>((amountOfTriangles + bvhLeafSize - 1) / bvhLeafSize);
+		}
+
 		void SortPrimitives(int& left, int right, int axis, float splitPosition)
 		{
 			while (left <= right)
@@ -485,7 +846,10 @@ namespace dae
 
 		void RefitBVH()
 		{
-			for (int index{ amountOfUsedNodes - 1 }; index >= 0; --index) if(index != 1)
+			if (bvhNodes.empty()) return;
+
+			//children are always stored after their parent, so this visits them first (node 1 is the left child of the root)
+			for (int index{ amountOfUsedNodes - 1 }; index >= 0; --index)
 			{
 				BVHNode& node{ bvhNodes[index] };
 				if (node.amountOfMeshes != 0)
@@ -515,6 +879,7 @@ namespace dae
 		Vector3 direction{};
 		ColorRGB color{};
 		float intensity{};
+		float radius{ FLT_MAX }; //point lights only, beyond this distance the light has no influence (fades out towards it)
 
 		LightType type{};
 	};
@@ -529,6 +894,68 @@ namespace dae
 		float max{ FLT_MAX };
 	};
 
+	//Ray plus the constants every traversal kernel needs, built once per ray before traversal
+	//the kernel constants are SIMD lanes {x, y, z, 0} so the slab and triangle tests work on whole registers
+	struct PreparedRay : Ray
+	{
+		explicit PreparedRay(const Ray& ray) :
+			Ray{ ray },
+			originLanes{ ray.origin }
+		{
+			const float direction[3]{ ray.direction.x, ray.direction.y, ray.direction.z };
+			const float inverse[3]{ 1.f / direction[0], 1.f / direction[1], 1.f / direction[2] };
+
+			inverseDirection = { inverse[0], inverse[1], inverse[2], 0.f };
+			signMask = Float4::Less(Float4{ ray.direction }, Float4{});
+
+			//dominant axis of the direction becomes z, swapping x and y keeps the winding when it points backwards
+			const float absX{ std::abs(direction[0]) };
+			const float absY{ std::abs(direction[1]) };
+			const float absZ{ std::abs(direction[2]) };
+			const int kz{ absX > absY ? (absX > absZ ? 0 : 2) : (absY > absZ ? 1 : 2) };
+			int kx{ kz == 2 ? 0 : kz + 1 };
+			int ky{ kx == 2 ? 0 : kx + 1 };
+			if (direction[kz] < 0) std::swap(kx, ky);
+
+			//permutation and shear as a 3x3 matrix, so the triangle test needs no per axis indexing
+			float shear[3][3]{}; //[row][column]
+			shear[0][kx] = 1.f;
+			shear[0][kz] = -direction[kx] * inverse[kz];
+			shear[1][ky] = 1.f;
+			shear[1][kz] = -direction[ky] * inverse[kz];
+			shear[2][kz] = inverse[kz];
+
+			shearX = { shear[0][0], shear[1][0], shear[2][0], 0.f };
+			shearY = { shear[0][1], shear[1][1], shear[2][1], 0.f };
+			shearZ = { shear[0][2], shear[1][2], shear[2][2], 0.f };
+		}
+
+		//point relative to the ray origin in ray space, the ray runs along +z through {0, 0, 0}
+		Float4 ToRaySpace(const Vector3& point) const
+		{
+			const Float4 relative{ Float4{ point } - originLanes };
+			return shearX * relative.SplatX() + shearY * relative.SplatY() + shearZ * relative.SplatZ();
+		}
+
+		Float4 originLanes{};
+		Float4 inverseDirection{};
+		Float4 signMask{}; //set in the axes where the direction is negative, selects the near slab of {min, max} without branching
+
+		//columns of the shear of the watertight triangle test (Woop et al. 2013)
+		Float4 shearX{};
+		Float4 shearY{};
+		Float4 shearZ{};
+	};
+
+	enum class PrimitiveType : uint8_t
+	{
+		None,
+		Sphere,
+		Plane,
+		TriangleMesh,
+		StreamedMesh
+	};
+
 	struct HitRecord
 	{
 		Vector3 origin{};
@@ -536,8 +963,15 @@ namespace dae
 		float t = FLT_MAX;
 
 		bool didHit{ false };
-		unsigned char materialIndex{ 0 };
-		MaterialType materialType;
+		uint16_t materialId{ 0 }; //index in the scene's material table
+
+		//The closest-hit tests only write t and the fields below, origin, normal, materialId and didHit
+		//are filled in once for the final hit after traversal (see Scene::GetClosestHit)
+		PrimitiveType primitiveType{ PrimitiveType::None };
+		uint32_t primitiveIndex{}; //index in the scene's sphere, plane, triangle mesh or streamed mesh list
+		uint32_t triangleIndex{}; //triangle within the mesh
+		float beta{}; //barycentrics of triangle hits
+		float gamma{};
 	};
 #pragma endregion
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include "SIMD.h"
+
+namespace dae
+{
+	//Exact uses sqrtf, powf and plain divides, Fast the approximations in FastMath, Tabulated reads GGX and Schlick-GGX from the
+	//per roughness lookup tables in BRDFTables.h and is exact otherwise (opt-in, see Renderer::CycleShadingPrecision)
+	enum class ShadingPrecision
+	{
+		Exact,
+		Fast,
+		Tabulated
+	};
+
+	//Approximations for the shading math, the errors are the largest ones measured against double precision over the given range
+	//Everything has internal linkage and only touches plain floats, the kernel translation units compile it once per instruction set (see Kernels.h)
+	namespace FastMath
+	{
+#pragma region APPROXIMATIONS
+		//1 / sqrt(x) for normal positive x, hardware estimate (12 bits) refined with one Newton-Raphson step
+		//max relative error 3.0e-7 (sqrtf plus a divide: 9.0e-8)
+		static float Rsqrt(float x)
+		{
+#if DAE_SIMD_SSE
+			const float estimate{ _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x))) };
+#else
+			//bit trick estimate without sse, two steps, max relative error 4.7e-6
+			uint32_t bits{};
+			std::memcpy(&bits, &x, sizeof(bits));
+			bits = 0x5F375A86u - (bits >> 1);
+			float estimate{};
+			std::memcpy(&estimate, &bits, sizeof(estimate));
+			estimate = estimate * (1.5f - 0.5f * x * estimate * estimate);
+#endif
+			return estimate * (1.5f - 0.5f * x * estimate * estimate);
+		}
+
+		//1 / x for |x| < 2^126 (so the result is normal), hardware estimate (12 bits) refined with one Newton-Raphson step
+		//max relative error 2.0e-7
+		static float Reciprocal(float x)
+		{
+#if DAE_SIMD_SSE
+			const float estimate{ _mm_cvtss_f32(_mm_rcp_ss(_mm_set_ss(x))) };
+			return estimate * (2.f - x * estimate);
+#else
+			return 1.f / x; //no estimate instruction to start from
+#endif
+		}
+
+		//2^x, polynomial on the fraction and the integer part written into the exponent
+		//max relative error 2.8e-6 for x in [-126, 127.5), below that the result stays at 2^-126 or more instead of going to 0 (|x| < 2^22)
+		static float Exp2(float x)
+		{
+			//adding 1.5 * 2^23 rounds x to the nearest integer and leaves it in the low mantissa bits, no conversions or branches
+			//so the loops over it vectorize
+			constexpr float roundingShift{ 12582912.f };
+			const float shifted{ x + roundingShift };
+			const float fraction{ x - (shifted - roundingShift) }; //[-0.5, 0.5]
+
+			uint32_t shiftedBits{};
+			std::memcpy(&shiftedBits, &shifted, sizeof(shiftedBits));
+			int exponent{ static_cast<int>(shiftedBits) - 0x4B400000 };
+
+			const float polynomial
+			{
+				0.999999191f + fraction * (0.693121968f + fraction * (0.240249811f + fraction * (0.0559170392f + fraction * 0.00956051021f)))
+			};
+
+			//clamped to the normal exponents, on the integer so the compiler doesn't split the function on the range of x
+			exponent = exponent < -126 ? -126 : exponent;
+			exponent = exponent > 127 ? 127 : exponent;
+
+			const uint32_t exponentBits{ static_cast<uint32_t>(exponent + 127) << 23 };
+			float scale{};
+			std::memcpy(&scale, &exponentBits, sizeof(scale));
+
+			return polynomial * scale;
+		}
+
+		//log2(x) for normal positive x, the exponent bits plus a polynomial on the mantissa
+		//max absolute error 2.5e-6 for x in [0.5, 2), max relative error 2.4e-6 outside of it, 0 and denormals return about -127
+		static float Log2(float x)
+		{
+			uint32_t bits{};
+			std::memcpy(&bits, &x, sizeof(bits));
+
+			const float exponent{ static_cast<float>(static_cast<int>(bits >> 23 & 0xFFu) - 127) };
+
+			const uint32_t mantissaBits{ (bits & 0x007FFFFFu) | 0x3F800000u };
+			float mantissa{};
+			std::memcpy(&mantissa, &mantissaBits, sizeof(mantissa));
+
+			//log2(1 + t) = t * p(t), t in [0, 1)
+			const float t{ mantissa - 1.f };
+			const float polynomial
+			{
+				1.44253478f + t * (-0.718033608f + t * (0.457158199f + t * (-0.277341799f + t * (0.121473086f + t * -0.0257923914f))))
+			};
+
+			return exponent + t * polynomial;
+		}
+
+		//Rsqrt and Reciprocal of count values (a multiple of 4), 4 at a time with the packed estimates, the same results as one by one
+		//(the scalar versions call intrinsics the compiler can't vectorize, the batched BRDFs use these instead)
+		static void Rsqrt(const float* pValues, float* pResults, int count)
+		{
+#if DAE_SIMD_SSE
+			const __m128 half{ _mm_set1_ps(0.5f) };
+			const __m128 threeHalves{ _mm_set1_ps(1.5f) };
+			for (int index{}; index < count; index += 4)
+			{
+				const __m128 x{ _mm_loadu_ps(pValues + index) };
+				const __m128 estimate{ _mm_rsqrt_ps(x) };
+				const __m128 correction{ _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(half, x), estimate), estimate)) };
+				_mm_storeu_ps(pResults + index, _mm_mul_ps(estimate, correction));
+			}
+#else
+			for (int index{}; index < count; ++index) pResults[index] = Rsqrt(pValues[index]);
+#endif
+		}
+
+		static void Reciprocal(const float* pValues, float* pResults, int count)
+		{
+#if DAE_SIMD_SSE
+			const __m128 two{ _mm_set1_ps(2.f) };
+			for (int index{}; index < count; index += 4)
+			{
+				const __m128 x{ _mm_loadu_ps(pValues + index) };
+				const __m128 estimate{ _mm_rcp_ps(x) };
+				_mm_storeu_ps(pResults + index, _mm_mul_ps(estimate, _mm_sub_ps(two, _mm_mul_ps(x, estimate))));
+			}
+#else
+			for (int index{}; index < count; ++index) pResults[index] = Reciprocal(pValues[index]);
+#endif
+		}
+
+		//x^y for x in [0, 1] and y in [0, 256] (the phong lobe), 2^(y * log2(x))
+		//max relative error 6.5e-6 for y = 1, 1.1e-4 for y = 60 and 3.6e-4 for y = 256, the error of Log2 gets multiplied by y
+		//0^y returns at most 1e-38 instead of 0
+		static float Pow(float x, float y)
+		{
+			return Exp2(y * Log2(x));
+		}
+#pragma endregion
+
+#pragma region PRECISION SELECTION
+		//The exact or the fast version, picked at compile time by the templated BRDFs and materials
+		template<ShadingPrecision precision>
+		static float Divide(float a, float b)
+		{
+			if constexpr (precision == ShadingPrecision::Fast) return a * Reciprocal(b);
+			else return a / b;
+		}
+
+		template<ShadingPrecision precision>
+		static float Pow(float x, float y)
+		{
+			if constexpr (precision == ShadingPrecision::Fast) return Pow(x, y);
+			else return powf(x, y);
+		}
+
+		template<ShadingPrecision precision>
+		static Vector3 Normalized(const Vector3& v)
+		{
+			if constexpr (precision == ShadingPrecision::Fast) return v * Rsqrt(Vector3::Dot(v, v));
+			else return v.Normalized();
+		}
+#pragma endregion
+	}
+}
@@ -0,0 +1,292 @@
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "Kernels.h"
+#include "BRDFBatch.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace Kernels
+	{
+#pragma region CPU FEATURES
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		static void GetCpuId(int leaf, int subLeaf, uint32_t registers[4])
+		{
+			int values[4]{};
+			__cpuidex(values, leaf, subLeaf);
+			for (int index{}; index < 4; ++index) registers[index] = static_cast<uint32_t>(values[index]);
+		}
+
+		static uint64_t GetEnabledXSaveFeatures()
+		{
+			return _xgetbv(0);
+		}
+#elif defined(__x86_64__) || defined(__i386__)
+		static void GetCpuId(int leaf, int subLeaf, uint32_t registers[4])
+		{
+			__cpuid_count(leaf, subLeaf, registers[0], registers[1], registers[2], registers[3]);
+		}
+
+		static uint64_t GetEnabledXSaveFeatures()
+		{
+			uint32_t low{}, high{};
+			__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return (static_cast<uint64_t>(high) << 32) | low;
+		}
+#endif
+
+		InstructionSet GetSupportedInstructionSet()
+		{
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || defined(__x86_64__) || defined(__i386__)
+			uint32_t leaf0[4]{};
+			GetCpuId(0, 0, leaf0);
+			const uint32_t highestLeaf{ leaf0[0] };
+			if (highestLeaf < 7) return InstructionSet::Baseline;
+
+			uint32_t leaf1[4]{}; //eax, ebx, ecx, edx
+			uint32_t leaf7[4]{};
+			GetCpuId(1, 0, leaf1);
+			GetCpuId(7, 0, leaf7);
+
+			const auto hasBit{ [](uint32_t value, int bit) { return (value >> bit & 1u) != 0; } };
+
+			//the os has to save the wider registers on a context switch, xgetbv tells which ones it does
+			const bool hasOsXSave{ hasBit(leaf1[2], 27) };
+			if (!hasOsXSave) return InstructionSet::Baseline;
+			const uint64_t xSaveFeatures{ GetEnabledXSaveFeatures() };
+
+			const bool osSavesYmm{ (xSaveFeatures & 0x6) == 0x6 }; //xmm and ymm
+			const bool osSavesZmm{ (xSaveFeatures & 0xE6) == 0xE6 }; //plus opmask and both zmm halves
+
+			const bool hasAVX{ hasBit(leaf1[2], 28) };
+			const bool hasAVX2{ hasBit(leaf7[1], 5) };
+			const bool hasAVX512{ hasBit(leaf7[1], 16) && hasBit(leaf7[1], 17) && hasBit(leaf7[1], 28) && hasBit(leaf7[1], 30) && hasBit(leaf7[1], 31) }; //F, DQ, CD, BW, VL
+
+			if (hasAVX && hasAVX2 && hasAVX512 && osSavesZmm) return InstructionSet::AVX512;
+			if (hasAVX && hasAVX2 && osSavesYmm) return InstructionSet::AVX2;
+#endif
+			return InstructionSet::Baseline;
+		}
+
+		InstructionSet GetSelectedInstructionSet()
+		{
+			const InstructionSet supported{ GetSupportedInstructionSet() };
+
+#if defined(_MSC_VER)
+#pragma warning(suppress : 4996) //getenv is fine here, it is only read once at startup
+#endif
+			const char* pOverride{ std::getenv("RAYTRACER_KERNELS") };
+			if (!pOverride) return supported;
+
+			InstructionSet requested{ supported };
+			if (std::strcmp(pOverride, "baseline") == 0) requested = InstructionSet::Baseline;
+			else if (std::strcmp(pOverride, "avx2") == 0) requested = InstructionSet::AVX2;
+			else if (std::strcmp(pOverride, "avx512") == 0) requested = InstructionSet::AVX512;
+
+			//never more than the cpu can run
+			return static_cast<int>(requested) < static_cast<int>(supported) ? requested : supported;
+		}
+
+		const char* ToString(InstructionSet instructionSet)
+		{
+			switch (instructionSet)
+			{
+			case InstructionSet::AVX2:
+				return "AVX2";
+			case InstructionSet::AVX512:
+				return "AVX-512";
+			default:
+				return "Baseline (SSE2)";
+			}
+		}
+
+		const Table& Get()
+		{
+			static const Table& table
+			{
+				[]() -> const Table&
+				{
+					switch (GetSelectedInstructionSet())
+					{
+					case InstructionSet::AVX512:
+						return GetAVX512Table();
+					case InstructionSet::AVX2:
+						return GetAVX2Table();
+					default:
+						return GetBaselineTable();
+					}
+				}()
+			};
+
+			return table;
+		}
+#pragma endregion
+
+#pragma region BASELINE
+		//The scalar and Float4 code the rest of the project uses, one element after the other
+		static int ClosestHitSpheres(const SphereList& spheres, const Ray& ray, float& t)
+		{
+			HitRecord hitRecord{};
+			hitRecord.t = t;
+
+			int closest{ -1 };
+			for (int index{}; index < spheres.count; ++index)
+			{
+				const Vector3 center{ spheres.pCenterX[index], spheres.pCenterY[index], spheres.pCenterZ[index] };
+				if (GeometryUtils::HitTest_Sphere(center, spheres.pSquaredRadius[index], ray, hitRecord)) closest = index;
+			}
+
+			t = hitRecord.t;
+			return closest;
+		}
+
+		static bool AnyHitSpheres(const SphereList& spheres, const Ray& ray)
+		{
+			for (int index{}; index < spheres.count; ++index)
+			{
+				const Vector3 center{ spheres.pCenterX[index], spheres.pCenterY[index], spheres.pCenterZ[index] };
+				if (GeometryUtils::HitTest_Sphere(center, spheres.pSquaredRadius[index], ray)) return true;
+			}
+
+			return false;
+		}
+
+		static void GetTriangle(const TriangleList& triangles, int index, Triangle& triangle)
+		{
+			if (triangles.pQuantizedPositions != nullptr)
+			{
+				Vector3* pVertices[3]{ &triangle.v0, &triangle.v1, &triangle.v2 };
+				for (int vertex{}; vertex < 3; ++vertex)
+				{
+					const uint32_t vertexIndex{ MeshCompression::ReadIndex(triangles.pCompressedIndices, triangles.indexWidth, index * 3 + vertex) };
+					MeshCompression::DecodePosition(*triangles.pDecoder, triangles.pQuantizedPositions, vertexIndex, pVertices[vertex]->x, pVertices[vertex]->y, pVertices[vertex]->z);
+				}
+
+				//only used for culling, the length doesn't matter
+				MeshCompression::DecodeNormal(*triangles.pDecoder, triangles.pEncodedNormals, index, triangle.normal.x, triangle.normal.y, triangle.normal.z);
+				return;
+			}
+
+			//streamed treelets only have the packed arrays
+			if (triangles.pPositions == nullptr)
+			{
+				Vector3* pVertices[3]{ &triangle.v0, &triangle.v1, &triangle.v2 };
+				for (int vertex{}; vertex < 3; ++vertex)
+				{
+					*pVertices[vertex] = { triangles.pVertexX[vertex][index], triangles.pVertexY[vertex][index], triangles.pVertexZ[vertex][index] };
+				}
+
+				triangle.normal = { triangles.pNormalX[index], triangles.pNormalY[index], triangles.pNormalZ[index] };
+				return;
+			}
+
+			triangle.normal = triangles.pNormals[index];
+			triangle.v0 = triangles.pPositions[triangles.pIndices[index * 3]];
+			triangle.v1 = triangles.pPositions[triangles.pIndices[index * 3 + 1]];
+			triangle.v2 = triangles.pPositions[triangles.pIndices[index * 3 + 2]];
+		}
+
+		template<TriangleCullMode cullMode>
+		static int ClosestHitTriangles(const TriangleList& triangles, int first, int count, const PreparedRay& ray, HitRecord& hitRecord)
+		{
+			Triangle triangle{};
+
+			int closest{ -1 };
+			const int end{ first + count };
+			for (int index{ first }; index < end; ++index)
+			{
+				GetTriangle(triangles, index, triangle);
+				if (GeometryUtils::HitTest_Triangle<cullMode>(triangle, ray, hitRecord)) closest = index;
+			}
+
+			return closest;
+		}
+
+		template<TriangleCullMode cullMode>
+		static bool AnyHitTriangles(const TriangleList& triangles, int first, int count, const PreparedRay& ray)
+		{
+			Triangle triangle{};
+
+			const int end{ first + count };
+			for (int index{ first }; index < end; ++index)
+			{
+				GetTriangle(triangles, index, triangle);
+				if (GeometryUtils::HitTest_Triangle<cullMode>(triangle, ray)) return true;
+			}
+
+			return false;
+		}
+
+		static int ClosestHitTriangles(const TriangleList& triangles, int first, int count, const PreparedRay& ray, HitRecord& hitRecord)
+		{
+			switch (triangles.cullMode)
+			{
+			case TriangleCullMode::FrontFaceCulling:
+				return ClosestHitTriangles<TriangleCullMode::FrontFaceCulling>(triangles, first, count, ray, hitRecord);
+			case TriangleCullMode::BackFaceCulling:
+				return ClosestHitTriangles<TriangleCullMode::BackFaceCulling>(triangles, first, count, ray, hitRecord);
+			default:
+				return ClosestHitTriangles<TriangleCullMode::NoCulling>(triangles, first, count, ray, hitRecord);
+			}
+		}
+
+		static bool AnyHitTriangles(const TriangleList& triangles, int first, int count, const PreparedRay& ray)
+		{
+			switch (triangles.cullMode)
+			{
+			case TriangleCullMode::FrontFaceCulling:
+				return AnyHitTriangles<TriangleCullMode::FrontFaceCulling>(triangles, first, count, ray);
+			case TriangleCullMode::BackFaceCulling:
+				return AnyHitTriangles<TriangleCullMode::BackFaceCulling>(triangles, first, count, ray);
+			default:
+				return AnyHitTriangles<TriangleCullMode::NoCulling>(triangles, first, count, ray);
+			}
+		}
+
+		static void PackPixels(const ColorRGB* pColors, uint32_t* pPixels, int count, const PixelFormat& format)
+		{
+			for (int index{}; index < count; ++index)
+			{
+				ColorRGB color{ pColors[index] };
+				color.MaxToOne();
+
+				const uint8_t r{ static_cast<uint8_t>(color.r * 255) };
+				const uint8_t g{ static_cast<uint8_t>(color.g * 255) };
+				const uint8_t b{ static_cast<uint8_t>(color.b * 255) };
+
+				pPixels[index] = (static_cast<uint32_t>(r >> format.redLoss) << format.redShift)
+							   | (static_cast<uint32_t>(g >> format.greenLoss) << format.greenShift)
+							   | (static_cast<uint32_t>(b >> format.blueLoss) << format.blueShift)
+							   | format.alphaMask;
+			}
+		}
+
+		const Table& GetBaselineTable()
+		{
+			static const Table table
+			{
+				ClosestHitSpheres,
+				AnyHitSpheres,
+				ClosestHitTriangles,
+				AnyHitTriangles,
+				1,
+				{
+					{ BRDF::Batch::SolidColor, BRDF::Batch::Lambert, BRDF::Batch::LambertPhong<ShadingPrecision::Exact>, BRDF::Batch::CookTorrence<ShadingPrecision::Exact> },
+					{ BRDF::Batch::SolidColor, BRDF::Batch::Lambert, BRDF::Batch::LambertPhong<ShadingPrecision::Fast>, BRDF::Batch::CookTorrence<ShadingPrecision::Fast> },
+					{ BRDF::Batch::SolidColor, BRDF::Batch::Lambert, BRDF::Batch::LambertPhong<ShadingPrecision::Exact>, BRDF::Batch::CookTorrence<ShadingPrecision::Tabulated> }
+				},
+				PackPixels
+			};
+
+			return table;
+		}
+#pragma endregion
+	}
+}
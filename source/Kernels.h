@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	struct ShadingBatch;
+	struct ColorRGBBatch;
+
+	//Hot loops compiled once per instruction set (KernelsAVX2.cpp, KernelsAVX512.cpp), the widest one the cpu supports is picked at startup
+	//The kernels only see plain data (no Vector3 or Float4 member functions) so no inline function gets compiled for a wider
+	//instruction set than the one it runs on, every implementation returns exactly the same results as the baseline
+	namespace Kernels
+	{
+		enum class InstructionSet
+		{
+			Baseline, //SSE2, what the rest of the project is compiled for
+			AVX2,     //AVX2
+			AVX512    //AVX-512 F, CD, BW, DQ and VL (what /arch:AVX512 assumes)
+		};
+
+		//Spheres of a scene (see SphereGeometries), every array is padded to a multiple of SPHERE_PADDING so the kernels
+		//always load whole registers, the padding never hits
+		struct SphereList
+		{
+			const float* pCenterX{};
+			const float* pCenterY{};
+			const float* pCenterZ{};
+			const float* pSquaredRadius{};
+			int count{};
+		};
+
+		//Triangles of a mesh, triangle i uses indices[i * 3] to indices[i * 3 + 2]
+		//The same triangles packed per coordinate (see PackedTriangles), the wide kernels load a whole leaf from those
+		//Treelets of a streamed mesh only have the packed arrays (see StreamedMesh)
+		struct TriangleList
+		{
+			const Vector3* pPositions{};
+			const int* pIndices{};
+			const Vector3* pNormals{};
+			const float* pVertexX[3]{};
+			const float* pVertexY[3]{};
+			const float* pVertexZ[3]{};
+			const float* pNormalX{};
+			const float* pNormalY{};
+			const float* pNormalZ{};
+			//Compressed meshes have none of the above (see CompressedTriangles), the kernels decode these instead
+			const uint16_t* pQuantizedPositions{};
+			const uint16_t* pEncodedNormals{};
+			const uint8_t* pCompressedIndices{};
+			int indexWidth{};
+			const TriangleDecoder* pDecoder{};
+			TriangleCullMode cullMode{};
+		};
+
+		//Channel layout of a 32 bit pixel (same fields as SDL_PixelFormat)
+		struct PixelFormat
+		{
+			uint8_t redShift{};
+			uint8_t greenShift{};
+			uint8_t blueShift{};
+			uint8_t redLoss{};
+			uint8_t greenLoss{};
+			uint8_t blueLoss{};
+			uint32_t alphaMask{};
+		};
+
+		struct Table
+		{
+			//closest-hit: returns the index of the closest sphere nearer than t (and updates t), -1 when there is none
+			//ties go to the first sphere, the same as testing them one by one with GeometryUtils::HitTest_Sphere
+			int (*closestHitSpheres)(const SphereList& spheres, const Ray& ray, float& t);
+			bool (*anyHitSpheres)(const SphereList& spheres, const Ray& ray);
+
+			//closest-hit over triangles [first, first + count), returns the index of the last triangle that got closer than hitRecord.t
+			//(-1 when none did) and stores t and the barycentrics in hitRecord, the same as GeometryUtils::HitTest_Triangle one by one
+			int (*closestHitTriangles)(const TriangleList& triangles, int first, int count, const PreparedRay& ray, HitRecord& hitRecord);
+			bool (*anyHitTriangles)(const TriangleList& triangles, int first, int count, const PreparedRay& ray);
+			//triangles the two above test for about the cost of one, the bvh builds its leaves for it (see TriangleMesh::bvhLeafSize)
+			int triangleLeafSize;
+
+			//indexed by ShadingPrecision, then by MaterialType
+			void (*shadeBatch[3][4])(const ShadingBatch& batch, ColorRGBBatch& result);
+
+			//MaxToOne, scale to [0, 255] and pack, the same as SDL_MapRGB on every pixel
+			void (*packPixels)(const ColorRGB* pColors, uint32_t* pPixels, int count, const PixelFormat& format);
+		};
+
+		//Widest instruction set the cpu and os support
+		InstructionSet GetSupportedInstructionSet();
+		//Supported instruction set, lowered by the RAYTRACER_KERNELS environment variable (baseline, avx2 or avx512) when it is set
+		InstructionSet GetSelectedInstructionSet();
+		const char* ToString(InstructionSet instructionSet);
+
+		//Kernels of the selected instruction set, picked on the first call
+		const Table& Get();
+
+		const Table& GetBaselineTable();
+		const Table& GetAVX2Table();
+		const Table& GetAVX512Table();
+	}
+}
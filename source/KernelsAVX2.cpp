@@ -0,0 +1,104 @@
+//AVX2 versions of the kernels in Kernels.h. GCC and Clang enable AVX2 only for the code after the shared headers,
+//MSVC compiles the whole file with /arch:AVX2 (see RayTracer.vcxproj)
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Kernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#pragma GCC optimize("no-math-errno", "fp-contract=off") //vector sqrt for the batched BRDFs, no fused multiply-adds so results match the baseline
+#endif
+
+#include "BRDFBatch.h"
+
+namespace dae
+{
+	namespace Kernels
+	{
+		namespace
+		{
+			constexpr int LANE_COUNT{ 8 };
+
+			struct Lanes
+			{
+				__m256 value;
+
+				static Lanes Load(const float* pValues) { return { _mm256_load_ps(pValues) }; }
+				static Lanes LoadUnaligned(const float* pValues) { return { _mm256_loadu_ps(pValues) }; }
+				static Lanes Broadcast(float value) { return { _mm256_set1_ps(value) }; }
+				void Store(float* pValues) const { _mm256_store_ps(pValues, value); }
+
+				Lanes operator+(const Lanes& l) const { return { _mm256_add_ps(value, l.value) }; }
+				Lanes operator-(const Lanes& l) const { return { _mm256_sub_ps(value, l.value) }; }
+				Lanes operator*(const Lanes& l) const { return { _mm256_mul_ps(value, l.value) }; }
+				Lanes operator/(const Lanes& l) const { return { _mm256_div_ps(value, l.value) }; }
+			};
+
+			//all bits set in the lanes where the compare is true
+			struct Mask
+			{
+				__m256 value;
+
+				Mask operator&(const Mask& m) const { return { _mm256_and_ps(value, m.value) }; }
+				Mask operator|(const Mask& m) const { return { _mm256_or_ps(value, m.value) }; }
+			};
+
+			inline Lanes Sqrt(const Lanes& l) { return { _mm256_sqrt_ps(l.value) }; }
+			//smallest value of all lanes, halves the register until one lane is left
+			inline float ReduceMin(const Lanes& l)
+			{
+				__m128 smallest{ _mm_min_ps(_mm256_castps256_ps128(l.value), _mm256_extractf128_ps(l.value, 1)) };
+				smallest = _mm_min_ps(smallest, _mm_movehl_ps(smallest, smallest));
+				smallest = _mm_min_ss(smallest, _mm_shuffle_ps(smallest, smallest, _MM_SHUFFLE(1, 1, 1, 1)));
+				return _mm_cvtss_f32(smallest);
+			}
+
+			//ordered compares, false when a lane is NaN like the scalar operators
+			inline Mask Less(const Lanes& l1, const Lanes& l2) { return { _mm256_cmp_ps(l1.value, l2.value, _CMP_LT_OQ) }; }
+			inline Mask Greater(const Lanes& l1, const Lanes& l2) { return { _mm256_cmp_ps(l1.value, l2.value, _CMP_GT_OQ) }; }
+			inline Mask Equal(const Lanes& l1, const Lanes& l2) { return { _mm256_cmp_ps(l1.value, l2.value, _CMP_EQ_OQ) }; }
+
+			inline Lanes Select(const Mask& mask, const Lanes& ifTrue, const Lanes& ifFalse) { return { _mm256_blendv_ps(ifFalse.value, ifTrue.value, mask.value) }; }
+			inline int ToBits(const Mask& mask) { return _mm256_movemask_ps(mask.value); }
+
+#include "KernelsImpl.h"
+		}
+
+		const Table& GetAVX2Table()
+		{
+			return table;
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#else
+//no AVX2 outside of x64, the baseline is all there is
+namespace dae
+{
+	namespace Kernels
+	{
+		const Table& GetAVX2Table()
+		{
+			return GetBaselineTable();
+		}
+	}
+}
+#endif
@@ -0,0 +1,98 @@
+//AVX-512 versions of the kernels in Kernels.h. GCC and Clang enable AVX-512 only for the code after the shared headers,
+//MSVC compiles the whole file with /arch:AVX512 (see RayTracer.vcxproj)
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Kernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f,avx512cd,avx512bw,avx512dq,avx512vl"))), apply_to = function)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512cd,avx512bw,avx512dq,avx512vl")
+#pragma GCC optimize("no-math-errno", "fp-contract=off") //vector sqrt for the batched BRDFs, no fused multiply-adds so results match the baseline
+#endif
+
+#include "BRDFBatch.h"
+
+namespace dae
+{
+	namespace Kernels
+	{
+		namespace
+		{
+			constexpr int LANE_COUNT{ 16 };
+
+			struct Lanes
+			{
+				__m512 value;
+
+				static Lanes Load(const float* pValues) { return { _mm512_load_ps(pValues) }; }
+				static Lanes LoadUnaligned(const float* pValues) { return { _mm512_loadu_ps(pValues) }; }
+				static Lanes Broadcast(float value) { return { _mm512_set1_ps(value) }; }
+				void Store(float* pValues) const { _mm512_store_ps(pValues, value); }
+
+				Lanes operator+(const Lanes& l) const { return { _mm512_add_ps(value, l.value) }; }
+				Lanes operator-(const Lanes& l) const { return { _mm512_sub_ps(value, l.value) }; }
+				Lanes operator*(const Lanes& l) const { return { _mm512_mul_ps(value, l.value) }; }
+				Lanes operator/(const Lanes& l) const { return { _mm512_div_ps(value, l.value) }; }
+			};
+
+			//one bit per lane in an opmask register
+			struct Mask
+			{
+				__mmask16 value;
+
+				Mask operator&(const Mask& m) const { return { static_cast<__mmask16>(value & m.value) }; }
+				Mask operator|(const Mask& m) const { return { static_cast<__mmask16>(value | m.value) }; }
+			};
+
+			inline Lanes Sqrt(const Lanes& l) { return { _mm512_sqrt_ps(l.value) }; }
+			//smallest value of all lanes
+			inline float ReduceMin(const Lanes& l) { return _mm512_reduce_min_ps(l.value); }
+
+			//ordered compares, false when a lane is NaN like the scalar operators
+			inline Mask Less(const Lanes& l1, const Lanes& l2) { return { _mm512_cmp_ps_mask(l1.value, l2.value, _CMP_LT_OQ) }; }
+			inline Mask Greater(const Lanes& l1, const Lanes& l2) { return { _mm512_cmp_ps_mask(l1.value, l2.value, _CMP_GT_OQ) }; }
+			inline Mask Equal(const Lanes& l1, const Lanes& l2) { return { _mm512_cmp_ps_mask(l1.value, l2.value, _CMP_EQ_OQ) }; }
+
+			inline Lanes Select(const Mask& mask, const Lanes& ifTrue, const Lanes& ifFalse) { return { _mm512_mask_blend_ps(mask.value, ifFalse.value, ifTrue.value) }; }
+			inline int ToBits(const Mask& mask) { return static_cast<int>(mask.value); }
+
+#include "KernelsImpl.h"
+		}
+
+		const Table& GetAVX512Table()
+		{
+			return table;
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#else
+//no AVX-512 outside of x64, the baseline is all there is
+namespace dae
+{
+	namespace Kernels
+	{
+		const Table& GetAVX512Table()
+		{
+			return GetBaselineTable();
+		}
+	}
+}
+#endif
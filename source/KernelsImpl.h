@@ -0,0 +1,490 @@
+#pragma once
+//Kernel bodies shared by the instruction set translation units, included inside their anonymous namespace after the
+//instruction set is enabled. Every lane runs the same float operations in the same order as the scalar code, so the results
+//match the baseline bit for bit. The translation unit provides:
+//	LANE_COUNT, Lanes (LANE_COUNT floats) and Mask (one compare result per lane)
+//	Lanes::Load, Lanes::LoadUnaligned, Lanes::Broadcast, Lanes::Store, + - * /, Sqrt and ReduceMin (smallest of all lanes)
+//	Less, Greater and Equal returning a Mask, & | on masks, Select(mask, ifTrue, ifFalse) and ToBits(mask)
+
+//same result as std::min and std::max, those are inline functions with external linkage and can't be used in here
+inline float MinFloat(float a, float b) { return b < a ? b : a; }
+inline int MinInt(int a, int b) { return b < a ? b : a; }
+
+//bits of the lanes that hold an element, the last chunk of a list is only partly filled
+inline int GetUsedLanes(int count)
+{
+	return count >= LANE_COUNT ? (1 << LANE_COUNT) - 1 : (1 << count) - 1;
+}
+
+//index of the lowest set bit, bits can't be 0
+inline int GetFirstLane(int bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index{};
+	_BitScanForward(&index, static_cast<unsigned long>(bits));
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(static_cast<unsigned int>(bits));
+#endif
+}
+
+#pragma region SPHERES
+static_assert(SPHERE_PADDING % LANE_COUNT == 0, "the sphere arrays are loaded a whole register at a time");
+
+//Same math as GeometryUtils::HitTest_Sphere for the LANE_COUNT spheres starting at first, the first of t0 and t1 within
+//[ray.min, ray.max] is the candidate of each lane. The arrays are padded so the loads never read past the end
+inline Lanes IntersectSpheres(const SphereList& spheres, int first, const Ray& ray, Mask& didHit)
+{
+	const Lanes centerX{ Lanes::LoadUnaligned(spheres.pCenterX + first) };
+	const Lanes centerY{ Lanes::LoadUnaligned(spheres.pCenterY + first) };
+	const Lanes centerZ{ Lanes::LoadUnaligned(spheres.pCenterZ + first) };
+	const Lanes squaredRadius{ Lanes::LoadUnaligned(spheres.pSquaredRadius + first) };
+
+	const float A{ ray.direction.x * ray.direction.x + ray.direction.y * ray.direction.y + ray.direction.z * ray.direction.z };
+
+	const Lanes toOriginX{ Lanes::Broadcast(ray.origin.x) - centerX };
+	const Lanes toOriginY{ Lanes::Broadcast(ray.origin.y) - centerY };
+	const Lanes toOriginZ{ Lanes::Broadcast(ray.origin.z) - centerZ };
+
+	const Lanes B{ Lanes::Broadcast(2.f) * (Lanes::Broadcast(ray.direction.x) * toOriginX + Lanes::Broadcast(ray.direction.y) * toOriginY + Lanes::Broadcast(ray.direction.z) * toOriginZ) };
+	const Lanes C{ (toOriginX * toOriginX + toOriginY * toOriginY + toOriginZ * toOriginZ) - squaredRadius };
+
+	const Lanes discriminant{ B * B - Lanes::Broadcast(4 * A) * C };
+	const Mask hasRoots{ Greater(discriminant, Lanes::Broadcast(0.f)) };
+
+	//most rays miss every sphere of the chunk, skip the square root and divisions
+	if (ToBits(hasRoots) == 0)
+	{
+		didHit = hasRoots;
+		return discriminant;
+	}
+
+	const Lanes sqrtDiscriminant{ Sqrt(discriminant) };
+
+	const Lanes minusB{ Lanes::Broadcast(0.f) - B };
+	const Lanes twoA{ Lanes::Broadcast(2.f * A) };
+	const Lanes t0{ (minusB - sqrtDiscriminant) / twoA };
+	const Lanes t1{ (minusB + sqrtDiscriminant) / twoA };
+
+	const Lanes rayMin{ Lanes::Broadcast(ray.min) };
+	const Lanes rayMax{ Lanes::Broadcast(ray.max) };
+	const Mask t0Valid{ hasRoots & Greater(t0, rayMin) & Less(t0, rayMax) };
+	const Mask t1Valid{ hasRoots & Greater(t1, rayMin) & Less(t1, rayMax) };
+
+	didHit = t0Valid | t1Valid;
+	return Select(t0Valid, t0, t1);
+}
+
+int ClosestHitSpheres(const SphereList& spheres, const Ray& ray, float& t)
+{
+	const Lanes noHit{ Lanes::Broadcast(INFINITY) };
+
+	int closest{ -1 };
+	for (int first{}; first < spheres.count; first += LANE_COUNT)
+	{
+		Mask didHit{};
+		const Lanes candidates{ IntersectSpheres(spheres, first, ray, didHit) };
+		if ((ToBits(didHit) & GetUsedLanes(spheres.count - first)) == 0) continue;
+
+		//masked min-t reduction, the lowest lane holding the minimum wins so ties keep the first sphere like the scalar loop
+		const Lanes hitDistances{ Select(didHit, candidates, noHit) };
+		const float nearest{ ReduceMin(hitDistances) };
+		if (nearest < t)
+		{
+			t = nearest;
+			closest = first + GetFirstLane(ToBits(Equal(hitDistances, Lanes::Broadcast(nearest))));
+		}
+	}
+
+	return closest;
+}
+
+bool AnyHitSpheres(const SphereList& spheres, const Ray& ray)
+{
+	for (int first{}; first < spheres.count; first += LANE_COUNT)
+	{
+		Mask didHit{};
+		IntersectSpheres(spheres, first, ray, didHit);
+		if (ToBits(didHit) & GetUsedLanes(spheres.count - first)) return true;
+	}
+
+	return false;
+}
+#pragma endregion
+
+#pragma region TRIANGLES
+static_assert(TRIANGLE_PADDING >= LANE_COUNT, "a register load starting at any triangle stays inside the packed arrays");
+
+//a whole leaf is one register, see TriangleMesh::bvhLeafSize
+constexpr int TRIANGLE_LEAF_SIZE{ LANE_COUNT };
+
+//Plain floats of the prepared ray, read once per range
+struct TriangleRay
+{
+	alignas(16) float origin[4];
+	alignas(16) float shear[3][4]; //columns, like PreparedRay::shearX to shearZ
+	float direction[3];
+	float min;
+	float max;
+
+	explicit TriangleRay(const PreparedRay& ray) :
+		direction{ ray.direction.x, ray.direction.y, ray.direction.z },
+		min{ ray.min },
+		max{ ray.max }
+	{
+		_mm_store_ps(origin, ray.originLanes.value);
+		_mm_store_ps(shear[0], ray.shearX.value);
+		_mm_store_ps(shear[1], ray.shearY.value);
+		_mm_store_ps(shear[2], ray.shearZ.value);
+	}
+};
+
+//Integers of a compressed leaf gathered lane by lane as floats, the lanes past count are zero (they get masked out)
+//The decode runs on whole registers with the same operations as MeshCompression::DecodePosition and DecodeNormal
+struct CompressedTriangles
+{
+	alignas(64) float coordinates[3][3][LANE_COUNT]; //[vertex][axis][lane]
+	alignas(64) float normals[2][LANE_COUNT];
+
+	void GatherVertices(const TriangleList& triangles, int first, int count)
+	{
+		for (int lane{}; lane < count; ++lane)
+		{
+			uint32_t indices[3]{};
+			ReadIndices(triangles, first + lane, indices);
+
+			for (int vertex{}; vertex < 3; ++vertex)
+			{
+				const uint16_t* pCoordinates{ triangles.pQuantizedPositions + indices[vertex] * 3 };
+				coordinates[vertex][0][lane] = static_cast<float>(pCoordinates[0]);
+				coordinates[vertex][1][lane] = static_cast<float>(pCoordinates[1]);
+				coordinates[vertex][2][lane] = static_cast<float>(pCoordinates[2]);
+			}
+		}
+
+		for (int lane{ count }; lane < LANE_COUNT; ++lane)
+		{
+			for (int vertex{}; vertex < 3; ++vertex)
+			{
+				coordinates[vertex][0][lane] = coordinates[vertex][1][lane] = coordinates[vertex][2][lane] = 0.f;
+			}
+		}
+	}
+
+	void GatherNormals(const TriangleList& triangles, int first, int count)
+	{
+		for (int lane{}; lane < LANE_COUNT; ++lane)
+		{
+			normals[0][lane] = lane < count ? static_cast<float>(triangles.pEncodedNormals[(first + lane) * 2]) : 0.f;
+			normals[1][lane] = lane < count ? static_cast<float>(triangles.pEncodedNormals[(first + lane) * 2 + 1]) : 0.f;
+		}
+	}
+
+	//one switch on the width per triangle instead of per index
+	static void ReadIndices(const TriangleList& triangles, int triangle, uint32_t* pIndices)
+	{
+		const uint8_t* pSource{ triangles.pCompressedIndices };
+		switch (triangles.indexWidth)
+		{
+		case 1:
+			for (int vertex{}; vertex < 3; ++vertex) pIndices[vertex] = MeshCompression::ReadIndex(pSource, 1, triangle * 3 + vertex);
+			break;
+		case 2:
+			for (int vertex{}; vertex < 3; ++vertex) pIndices[vertex] = MeshCompression::ReadIndex(pSource, 2, triangle * 3 + vertex);
+			break;
+		default:
+			for (int vertex{}; vertex < 3; ++vertex) pIndices[vertex] = MeshCompression::ReadIndex(pSource, 4, triangle * 3 + vertex);
+			break;
+		}
+	}
+
+	void DecodePosition(const TriangleDecoder& decoder, int vertex, Lanes& x, Lanes& y, Lanes& z) const
+	{
+		const Lanes quantized[3]{ Lanes::Load(coordinates[vertex][0]), Lanes::Load(coordinates[vertex][1]), Lanes::Load(coordinates[vertex][2]) };
+
+		Lanes* pWorld[3]{ &x, &y, &z };
+		for (int axis{}; axis < 3; ++axis)
+		{
+			const float* pRow{ decoder.position[axis] };
+			*pWorld[axis] = Lanes::Broadcast(pRow[0]) * quantized[0] + Lanes::Broadcast(pRow[1]) * quantized[1] + Lanes::Broadcast(pRow[2]) * quantized[2] + Lanes::Broadcast(pRow[3]);
+		}
+	}
+
+	//fabsf(a) is Select(a < 0, 0 - a, a), the same except for -0 which can't come out of the dequantization
+	void DecodeNormal(const TriangleDecoder& decoder, Lanes& x, Lanes& y, Lanes& z) const
+	{
+		const Lanes zero{ Lanes::Broadcast(0.f) };
+		const Lanes one{ Lanes::Broadcast(1.f) };
+		const Lanes steps{ Lanes::Broadcast(MeshCompression::QUANTIZATION_STEPS) };
+		const Lanes two{ Lanes::Broadcast(2.f) };
+
+		Lanes u{ Lanes::Load(normals[0]) / steps * two - one };
+		Lanes v{ Lanes::Load(normals[1]) / steps * two - one };
+		const Lanes w{ one - Select(Less(u, zero), zero - u, u) - Select(Less(v, zero), zero - v, v) };
+
+		//u + -fold is u - fold
+		const Lanes fold{ Select(Less(w, zero), zero - w, zero) };
+		u = Select(Less(u, zero), u + fold, u - fold);
+		v = Select(Less(v, zero), v + fold, v - fold);
+
+		const Lanes local[3]{ u, v, w };
+		Lanes* pWorld[3]{ &x, &y, &z };
+		for (int axis{}; axis < 3; ++axis)
+		{
+			const float* pRow{ decoder.normal[axis] };
+			*pWorld[axis] = Lanes::Broadcast(pRow[0]) * local[0] + Lanes::Broadcast(pRow[1]) * local[1] + Lanes::Broadcast(pRow[2]) * local[2];
+		}
+	}
+};
+
+//Same math as GeometryUtils::IntersectTriangle for LANE_COUNT triangles, returns the lanes that hit within [ray.min, ray.max]
+//The packed arrays are padded so the loads never read past the end, the lanes past count are masked out
+template<TriangleCullMode cullMode, bool anyHit>
+inline int IntersectTriangles(const TriangleList& triangles, int first, int count, const TriangleRay& ray, float* t, float* beta, float* gamma)
+{
+	const bool isCompressed{ triangles.pQuantizedPositions != nullptr };
+	CompressedTriangles compressed;
+	if (isCompressed) compressed.GatherVertices(triangles, first, count);
+
+	const Lanes originX{ Lanes::Broadcast(ray.origin[0]) };
+	const Lanes originY{ Lanes::Broadcast(ray.origin[1]) };
+	const Lanes originZ{ Lanes::Broadcast(ray.origin[2]) };
+
+	Lanes x[3]{};
+	Lanes y[3]{};
+	Lanes z[3]{};
+	for (int vertex{}; vertex < 3; ++vertex)
+	{
+		Lanes positionX{}, positionY{}, positionZ{};
+		if (isCompressed) compressed.DecodePosition(*triangles.pDecoder, vertex, positionX, positionY, positionZ);
+		else
+		{
+			positionX = Lanes::LoadUnaligned(triangles.pVertexX[vertex] + first);
+			positionY = Lanes::LoadUnaligned(triangles.pVertexY[vertex] + first);
+			positionZ = Lanes::LoadUnaligned(triangles.pVertexZ[vertex] + first);
+		}
+
+		const Lanes relativeX{ positionX - originX };
+		const Lanes relativeY{ positionY - originY };
+		const Lanes relativeZ{ positionZ - originZ };
+
+		x[vertex] = Lanes::Broadcast(ray.shear[0][0]) * relativeX + Lanes::Broadcast(ray.shear[1][0]) * relativeY + Lanes::Broadcast(ray.shear[2][0]) * relativeZ;
+		y[vertex] = Lanes::Broadcast(ray.shear[0][1]) * relativeX + Lanes::Broadcast(ray.shear[1][1]) * relativeY + Lanes::Broadcast(ray.shear[2][1]) * relativeZ;
+		z[vertex] = Lanes::Broadcast(ray.shear[0][2]) * relativeX + Lanes::Broadcast(ray.shear[1][2]) * relativeY + Lanes::Broadcast(ray.shear[2][2]) * relativeZ;
+	}
+
+	Lanes u{ x[2] * y[1] - y[2] * x[1] };
+	Lanes v{ x[0] * y[2] - y[0] * x[2] };
+	Lanes w{ x[1] * y[0] - y[1] * x[0] };
+
+	//exactly on an edge, those lanes redo the edge functions in double like the scalar test
+	const Lanes zero{ Lanes::Broadcast(0.f) };
+	const int onEdgeLanes{ ToBits(Equal(u, zero) | Equal(v, zero) | Equal(w, zero)) & GetUsedLanes(count) };
+	if (onEdgeLanes != 0)
+	{
+		alignas(64) float ax[LANE_COUNT], ay[LANE_COUNT], bx[LANE_COUNT], by[LANE_COUNT], cx[LANE_COUNT], cy[LANE_COUNT];
+		alignas(64) float uLanes[LANE_COUNT], vLanes[LANE_COUNT], wLanes[LANE_COUNT];
+		x[0].Store(ax); y[0].Store(ay);
+		x[1].Store(bx); y[1].Store(by);
+		x[2].Store(cx); y[2].Store(cy);
+		u.Store(uLanes); v.Store(vLanes); w.Store(wLanes);
+
+		for (int lane{}; lane < count; ++lane)
+		{
+			if ((onEdgeLanes >> lane & 1) == 0) continue;
+
+			uLanes[lane] = static_cast<float>(static_cast<double>(cx[lane]) * by[lane] - static_cast<double>(cy[lane]) * bx[lane]);
+			vLanes[lane] = static_cast<float>(static_cast<double>(ax[lane]) * cy[lane] - static_cast<double>(ay[lane]) * cx[lane]);
+			wLanes[lane] = static_cast<float>(static_cast<double>(bx[lane]) * ay[lane] - static_cast<double>(by[lane]) * ax[lane]);
+		}
+
+		u = Lanes::Load(uLanes);
+		v = Lanes::Load(vLanes);
+		w = Lanes::Load(wLanes);
+	}
+
+	const Mask mixedSigns{ (Less(u, zero) | Less(v, zero) | Less(w, zero)) & (Greater(u, zero) | Greater(v, zero) | Greater(w, zero)) };
+
+	const Lanes determinant{ u + v + w };
+	const Lanes inverseDeterminant{ Lanes::Broadcast(1.f) / determinant };
+	const Lanes tLanes{ (u * z[0] + v * z[1] + w * z[2]) * inverseDeterminant };
+
+	//written as rejections like the scalar test, a NaN t is not rejected there either
+	Mask rejected{ mixedSigns | Equal(determinant, zero) | Less(tLanes, Lanes::Broadcast(ray.min)) | Greater(tLanes, Lanes::Broadcast(ray.max)) };
+	if constexpr (cullMode != TriangleCullMode::NoCulling)
+	{
+		Lanes normalX{}, normalY{}, normalZ{};
+		if (isCompressed)
+		{
+			compressed.GatherNormals(triangles, first, count);
+			compressed.DecodeNormal(*triangles.pDecoder, normalX, normalY, normalZ);
+		}
+		else
+		{
+			normalX = Lanes::LoadUnaligned(triangles.pNormalX + first);
+			normalY = Lanes::LoadUnaligned(triangles.pNormalY + first);
+			normalZ = Lanes::LoadUnaligned(triangles.pNormalZ + first);
+		}
+
+		const Lanes normalDotView{ normalX * Lanes::Broadcast(ray.direction[0]) + normalY * Lanes::Broadcast(ray.direction[1]) + normalZ * Lanes::Broadcast(ray.direction[2]) };
+		if constexpr ((cullMode == TriangleCullMode::BackFaceCulling) != anyHit) rejected = rejected | Greater(normalDotView, zero);
+		else rejected = rejected | Less(normalDotView, zero);
+	}
+
+	if constexpr (!anyHit)
+	{
+		tLanes.Store(t);
+		(v * inverseDeterminant).Store(beta);
+		(w * inverseDeterminant).Store(gamma);
+	}
+
+	return ~ToBits(rejected) & GetUsedLanes(count);
+}
+
+template<TriangleCullMode cullMode>
+int ClosestHitTriangles(const TriangleList& triangles, int first, int count, const PreparedRay& preparedRay, HitRecord& hitRecord)
+{
+	const TriangleRay ray{ preparedRay };
+
+	int closest{ -1 };
+	const int end{ first + count };
+	for (int chunk{ first }; chunk < end; chunk += LANE_COUNT)
+	{
+		const int amountOfLanes{ MinInt(end - chunk, LANE_COUNT) };
+
+		alignas(64) float t[LANE_COUNT];
+		alignas(64) float beta[LANE_COUNT];
+		alignas(64) float gamma[LANE_COUNT];
+		const int hitLanes{ IntersectTriangles<cullMode, false>(triangles, chunk, amountOfLanes, ray, t, beta, gamma) };
+		if (hitLanes == 0) continue;
+
+		//in triangle order against the closest hit so far, ties go to the later triangle like the scalar loop
+		for (int lane{}; lane < amountOfLanes; ++lane)
+		{
+			if ((hitLanes >> lane & 1) == 0) continue;
+			if (t[lane] > MinFloat(ray.max, hitRecord.t)) continue;
+
+			hitRecord.t = t[lane];
+			hitRecord.beta = beta[lane];
+			hitRecord.gamma = gamma[lane];
+			closest = chunk + lane;
+		}
+	}
+
+	return closest;
+}
+
+template<TriangleCullMode cullMode>
+bool AnyHitTriangles(const TriangleList& triangles, int first, int count, const PreparedRay& preparedRay)
+{
+	const TriangleRay ray{ preparedRay };
+
+	const int end{ first + count };
+	for (int chunk{ first }; chunk < end; chunk += LANE_COUNT)
+	{
+		if (IntersectTriangles<cullMode, true>(triangles, chunk, MinInt(end - chunk, LANE_COUNT), ray, nullptr, nullptr, nullptr) != 0) return true;
+	}
+
+	return false;
+}
+
+int ClosestHitTriangles(const TriangleList& triangles, int first, int count, const PreparedRay& ray, HitRecord& hitRecord)
+{
+	switch (triangles.cullMode)
+	{
+	case TriangleCullMode::FrontFaceCulling:
+		return ClosestHitTriangles<TriangleCullMode::FrontFaceCulling>(triangles, first, count, ray, hitRecord);
+	case TriangleCullMode::BackFaceCulling:
+		return ClosestHitTriangles<TriangleCullMode::BackFaceCulling>(triangles, first, count, ray, hitRecord);
+	default:
+		return ClosestHitTriangles<TriangleCullMode::NoCulling>(triangles, first, count, ray, hitRecord);
+	}
+}
+
+bool AnyHitTriangles(const TriangleList& triangles, int first, int count, const PreparedRay& ray)
+{
+	switch (triangles.cullMode)
+	{
+	case TriangleCullMode::FrontFaceCulling:
+		return AnyHitTriangles<TriangleCullMode::FrontFaceCulling>(triangles, first, count, ray);
+	case TriangleCullMode::BackFaceCulling:
+		return AnyHitTriangles<TriangleCullMode::BackFaceCulling>(triangles, first, count, ray);
+	default:
+		return AnyHitTriangles<TriangleCullMode::NoCulling>(triangles, first, count, ray);
+	}
+}
+#pragma endregion
+
+#pragma region PIXELS
+//ColorRGB::MaxToOne and the * 255 of Renderer::WritePixel per lane, the truncation and packing stay scalar
+void PackPixels(const ColorRGB* pColors, uint32_t* pPixels, int count, const PixelFormat& format)
+{
+	for (int first{}; first < count; first += LANE_COUNT)
+	{
+		const int amountOfLanes{ MinInt(count - first, LANE_COUNT) };
+
+		alignas(64) float red[LANE_COUNT]{};
+		alignas(64) float green[LANE_COUNT]{};
+		alignas(64) float blue[LANE_COUNT]{};
+		for (int lane{}; lane < amountOfLanes; ++lane)
+		{
+			red[lane] = pColors[first + lane].r;
+			green[lane] = pColors[first + lane].g;
+			blue[lane] = pColors[first + lane].b;
+		}
+
+		Lanes r{ Lanes::Load(red) };
+		Lanes g{ Lanes::Load(green) };
+		Lanes b{ Lanes::Load(blue) };
+
+		//std::max(r, std::max(g, b))
+		const Lanes maxGB{ Select(Less(g, b), b, g) };
+		const Lanes maxValue{ Select(Less(r, maxGB), maxGB, r) };
+		const Mask tooBright{ Greater(maxValue, Lanes::Broadcast(1.f)) };
+		r = Select(tooBright, r / maxValue, r);
+		g = Select(tooBright, g / maxValue, g);
+		b = Select(tooBright, b / maxValue, b);
+
+		const Lanes scale{ Lanes::Broadcast(255.f) };
+		(r * scale).Store(red);
+		(g * scale).Store(green);
+		(b * scale).Store(blue);
+
+		for (int lane{}; lane < amountOfLanes; ++lane)
+		{
+			const uint8_t r8{ static_cast<uint8_t>(red[lane]) };
+			const uint8_t g8{ static_cast<uint8_t>(green[lane]) };
+			const uint8_t b8{ static_cast<uint8_t>(blue[lane]) };
+
+			pPixels[first + lane] = (static_cast<uint32_t>(r8 >> format.redLoss) << format.redShift)
+								  | (static_cast<uint32_t>(g8 >> format.greenLoss) << format.greenShift)
+								  | (static_cast<uint32_t>(b8 >> format.blueLoss) << format.blueShift)
+								  | format.alphaMask;
+		}
+	}
+}
+#pragma endregion
+
+#pragma region SHADING
+void ShadeSolidColor(const ShadingBatch& batch, ColorRGBBatch& result) { BRDF::Batch::SolidColor(batch, result); }
+void ShadeLambert(const ShadingBatch& batch, ColorRGBBatch& result) { BRDF::Batch::Lambert(batch, result); }
+template<ShadingPrecision precision>
+void ShadeLambertPhong(const ShadingBatch& batch, ColorRGBBatch& result) { BRDF::Batch::LambertPhong<precision>(batch, result); }
+template<ShadingPrecision precision>
+void ShadeCookTorrence(const ShadingBatch& batch, ColorRGBBatch& result) { BRDF::Batch::CookTorrence<precision>(batch, result); }
+#pragma endregion
+
+const Table table
+{
+	ClosestHitSpheres,
+	AnyHitSpheres,
+	ClosestHitTriangles,
+	AnyHitTriangles,
+	TRIANGLE_LEAF_SIZE,
+	{
+		{ ShadeSolidColor, ShadeLambert, ShadeLambertPhong<ShadingPrecision::Exact>, ShadeCookTorrence<ShadingPrecision::Exact> },
+		{ ShadeSolidColor, ShadeLambert, ShadeLambertPhong<ShadingPrecision::Fast>, ShadeCookTorrence<ShadingPrecision::Fast> },
+		{ ShadeSolidColor, ShadeLambert, ShadeLambertPhong<ShadingPrecision::Exact>, ShadeCookTorrence<ShadingPrecision::Tabulated> }
+	},
+	PackPixels
+};
@@ -0,0 +1,168 @@
+#include "LightBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	namespace
+	{
+		//every member the tree is built from
+		bool IsSameLight(const Light& a, const Light& b)
+		{
+			return a.type == b.type && a.origin == b.origin && a.intensity == b.intensity && a.radius == b.radius
+				&& a.color.r == b.color.r && a.color.g == b.color.g && a.color.b == b.color.b;
+		}
+	}
+
+	void LightBVH::Build(const std::vector<Light>& lights)
+	{
+		//most scenes don't move their lights
+		if (!m_BuiltLights.empty() && std::equal(lights.begin(), lights.end(), m_BuiltLights.begin(), m_BuiltLights.end(), IsSameLight)) return;
+		m_BuiltLights = lights;
+
+		m_Nodes.clear();
+		m_GlobalLights.clear();
+		m_PointLights.clear();
+
+		const uint32_t amountOfLights{ static_cast<uint32_t>(lights.size()) };
+		for (uint32_t lightIndex{}; lightIndex < amountOfLights; ++lightIndex)
+		{
+			if (lights[lightIndex].type == LightType::Point) m_PointLights.push_back(lightIndex);
+			else m_GlobalLights.push_back(lightIndex);
+		}
+
+		if (m_PointLights.empty()) return;
+
+		m_Nodes.reserve(2 * m_PointLights.size() - 1);
+		BuildNode(m_PointLights, 0, m_PointLights.size(), lights);
+	}
+
+	uint32_t LightBVH::BuildNode(std::vector<uint32_t>& lightIndices, size_t first, size_t last, const std::vector<Light>& lights)
+	{
+		const uint32_t nodeIndex{ static_cast<uint32_t>(m_Nodes.size()) };
+		m_Nodes.emplace_back();
+
+		if (last - first == 1)
+		{
+			const Light& light{ lights[lightIndices[first]] };
+
+			Node& leaf{ m_Nodes[nodeIndex] };
+			leaf.min = light.origin;
+			leaf.max = light.origin;
+			leaf.center = light.origin;
+			leaf.power = light.intensity * std::max(light.color.r, std::max(light.color.g, light.color.b));
+			leaf.maxRadius = light.radius;
+			leaf.child = lightIndices[first];
+			leaf.amountOfLights = 1;
+			return nodeIndex;
+		}
+
+		//median split on the longest axis of the light positions
+		AABB bounds{};
+		for (size_t index{ first }; index < last; ++index)
+		{
+			bounds.Grow(lights[lightIndices[index]].origin);
+		}
+
+		const Vector3 extent{ bounds.max - bounds.min };
+		int axis{ 0 };
+		if (extent.y > extent.x) axis = 1;
+		if (extent.z > extent[axis]) axis = 2;
+
+		const size_t middle{ first + (last - first) / 2 };
+		std::nth_element(lightIndices.begin() + first, lightIndices.begin() + middle, lightIndices.begin() + last,
+			[&lights, axis](uint32_t a, uint32_t b) { return lights[a].origin[axis] < lights[b].origin[axis]; });
+
+		const uint32_t leftChild{ BuildNode(lightIndices, first, middle, lights) };
+		const uint32_t rightChild{ BuildNode(lightIndices, middle, last, lights) };
+
+		//m_Nodes may have grown, take the references only now
+		const Node& left{ m_Nodes[leftChild] };
+		const Node& right{ m_Nodes[rightChild] };
+		Node& node{ m_Nodes[nodeIndex] };
+		node.min = Vector3::Min(left.min, right.min);
+		node.max = Vector3::Max(left.max, right.max);
+		node.center = (node.min + node.max) * 0.5f;
+		node.boundingRadius = (node.max - node.min).Magnitude() * 0.5f;
+		node.power = left.power + right.power;
+		node.maxRadius = std::max(left.maxRadius, right.maxRadius);
+		node.child = rightChild;
+		node.amountOfLights = left.amountOfLights + right.amountOfLights;
+		return nodeIndex;
+	}
+
+	float LightBVH::GetImportance(const Node& node, const Vector3& position, const Vector3& normal, bool useCosineBound) const
+	{
+		const float boundingRadius{ node.boundingRadius };
+
+		const Vector3 toCenter{ node.center - position };
+		const float distance{ toCenter.Magnitude() };
+
+		//every light of the node is further away than its radius
+		if (distance - boundingRadius >= node.maxRadius) return 0.f;
+
+		//inside the bounds the distance says nothing, clamp so close clusters don't get an infinite importance
+		const float clampedDistance{ std::max({ distance, boundingRadius, 0.0001f }) };
+		float importance{ node.power / (clampedDistance * clampedDistance) };
+
+		if (useCosineBound && distance > boundingRadius)
+		{
+			//smallest angle between the normal and any direction into the bounding sphere: cos(max(theta - thetaBounds, 0))
+			const float cosTheta{ Vector3::Dot(normal, toCenter) / distance };
+			const float sinThetaBounds{ boundingRadius / distance };
+			const float cosThetaBounds{ sqrtf(1.f - sinThetaBounds * sinThetaBounds) };
+
+			if (cosTheta < cosThetaBounds)
+			{
+				const float sinTheta{ sqrtf(std::max(1.f - cosTheta * cosTheta, 0.f)) };
+				const float cosBound{ cosTheta * cosThetaBounds + sinTheta * sinThetaBounds };
+				if (cosBound <= 0.f) return 0.f;
+
+				importance *= cosBound;
+			}
+		}
+
+		return importance;
+	}
+
+	bool LightBVH::Sample(const Vector3& position, const Vector3& normal, bool useCosineBound, float random, uint32_t& lightIndex, float& pdf) const
+	{
+		if (m_Nodes.empty() || GetImportance(m_Nodes[0], position, normal, useCosineBound) <= 0.f) return false;
+
+		uint32_t nodeIndex{ 0 };
+		pdf = 1.f;
+
+		while (m_Nodes[nodeIndex].amountOfLights > 1)
+		{
+			const uint32_t leftChild{ nodeIndex + 1 };
+			const uint32_t rightChild{ m_Nodes[nodeIndex].child };
+
+			const float leftImportance{ GetImportance(m_Nodes[leftChild], position, normal, useCosineBound) };
+			const float rightImportance{ GetImportance(m_Nodes[rightChild], position, normal, useCosineBound) };
+			if (leftImportance + rightImportance <= 0.f) return false;
+
+			//reuse the random number for the next level by remapping the chosen interval back to [0, 1)
+			const float leftProbability{ leftImportance / (leftImportance + rightImportance) };
+			if (random < leftProbability)
+			{
+				random /= leftProbability;
+				pdf *= leftProbability;
+				nodeIndex = leftChild;
+			}
+			else
+			{
+				random = (random - leftProbability) / (1.f - leftProbability);
+				pdf *= 1.f - leftProbability;
+				nodeIndex = rightChild;
+			}
+
+			random = std::min(random, 0.99999994f);
+		}
+
+		lightIndex = m_Nodes[nodeIndex].child;
+		return true;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+#include "Math.h"
+
+namespace dae
+{
+	//Bounding volume hierarchy over the point lights, every node bounds the positions, total power and influence radius of its lights
+	//Used to pick lights at random with a probability proportional to how much they can contribute at a shading point,
+	//so the cost per pixel stays the same no matter how many lights the scene has
+	//Directional lights reach everything with the same strength, they are not in the tree and are always shaded (GetGlobalLights)
+	class LightBVH final
+	{
+	public:
+		//Only rebuilds when lights differs from the ones of the previous build
+		void Build(const std::vector<Light>& lights);
+
+		//Walks down the tree picking a child proportional to its importance, random has to be in [0, 1)
+		//useCosineBound also weighs by the best possible Dot(normal, toLight) of a node (for lighting modes that use the observed area)
+		//Returns false when no light can contribute at position, pdf is the probability that this light was picked
+		bool Sample(const Vector3& position, const Vector3& normal, bool useCosineBound, float random, uint32_t& lightIndex, float& pdf) const;
+
+		const std::vector<uint32_t>& GetGlobalLights() const { return m_GlobalLights; }
+
+	private:
+		struct Node
+		{
+			Vector3 min{};
+			Vector3 max{};
+			Vector3 center{};
+			float boundingRadius{}; //radius of the sphere around min and max
+			float power{}; //summed intensity * brightest color channel
+			float maxRadius{}; //largest influence radius of the lights below this node
+			uint32_t child{}; //interior: index of the right child (the left one directly follows the node), leaf: light index
+			uint32_t amountOfLights{};
+		};
+
+		//cleared but never freed, after the first build a rebuild doesn't allocate
+		std::vector<Node> m_Nodes{};
+		std::vector<uint32_t> m_GlobalLights{};
+		std::vector<uint32_t> m_PointLights{};
+
+		//the lights of the last build, Build returns right away when they didn't change
+		std::vector<Light> m_BuiltLights{};
+
+		uint32_t BuildNode(std::vector<uint32_t>& lightIndices, size_t first, size_t last, const std::vector<Light>& lights);
+		float GetImportance(const Node& node, const Vector3& position, const Vector3& normal, bool useCosineBound) const;
+	};
+}
@@ -0,0 +1,136 @@
+#include "LightGrid.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	namespace
+	{
+		bool HasFiniteRadius(const Light& light)
+		{
+			return light.type == LightType::Point && light.radius < FLT_MAX;
+		}
+	}
+
+	void LightGrid::Build(const std::vector<Light>& lights)
+	{
+		m_GlobalLights.clear();
+		m_CellOffsets.clear();
+		m_CellLights.clear();
+		m_MaxLightsPerCell = 0;
+		m_Dimensions[0] = m_Dimensions[1] = m_Dimensions[2] = 0;
+
+		//bounds of all influence spheres
+		AABB bounds{};
+		float summedRadius{};
+		uint32_t amountOfLocalLights{};
+
+		const uint32_t amountOfLights{ static_cast<uint32_t>(lights.size()) };
+		for (uint32_t lightIndex{}; lightIndex < amountOfLights; ++lightIndex)
+		{
+			const Light& light{ lights[lightIndex] };
+			if (!HasFiniteRadius(light))
+			{
+				m_GlobalLights.push_back(lightIndex);
+				continue;
+			}
+
+			const Vector3 extent{ light.radius, light.radius, light.radius };
+			bounds.Grow(light.origin - extent);
+			bounds.Grow(light.origin + extent);
+			summedRadius += light.radius;
+			++amountOfLocalLights;
+		}
+
+		if (amountOfLocalLights == 0) return;
+
+		//cells about as big as an average light, without going over MAX_CELLS_PER_AXIS
+		const Vector3 boundsSize{ bounds.max - bounds.min };
+		const float largestSide{ std::max(boundsSize.x, std::max(boundsSize.y, boundsSize.z)) };
+		const float cellSize{ std::max({ summedRadius / amountOfLocalLights, largestSide / MAX_CELLS_PER_AXIS, 0.0001f }) };
+
+		m_Min = bounds.min;
+		m_InverseCellSize = 1.f / cellSize;
+		for (int axis{}; axis < 3; ++axis)
+		{
+			m_Dimensions[axis] = std::clamp(static_cast<int>(std::ceil(boundsSize[axis] * m_InverseCellSize)), 1, MAX_CELLS_PER_AXIS);
+		}
+
+		const size_t amountOfCells{ static_cast<size_t>(m_Dimensions[0]) * m_Dimensions[1] * m_Dimensions[2] };
+		m_CellOffsets.assign(amountOfCells + 1, 0);
+
+		//pass 0 counts the lights per cell, pass 1 writes them
+		for (int pass{}; pass < 2; ++pass)
+		{
+			for (uint32_t lightIndex{}; lightIndex < amountOfLights; ++lightIndex)
+			{
+				const Light& light{ lights[lightIndex] };
+				if (!HasFiniteRadius(light)) continue;
+
+				int minCell[3]{};
+				int maxCell[3]{};
+				for (int axis{}; axis < 3; ++axis)
+				{
+					minCell[axis] = std::clamp(static_cast<int>((light.origin[axis] - light.radius - m_Min[axis]) * m_InverseCellSize), 0, m_Dimensions[axis] - 1);
+					maxCell[axis] = std::clamp(static_cast<int>((light.origin[axis] + light.radius - m_Min[axis]) * m_InverseCellSize), 0, m_Dimensions[axis] - 1);
+				}
+
+				const float sqrRadius{ light.radius * light.radius };
+				for (int z{ minCell[2] }; z <= maxCell[2]; ++z)
+				{
+					for (int y{ minCell[1] }; y <= maxCell[1]; ++y)
+					{
+						for (int x{ minCell[0] }; x <= maxCell[0]; ++x)
+						{
+							//sphere - cell overlap, distance from the light to the closest point of the cell
+							const Vector3 cellMin{ m_Min + Vector3{ static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) } * cellSize };
+							const Vector3 closestPoint{ Vector3::Max(cellMin, Vector3::Min(light.origin, cellMin + Vector3{ cellSize, cellSize, cellSize })) };
+							if ((closestPoint - light.origin).SqrMagnitude() > sqrRadius) continue;
+
+							const size_t cellIndex{ x + static_cast<size_t>(m_Dimensions[0]) * (y + static_cast<size_t>(m_Dimensions[1]) * z) };
+							if (pass == 0) ++m_CellOffsets[cellIndex + 1];
+							else m_CellLights[m_CellOffsets[cellIndex]++] = lightIndex;
+						}
+					}
+				}
+			}
+
+			if (pass == 0)
+			{
+				for (size_t cellIndex{ 1 }; cellIndex <= amountOfCells; ++cellIndex)
+				{
+					m_MaxLightsPerCell = std::max(m_MaxLightsPerCell, m_CellOffsets[cellIndex]);
+					m_CellOffsets[cellIndex] += m_CellOffsets[cellIndex - 1];
+				}
+
+				m_CellLights.resize(m_CellOffsets[amountOfCells]);
+			}
+		}
+
+		//writing moved every offset to the end of its cell, shift them back to the start
+		for (size_t cellIndex{ amountOfCells }; cellIndex > 0; --cellIndex)
+		{
+			m_CellOffsets[cellIndex] = m_CellOffsets[cellIndex - 1];
+		}
+		m_CellOffsets[0] = 0;
+	}
+
+	int LightGrid::GetCellIndex(const Vector3& position) const
+	{
+		if (m_CellOffsets.empty()) return -1;
+
+		int cell[3]{};
+		for (int axis{}; axis < 3; ++axis)
+		{
+			const float cellCoordinate{ (position[axis] - m_Min[axis]) * m_InverseCellSize };
+			if (!(cellCoordinate >= 0.f) || cellCoordinate >= static_cast<float>(m_Dimensions[axis])) return -1;
+
+			cell[axis] = static_cast<int>(cellCoordinate);
+		}
+
+		return cell[0] + m_Dimensions[0] * (cell[1] + m_Dimensions[1] * cell[2]);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	struct Light;
+
+	//Uniform world space grid of light index lists, rebuilt every frame by the renderer
+	//Point lights with a finite radius are stored in every cell their influence sphere overlaps,
+	//lights without a radius (and directional lights) reach every point and are kept in one global list
+	class LightGrid final
+	{
+	public:
+		void Build(const std::vector<Light>& lights);
+
+		//Calls function(lightIndex) for every light that can reach position, global lights first (in scene order)
+		template<typename Function>
+		void ForEachLight(const Vector3& position, const Function& function) const
+		{
+			for (const uint32_t lightIndex : m_GlobalLights)
+			{
+				function(lightIndex);
+			}
+
+			const int cellIndex{ GetCellIndex(position) };
+			if (cellIndex < 0) return;
+
+			const uint32_t lastIndex{ m_CellOffsets[cellIndex + 1] };
+			for (uint32_t index{ m_CellOffsets[cellIndex] }; index < lastIndex; ++index)
+			{
+				function(m_CellLights[index]);
+			}
+		}
+
+		//Most lights ForEachLight can call the function with, at any position
+		uint32_t GetMaxLightsPerPosition() const { return static_cast<uint32_t>(m_GlobalLights.size()) + m_MaxLightsPerCell; }
+
+	private:
+		static constexpr int MAX_CELLS_PER_AXIS{ 64 };
+
+		std::vector<uint32_t> m_GlobalLights{};
+
+		//compact lists, the lights of cell i are m_CellLights[m_CellOffsets[i] > m_CellOffsets[i + 1]]
+		std::vector<uint32_t> m_CellOffsets{};
+		std::vector<uint32_t> m_CellLights{};
+		uint32_t m_MaxLightsPerCell{};
+
+		Vector3 m_Min{};
+		float m_InverseCellSize{};
+		int m_Dimensions[3]{};
+
+		int GetCellIndex(const Vector3& position) const;
+	};
+}
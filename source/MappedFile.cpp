@@ -0,0 +1,129 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+	MappedFile::MappedFile(const std::string& filename)
+	{
+		Open(filename);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this == &other) return *this;
+
+		Close();
+
+		std::swap(m_pData, other.m_pData);
+		std::swap(m_Size, other.m_Size);
+#ifdef _WIN32
+		std::swap(m_FileHandle, other.m_FileHandle);
+		std::swap(m_MappingHandle, other.m_MappingHandle);
+#endif
+		return *this;
+	}
+
+#ifdef _WIN32
+	bool MappedFile::Open(const std::string& filename)
+	{
+		Close();
+
+		HANDLE file{ CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+		if (!mapping)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		void* pView{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+		if (!pView)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_FileHandle = file;
+		m_MappingHandle = mapping;
+		m_pData = static_cast<const char*>(pView);
+		m_Size = static_cast<size_t>(size.QuadPart);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_pData) UnmapViewOfFile(m_pData);
+		if (m_MappingHandle) CloseHandle(m_MappingHandle);
+		if (m_FileHandle) CloseHandle(m_FileHandle);
+
+		m_pData = nullptr;
+		m_Size = 0;
+		m_MappingHandle = nullptr;
+		m_FileHandle = nullptr;
+	}
+#else
+	bool MappedFile::Open(const std::string& filename)
+	{
+		Close();
+
+		const int file{ open(filename.c_str(), O_RDONLY) };
+		if (file == -1) return false;
+
+		struct stat fileStat{};
+		if (fstat(file, &fileStat) == -1 || fileStat.st_size == 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void* pView{ mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0) };
+		close(file); //the mapping keeps its own reference to the file
+
+		if (pView == MAP_FAILED) return false;
+
+		m_pData = static_cast<const char*>(pView);
+		m_Size = static_cast<size_t>(fileStat.st_size);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_pData) munmap(const_cast<char*>(m_pData), m_Size);
+
+		m_pData = nullptr;
+		m_Size = 0;
+	}
+#endif
+}
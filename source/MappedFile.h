@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace dae
+{
+	//Read-only memory mapping of a whole file, the pages are loaded by the OS when they are first touched
+	class MappedFile final
+	{
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const std::string& filename);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		bool Open(const std::string& filename);
+		void Close();
+
+		bool IsOpen() const { return m_pData != nullptr; }
+		const char* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+
+	private:
+		const char* m_pData{ nullptr };
+		size_t m_Size{};
+
+#ifdef _WIN32
+		void* m_FileHandle{ nullptr };
+		void* m_MappingHandle{ nullptr };
+#endif
+	};
+}
@@ -1,7 +1,11 @@
 #pragma once
+#include <cfloat>
+#include <type_traits>
 #include "Math.h"
 #include "DataTypes.h"
 #include "BRDFs.h"
+#include "BRDFBatch.h"
+#include "BRDFTables.h"
 
 namespace dae
 {
@@ -15,11 +19,28 @@ namespace dae
 		{
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
+		ColorRGB Shade(const HitRecord&, const Vector3&, const Vector3&) const
 		{
 			return m_Color;
 		}
 
+		float GetMaxBRDF() const
+		{
+			return std::max(m_Color.r, std::max(m_Color.g, m_Color.b));
+		}
+
+		void SetBatchLane(ShadingBatch& batch, int lane) const
+		{
+			batch.color.Set(lane, m_Color);
+		}
+
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
+		static void ShadeBatch(const ShadingBatch& batch, ColorRGBBatch& result)
+		{
+			BRDF::Batch::SolidColor(batch, result);
+		}
+
 	private:
 		ColorRGB m_Color{colors::White};
 	};
@@ -34,11 +55,29 @@ namespace dae
 		Material_Lambert(const ColorRGB& diffuseColor, float diffuseReflectance) :
 			m_DiffuseColor(diffuseColor), m_DiffuseReflectance(diffuseReflectance){}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) const
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
+		ColorRGB Shade(const HitRecord& = {}, const Vector3& = {}, const Vector3& = {}) const
 		{
 			return{ BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor)};
 		}
 
+		float GetMaxBRDF() const
+		{
+			return m_DiffuseReflectance * std::max(m_DiffuseColor.r, std::max(m_DiffuseColor.g, m_DiffuseColor.b)) / static_cast<float>(M_PI);
+		}
+
+		void SetBatchLane(ShadingBatch& batch, int lane) const
+		{
+			batch.color.Set(lane, m_DiffuseColor);
+			batch.diffuseReflectance[lane] = m_DiffuseReflectance;
+		}
+
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
+		static void ShadeBatch(const ShadingBatch& batch, ColorRGBBatch& result)
+		{
+			BRDF::Batch::Lambert(batch, result);
+		}
+
 	private:
 		ColorRGB m_DiffuseColor{colors::White};
 		float m_DiffuseReflectance{1.f}; //kd
@@ -57,10 +96,31 @@ namespace dae
 		{
 		}
 
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
 		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) const
 		{
 			return{  BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor)
-				   + BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, -v, hitRecord.normal)};
+				   + BRDF::Phong<precision>(m_SpecularReflectance, m_PhongExponent, l, -v, hitRecord.normal)};
+		}
+
+		//the cosine in the phong lobe is at most 1
+		float GetMaxBRDF() const
+		{
+			return m_DiffuseReflectance * std::max(m_DiffuseColor.r, std::max(m_DiffuseColor.g, m_DiffuseColor.b)) / static_cast<float>(M_PI) + m_SpecularReflectance;
+		}
+
+		void SetBatchLane(ShadingBatch& batch, int lane) const
+		{
+			batch.color.Set(lane, m_DiffuseColor);
+			batch.diffuseReflectance[lane] = m_DiffuseReflectance;
+			batch.specularReflectance[lane] = m_SpecularReflectance;
+			batch.phongExponent[lane] = m_PhongExponent;
+		}
+
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
+		static void ShadeBatch(const ShadingBatch& batch, ColorRGBBatch& result)
+		{
+			BRDF::Batch::LambertPhong<precision>(batch, result);
 		}
 
 	private:
@@ -77,29 +137,169 @@ namespace dae
 	{
 	public:
 		Material_CookTorrence(const ColorRGB& albedo, float metalness, float roughness):
-			m_Albedo(albedo), m_Metalness(metalness), m_Roughness(roughness)
+			m_Albedo(albedo), m_Metalness(metalness), m_Roughness(roughness), m_pTable(BRDF::Tables::Get(roughness))
 		{
 		}
 
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
 		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) const
 		{
 			const Vector3 normal{ hitRecord.normal };
+			const Vector3 toView{ -v };
 
-			const Vector3 halfVector{ (-v + l).Normalized() };
+			//shared by the geometry term and the microfacet denominator
+			const float nDotV{ Vector3::Dot(normal, toView) };
+			const float nDotL{ Vector3::Dot(normal, l) };
 
-			const ColorRGB fersnel{ BRDF::FresnelFunction_Schlick(halfVector, -v, (m_Metalness == 0.f) ? ColorRGB{0.04f, 0.04f, 0.04f} : m_Albedo) };
+			const Vector3 halfVector{ FastMath::Normalized<precision>(toView + l) };
 
-			ColorRGB fng{ fersnel * BRDF::NormalDistribution_GGX(normal, halfVector, m_Roughness) * BRDF::GeometryFunction_Smith(normal, -v, l, m_Roughness) };
+			const ColorRGB fersnel{ BRDF::FresnelFunction_Schlick(std::max(Vector3::Dot(halfVector, toView), 0.f), (m_Metalness == 0.f) ? ColorRGB{0.04f, 0.04f, 0.04f} : m_Albedo) };
+
+			const float clampedNDotH{ std::max(Vector3::Dot(normal, halfVector), 0.f) };
+			float normalDistribution{};
+			float geometry{};
+			if constexpr (precision == ShadingPrecision::Tabulated)
+			{
+				normalDistribution = BRDF::Tables::NormalDistribution_GGX(*m_pTable, clampedNDotH);
+				geometry = BRDF::Tables::GeometryFunction_SchlickGGX(*m_pTable, std::max(nDotV, 0.f)) * BRDF::Tables::GeometryFunction_SchlickGGX(*m_pTable, std::max(nDotL, 0.f));
+			}
+			else
+			{
+				normalDistribution = BRDF::NormalDistribution_GGX<precision>(clampedNDotH, m_Roughness);
+				geometry = BRDF::GeometryFunction_SchlickGGX<precision>(std::max(nDotV, 0.f), m_Roughness) * BRDF::GeometryFunction_SchlickGGX<precision>(std::max(nDotL, 0.f), m_Roughness);
+			}
+
+			ColorRGB fng{ fersnel * normalDistribution * geometry };
 			 
 			const ColorRGB kd = (m_Metalness == 0.f) ? ColorRGB{ 1.f, 1.f, 1.f } - fersnel : ColorRGB{0.f, 0.f, 0.f};
 
-			return { fng / (4 * (Vector3::Dot(-v, normal) * Vector3::Dot(l, normal))) + BRDF::Lambert(kd, m_Albedo) };
+			if constexpr (precision == ShadingPrecision::Fast) return { fng * FastMath::Reciprocal(4 * (nDotV * nDotL)) + BRDF::Lambert(kd, m_Albedo) };
+			else return { fng / (4 * (nDotV * nDotL)) + BRDF::Lambert(kd, m_Albedo) };
+		}
+
+		//the specular term divides by Dot(n, v) * Dot(n, l) so it has no finite bound at grazing angles
+		float GetMaxBRDF() const
+		{
+			return FLT_MAX;
+		}
+
+		void SetBatchLane(ShadingBatch& batch, int lane) const
+		{
+			batch.color.Set(lane, m_Albedo);
+			batch.metalness[lane] = m_Metalness;
+			batch.roughness[lane] = m_Roughness;
+			batch.pCookTorranceTable[lane] = m_pTable;
+		}
+
+		template<ShadingPrecision precision = ShadingPrecision::Exact>
+		static void ShadeBatch(const ShadingBatch& batch, ColorRGBBatch& result)
+		{
+			BRDF::Batch::CookTorrence<precision>(batch, result);
 		}
 		
 	private:
 		ColorRGB m_Albedo{0.955f, 0.637f, 0.538f}; //Copper
 		float m_Metalness{1.0f};
 		float m_Roughness{0.1f}; // [1.0 > 0.0] >> [ROUGH > SMOOTH]
+		const CookTorranceTable* m_pTable{}; //shared with every material of the same roughness
+	};
+#pragma endregion
+
+#pragma region Material TABLE ENTRY
+	//Tagged material stored by value in the scene's material table, HitRecord::materialId indexes that table
+	struct Material final
+	{
+		Material(const Material_SolidColor& material) : type{ MaterialType::solidColor }, solidColor{ material } {}
+		Material(const Material_Lambert& material) : type{ MaterialType::lambert }, lambert{ material } {}
+		Material(const Material_LambertPhong& material) : type{ MaterialType::lambertPhong }, lambertPhong{ material } {}
+		Material(const Material_CookTorrence& material) : type{ MaterialType::cookTorrence }, cookTorrence{ material } {}
+
+		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
+		{
+			switch (type)
+			{
+			case MaterialType::solidColor:
+				return solidColor.Shade(hitRecord, l, v);
+			case MaterialType::lambert:
+				return lambert.Shade(hitRecord, l, v);
+			case MaterialType::lambertPhong:
+				return lambertPhong.Shade(hitRecord, l, v);
+			case MaterialType::cookTorrence:
+				return cookTorrence.Shade(hitRecord, l, v);
+			}
+
+			return {};
+		}
+
+		//Shade for a material type known at compile time (type has to match)
+		template<MaterialType materialType, ShadingPrecision precision = ShadingPrecision::Exact>
+		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
+		{
+			assert(type == materialType);
+
+			if constexpr (materialType == MaterialType::solidColor) return solidColor.Shade<precision>(hitRecord, l, v);
+			else if constexpr (materialType == MaterialType::lambert) return lambert.Shade<precision>(hitRecord, l, v);
+			else if constexpr (materialType == MaterialType::lambertPhong) return lambertPhong.Shade<precision>(hitRecord, l, v);
+			else return cookTorrence.Shade<precision>(hitRecord, l, v);
+		}
+
+		//Upper bound of Shade over all light and view directions
+		float GetMaxBRDF() const
+		{
+			switch (type)
+			{
+			case MaterialType::solidColor:
+				return solidColor.GetMaxBRDF();
+			case MaterialType::lambert:
+				return lambert.GetMaxBRDF();
+			case MaterialType::lambertPhong:
+				return lambertPhong.GetMaxBRDF();
+			case MaterialType::cookTorrence:
+				return cookTorrence.GetMaxBRDF();
+			}
+
+			return FLT_MAX;
+		}
+
+		//Copies this material's parameters into one lane of a shading batch
+		void SetBatchLane(ShadingBatch& batch, int lane) const
+		{
+			switch (type)
+			{
+			case MaterialType::solidColor:
+				solidColor.SetBatchLane(batch, lane);
+				break;
+			case MaterialType::lambert:
+				lambert.SetBatchLane(batch, lane);
+				break;
+			case MaterialType::lambertPhong:
+				lambertPhong.SetBatchLane(batch, lane);
+				break;
+			case MaterialType::cookTorrence:
+				cookTorrence.SetBatchLane(batch, lane);
+				break;
+			}
+		}
+
+		//Shades all lanes of a batch at once, every lane has to hold a material of materialType
+		template<MaterialType materialType, ShadingPrecision precision = ShadingPrecision::Exact>
+		static void ShadeBatch(const ShadingBatch& batch, ColorRGBBatch& result)
+		{
+			if constexpr (materialType == MaterialType::solidColor) Material_SolidColor::ShadeBatch<precision>(batch, result);
+			else if constexpr (materialType == MaterialType::lambert) Material_Lambert::ShadeBatch<precision>(batch, result);
+			else if constexpr (materialType == MaterialType::lambertPhong) Material_LambertPhong::ShadeBatch<precision>(batch, result);
+			else Material_CookTorrence::ShadeBatch<precision>(batch, result);
+		}
+
+		MaterialType type;
+		union
+		{
+			Material_SolidColor solidColor;
+			Material_Lambert lambert;
+			Material_LambertPhong lambertPhong;
+			Material_CookTorrence cookTorrence;
+		};
 	};
+	static_assert(std::is_trivially_copyable_v<Material>, "the material table is copied and stored as plain data");
 #pragma endregion
 }
\ No newline at end of file
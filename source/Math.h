@@ -1,6 +1,7 @@
 #pragma once
 #include "Vector3.h"
 #include "Vector4.h"
+#include "SIMD.h"
 #include "Matrix.h"
 #include "ColorRGB.h"
 #include "MathHelpers.h"
@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <cstdint>
 
 namespace dae
 {
@@ -27,4 +28,20 @@ namespace dae
 	{
 		return abs(a - b) < epsilon;
 	}
+
+	/* --- RANDOM --- */
+	//PCG hash, also usable to combine seeds (Hash(a ^ Hash(b)))
+	inline uint32_t Hash(uint32_t value)
+	{
+		const uint32_t state{ value * 747796405u + 2891336453u };
+		const uint32_t word{ ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u };
+		return (word >> 22u) ^ word;
+	}
+
+	//Uniform float in [0, 1), advances state
+	inline float RandomFloat(uint32_t& state)
+	{
+		state = Hash(state);
+		return static_cast<float>(state >> 8) * (1.f / 16777216.f);
+	}
 }
\ No newline at end of file
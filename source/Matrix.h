@@ -1,52 +1,217 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+
 #include "Vector3.h"
 #include "Vector4.h"
+#include "SIMD.h"
 
 namespace dae {
 	struct Matrix
 	{
 		Matrix() = default;
-		Matrix(
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
-			const Vector3& t);
+			const Vector3& t) :
+			Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+		{
+		}
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
-			const Vector4& t);
-
-		Matrix(const Matrix& m);
-
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
-		const Matrix& Transpose();
-		float Determinant() const;
-
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
-
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
-
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+			const Vector4& t) :
+			data{ xAxis, yAxis, zAxis, t }
+		{
+		}
+
+		constexpr Matrix(const Matrix& m) = default;
+		constexpr Matrix& operator=(const Matrix& m) = default;
+
+		constexpr Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(v.x, v.y, v.z);
+		}
+
+		constexpr Vector3 TransformVector(float x, float y, float z) const
+		{
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z,
+				data[0].y * x + data[1].y * y + data[2].y * z,
+				data[0].z * x + data[1].z * y + data[2].z * z
+			};
+		}
+
+		constexpr Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z);
+		}
+
+		constexpr Vector3 TransformPoint(float x, float y, float z) const
+		{
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+				data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+				data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+			};
+		}
+
+		const Matrix& Transpose()
+		{
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = data[c][r];
+				}
+			}
+
+			data[0] = result[0];
+			data[1] = result[1];
+			data[2] = result[2];
+			data[3] = result[3];
+
+			return *this;
+		}
+
+		constexpr float Determinant() const
+		{
+			return data[0].x * (data[1].y * data[2].z - data[1].z * data[2].y)
+				 - data[0].y * (data[1].x * data[2].z - data[1].z * data[2].x)
+				 + data[0].z * (data[1].x * data[2].y - data[1].y * data[2].x);
+		}
+
+		constexpr Vector3 GetAxisX() const { return data[0]; }
+		constexpr Vector3 GetAxisY() const { return data[1]; }
+		constexpr Vector3 GetAxisZ() const { return data[2]; }
+		constexpr Vector3 GetTranslation() const { return data[3]; }
+
+		static constexpr Matrix CreateTranslation(float x, float y, float z)
+		{
+			return
+			{
+				{ 1.f, 0.f, 0.f, 0.f },
+				{ 0.f, 1.f, 0.f, 0.f },
+				{ 0.f, 0.f, 1.f, 0.f },
+				{ x, y, z, 1.f }
+			};
+		}
+
+		static constexpr Matrix CreateTranslation(const Vector3& t)
+		{
+			return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+		}
+
+		static Matrix CreateRotationX(float pitch)
+		{
+			const float cosPitch{ std::cos(pitch) };
+			const float sinPitch{ std::sin(pitch) };
+			return
+			{
+				{ 1.f, 0.f, 0.f, 0.f },
+				{ 0.f, cosPitch, -sinPitch, 0.f },
+				{ 0.f, sinPitch, cosPitch, 0.f },
+				{ 0.f, 0.f, 0.f, 1.f }
+			};
+		}
+
+		static Matrix CreateRotationY(float yaw)
+		{
+			const float cosYaw{ std::cos(yaw) };
+			const float sinYaw{ std::sin(yaw) };
+			return
+			{
+				{ cosYaw, 0.f, -sinYaw, 0.f },
+				{ 0.f, 1.f, 0.f, 0.f },
+				{ sinYaw, 0.f, cosYaw, 0.f },
+				{ 0.f, 0.f, 0.f, 1.f }
+			};
+		}
+
+		static Matrix CreateRotationZ(float roll)
+		{
+			const float cosRoll{ std::cos(roll) };
+			const float sinRoll{ std::sin(roll) };
+			return
+			{
+				{ cosRoll, sinRoll, 0.f, 0.f },
+				{ -sinRoll, cosRoll, 0.f, 0.f },
+				{ 0.f, 0.f, 1.f, 0.f },
+				{ 0.f, 0.f, 0.f, 1.f }
+			};
+		}
+
+		static Matrix CreateRotation(const Vector3& r)
+		{
+			return { CreateRotationX(r.x) * CreateRotationY(r.y) * CreateRotationZ(r.z) };
+		}
+
+		static Matrix CreateRotation(float pitch, float yaw, float roll)
+		{
+			return CreateRotation({ pitch, yaw, roll });
+		}
+
+		static constexpr Matrix CreateScale(float sx, float sy, float sz)
+		{
+			return
+			{
+				{ sx, 0.f, 0.f, 0.f },
+				{ 0.f, sy, 0.f, 0.f },
+				{ 0.f, 0.f, sz, 0.f },
+				{ 0.f, 0.f, 0.f, 1.f }
+			};
+		}
+
+		static constexpr Matrix CreateScale(const Vector3& s)
+		{
+			return CreateScale(s.x, s.y, s.z);
+		}
+
+		static Matrix Transpose(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Transpose();
+
+			return out;
+		}
+
+		constexpr Vector4& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Vector4 operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		Matrix operator*(const Matrix& m) const
+		{
+			Matrix result{};
+			const Matrix m_transposed{ Transpose(m) };
+
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
+				}
+			}
+
+			return result;
+		}
+
+		const Matrix& operator*=(const Matrix& m)
+		{
+			*this = *this * m;
+			return *this;
+		}
 
 	private:
 
@@ -64,4 +229,43 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
-}
\ No newline at end of file
+
+	//3x4 affine transform (no projection row), each of the 4 columns sits in one SSE register so a transform is
+	//3 multiplies and 2 or 3 adds on whole registers, the results match Matrix::TransformVector/TransformPoint exactly
+	struct AffineMatrix
+	{
+		AffineMatrix() = default;
+		explicit AffineMatrix(const Matrix& m) :
+			axisX{ m.GetAxisX() },
+			axisY{ m.GetAxisY() },
+			axisZ{ m.GetAxisZ() },
+			translation{ m.GetTranslation() }
+		{
+		}
+
+		Float4 TransformVector(const Float4& v) const
+		{
+			return axisX * v.SplatX() + axisY * v.SplatY() + axisZ * v.SplatZ();
+		}
+
+		Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(Float4{ v }).ToVector3();
+		}
+
+		Float4 TransformPoint(const Float4& p) const
+		{
+			return axisX * p.SplatX() + axisY * p.SplatY() + axisZ * p.SplatZ() + translation;
+		}
+
+		Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(Float4{ p }).ToVector3();
+		}
+
+		Float4 axisX{ 1.f, 0.f, 0.f, 0.f };
+		Float4 axisY{ 0.f, 1.f, 0.f, 0.f };
+		Float4 axisZ{ 0.f, 0.f, 1.f, 0.f };
+		Float4 translation{ 0.f, 0.f, 0.f, 0.f };
+	};
+}
@@ -0,0 +1,270 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DataTypes.h"
+#include "MappedFile.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace
+	{
+		constexpr char MESH_CACHE_MAGIC[8]{ 'D', 'A', 'E', 'M', 'E', 'S', 'H', '\0' };
+		constexpr uint32_t MESH_CACHE_VERSION{ 4 };
+		constexpr uint64_t MESH_CACHE_ALIGNMENT{ 16 };
+
+		struct MeshCacheHeader
+		{
+			char magic[8];
+			uint32_t version;
+
+			//layout checks, the arrays are stored exactly as they are in memory
+			uint32_t vector3Size;
+			uint32_t bvhNodeSize;
+			uint32_t indexSize;
+
+			//source obj, the cache is stale when the obj changed
+			uint64_t objSize;
+			int64_t objWriteTime;
+
+			uint64_t amountOfPositions;
+			uint64_t amountOfIndices;
+			uint64_t amountOfNormals;
+			uint64_t amountOfBVHNodes;
+			int32_t amountOfUsedNodes;
+			int32_t rootNodeIndex;
+			int32_t bvhLeafSize;
+
+			Vector3 minAABB;
+			Vector3 maxAABB;
+
+			uint64_t positionsOffset;
+			uint64_t indicesOffset;
+			uint64_t normalsOffset;
+			uint64_t bvhNodesOffset;
+		};
+
+		uint64_t AlignOffset(uint64_t offset)
+		{
+			return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+		}
+
+		bool GetObjStamp(const std::string& objFilename, uint64_t& size, int64_t& writeTime)
+		{
+			std::error_code error{};
+			size = std::filesystem::file_size(objFilename, error);
+			if (error) return false;
+
+			const auto lastWriteTime{ std::filesystem::last_write_time(objFilename, error) };
+			if (error) return false;
+
+			writeTime = static_cast<int64_t>(lastWriteTime.time_since_epoch().count());
+			return true;
+		}
+
+		template<typename T>
+		bool CopyArray(const MappedFile& file, uint64_t offset, uint64_t amount, std::vector<T>& destination)
+		{
+			//without overflowing on damaged values
+			if (offset > file.GetSize() || amount > (file.GetSize() - offset) / sizeof(T)) return false;
+
+			destination.resize(static_cast<size_t>(amount));
+			if (amount > 0) std::memcpy(destination.data(), file.GetData() + offset, static_cast<size_t>(amount * sizeof(T)));
+			return true;
+		}
+
+		template<typename T>
+		void WriteArray(std::ofstream& file, uint64_t offset, const T* pData, uint64_t amount)
+		{
+			//pad up to the aligned offset
+			static constexpr char padding[MESH_CACHE_ALIGNMENT]{};
+			const uint64_t currentOffset{ static_cast<uint64_t>(file.tellp()) };
+			file.write(padding, static_cast<std::streamsize>(offset - currentOffset));
+
+			file.write(reinterpret_cast<const char*>(pData), static_cast<std::streamsize>(amount * sizeof(T)));
+		}
+	}
+
+	namespace Utils
+	{
+		bool LoadTriangleMeshCached(const std::string& objFilename, TriangleMesh& mesh, const std::function<void(const TriangleMesh&)>& onGeometryLoaded)
+		{
+			const std::string cacheFilename{ objFilename + ".meshcache" };
+
+			if (ReadMeshCache(cacheFilename, objFilename, mesh))
+			{
+				//the stored bvh bounds the object space positions
+				mesh.UpdateTransforms();
+				if (mesh.useBVH) mesh.RefitBVH();
+				if (onGeometryLoaded) onGeometryLoaded(mesh);
+				if (mesh.compressOnLoad) mesh.Compress();
+				return true;
+			}
+
+			mesh.positions.clear();
+			mesh.normals.clear();
+			mesh.indices.clear();
+
+			if (!ParseOBJ(objFilename, mesh.positions, mesh.normals, mesh.indices)) return false;
+
+			mesh.UpdateAABB();
+			mesh.UpdateTransforms();
+
+			if (onGeometryLoaded) onGeometryLoaded(mesh);
+
+			//the cache stores the complete tree, so it can not be built lazily here. It is built in object space so one cache
+			//fits every transform of the mesh, the transforms are put back and the bounds refit once it is written
+			const Matrix rotationTransform{ mesh.rotationTransform };
+			const Matrix translationTransform{ mesh.translationTransform };
+			const Matrix scaleTransform{ mesh.scaleTransform };
+			if (mesh.useBVH)
+			{
+				mesh.lazyBVH = false;
+
+				mesh.rotationTransform = Matrix{};
+				mesh.translationTransform = Matrix{};
+				mesh.scaleTransform = Matrix{};
+				mesh.UpdateTransforms();
+
+				mesh.BuildBVH();
+			}
+
+			//failing to write the cache is not an error, the mesh is loaded
+			WriteMeshCache(cacheFilename, objFilename, mesh);
+
+			if (mesh.useBVH)
+			{
+				mesh.rotationTransform = rotationTransform;
+				mesh.translationTransform = translationTransform;
+				mesh.scaleTransform = scaleTransform;
+				mesh.UpdateTransforms();
+				mesh.RefitBVH();
+			}
+
+			//the cache holds the float attributes, compressing is fast enough to redo on every load
+			if (mesh.compressOnLoad) mesh.Compress();
+			return true;
+		}
+
+		bool ReadMeshCache(const std::string& cacheFilename, const std::string& objFilename, TriangleMesh& mesh)
+		{
+			const MappedFile file{ cacheFilename };
+			if (!file.IsOpen() || file.GetSize() < sizeof(MeshCacheHeader)) return false;
+
+			MeshCacheHeader header{};
+			std::memcpy(&header, file.GetData(), sizeof(MeshCacheHeader));
+
+			if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0) return false;
+			if (header.version != MESH_CACHE_VERSION) return false;
+			if (header.vector3Size != sizeof(Vector3) || header.bvhNodeSize != sizeof(BVHNode) || header.indexSize != sizeof(int)) return false;
+
+			uint64_t objSize{};
+			int64_t objWriteTime{};
+			if (GetObjStamp(objFilename, objSize, objWriteTime) && (objSize != header.objSize || objWriteTime != header.objWriteTime)) return false;
+
+			//a mesh without bvh can not use a cache that has one and the other way around
+			if ((header.amountOfBVHNodes > 0) != mesh.useBVH) return false;
+			//nor one built for the leaf size of another instruction set
+			if (mesh.useBVH && header.bvhLeafSize != mesh.bvhLeafSize) return false;
+
+			if (!CopyArray(file, header.positionsOffset, header.amountOfPositions, mesh.positions)) return false;
+			if (!CopyArray(file, header.indicesOffset, header.amountOfIndices, mesh.indices)) return false;
+			if (!CopyArray(file, header.normalsOffset, header.amountOfNormals, mesh.normals)) return false;
+			if (!CopyArray(file, header.bvhNodesOffset, header.amountOfBVHNodes, mesh.bvhNodes)) return false;
+
+			//a damaged cache is rejected here instead of reading out of bounds while rendering: one normal per triangle, every index a
+			//position, every bvh leaf a range of triangles
+			if (mesh.indices.size() % 3 != 0 || mesh.indices.size() / 3 > INT_MAX || mesh.normals.size() != mesh.indices.size() / 3) return false;
+
+			const int amountOfPositions{ static_cast<int>(std::min<size_t>(mesh.positions.size(), INT_MAX)) };
+			for (const int index : mesh.indices)
+			{
+				if (index < 0 || index >= amountOfPositions) return false;
+			}
+
+			if (mesh.useBVH)
+			{
+				if (header.amountOfUsedNodes < 1 || static_cast<uint64_t>(header.amountOfUsedNodes) != header.amountOfBVHNodes) return false;
+				if (header.rootNodeIndex < 0 || header.rootNodeIndex >= header.amountOfUsedNodes) return false;
+				if (!AreBVHNodesValid(mesh.bvhNodes, static_cast<int>(mesh.indices.size() / 3))) return false;
+			}
+
+			mesh.minAABB = header.minAABB;
+			mesh.maxAABB = header.maxAABB;
+			mesh.amountOfUsedNodes = header.amountOfUsedNodes;
+			mesh.rootNodeIndex = header.rootNodeIndex;
+
+			//the stored tree is complete
+			mesh.lazyBVH = false;
+
+			return true;
+		}
+
+		bool WriteMeshCache(const std::string& cacheFilename, const std::string& objFilename, const TriangleMesh& mesh)
+		{
+			MeshCacheHeader header{};
+			std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+			header.version = MESH_CACHE_VERSION;
+			header.vector3Size = sizeof(Vector3);
+			header.bvhNodeSize = sizeof(BVHNode);
+			header.indexSize = sizeof(int);
+
+			if (!GetObjStamp(objFilename, header.objSize, header.objWriteTime)) return false;
+
+			header.amountOfPositions = mesh.positions.size();
+			header.amountOfIndices = mesh.indices.size();
+			header.amountOfNormals = mesh.normals.size();
+			header.amountOfBVHNodes = mesh.useBVH ? static_cast<uint64_t>(mesh.amountOfUsedNodes) : 0;
+			header.amountOfUsedNodes = mesh.amountOfUsedNodes;
+			header.rootNodeIndex = mesh.rootNodeIndex;
+			header.bvhLeafSize = mesh.bvhLeafSize;
+			header.minAABB = mesh.minAABB;
+			header.maxAABB = mesh.maxAABB;
+
+			header.positionsOffset = AlignOffset(sizeof(MeshCacheHeader));
+			header.indicesOffset = AlignOffset(header.positionsOffset + header.amountOfPositions * sizeof(Vector3));
+			header.normalsOffset = AlignOffset(header.indicesOffset + header.amountOfIndices * sizeof(int));
+			header.bvhNodesOffset = AlignOffset(header.normalsOffset + header.amountOfNormals * sizeof(Vector3));
+
+			//another load can have the cache mapped, so it is written next to it and renamed over it once complete
+			const std::string tempFilename{ cacheFilename + '.' + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp" };
+			{
+				std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+				if (!file) return false;
+
+				file.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheHeader));
+				WriteArray(file, header.positionsOffset, mesh.positions.data(), header.amountOfPositions);
+				WriteArray(file, header.indicesOffset, mesh.indices.data(), header.amountOfIndices);
+				WriteArray(file, header.normalsOffset, mesh.normals.data(), header.amountOfNormals);
+				WriteArray(file, header.bvhNodesOffset, mesh.bvhNodes.data(), header.amountOfBVHNodes);
+
+				file.close();
+				if (!file)
+				{
+					std::error_code error{};
+					std::filesystem::remove(tempFilename, error);
+					return false;
+				}
+			}
+
+			std::error_code error{};
+			std::filesystem::rename(tempFilename, cacheFilename, error);
+			if (error)
+			{
+				std::filesystem::remove(tempFilename, error);
+				return false;
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <functional>
+#include <string>
+
+namespace dae
+{
+	struct TriangleMesh;
+
+	namespace Utils
+	{
+		//Binary mesh cache stored next to the obj ("<objFilename>.meshcache"), it holds the positions, indices, normals and the built bvh
+		//in the same layout as TriangleMesh so loading it is a memory map plus one bulk copy per array
+		//The cached bvh is built in object space so one cache serves every transform of the mesh, it is refit to the transforms set
+		//before calling this
+		//The cache is written to a temporary file and renamed over the old one, a load that has it mapped keeps reading the old data
+		//onGeometryLoaded is called as soon as the positions and AABB are known, before the (slow) bvh build
+		//With mesh.compressOnLoad set the mesh is compressed at the end (see TriangleMesh::Compress), the cache keeps the float attributes
+		bool LoadTriangleMeshCached(const std::string& objFilename, TriangleMesh& mesh, const std::function<void(const TriangleMesh&)>& onGeometryLoaded = nullptr);
+
+		bool ReadMeshCache(const std::string& cacheFilename, const std::string& objFilename, TriangleMesh& mesh);
+		bool WriteMeshCache(const std::string& cacheFilename, const std::string& objFilename, const TriangleMesh& mesh);
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+namespace dae
+{
+	//Turns the integers of a compressed mesh (see CompressedTriangles) into world space floats, rebuilt with the transforms
+	struct TriangleDecoder
+	{
+		float position[3][4]{}; //[axis][column], world = column 0 * x + column 1 * y + column 2 * z + column 3 with the 16 bit coordinates
+		float normal[3][3]{}; //[axis][column], the transform without translation
+	};
+
+	//Encoding and decoding of compressed meshes
+	//Internal linkage and plain floats only, the kernel translation units decode with the same operations as the baseline (see Kernels.h)
+	namespace MeshCompression
+	{
+		constexpr float QUANTIZATION_STEPS{ 65535.f };
+
+#pragma region ENCODE
+		//value in [min, min + extent] to [0, 65535], max error extent / 131070
+		static uint16_t QuantizeCoordinate(float value, float min, float extent)
+		{
+			if (extent <= 0.f) return 0;
+
+			const float scaled{ (value - min) / extent * QUANTIZATION_STEPS + 0.5f };
+			return static_cast<uint16_t>(scaled < 0.f ? 0.f : (scaled > QUANTIZATION_STEPS ? QUANTIZATION_STEPS : scaled));
+		}
+
+		//Unit vector to two 16 bit octahedral coordinates (project on |x| + |y| + |z| = 1, fold the lower half over the diagonals)
+		//max angle error 0.005 degrees
+		static void EncodeNormal(float x, float y, float z, uint16_t* pEncoded)
+		{
+			const float sum{ fabsf(x) + fabsf(y) + fabsf(z) };
+			float u{ sum > 0.f ? x / sum : 0.f };
+			float v{ sum > 0.f ? y / sum : 0.f };
+
+			if (z < 0.f)
+			{
+				const float foldedU{ (1.f - fabsf(v)) * (u >= 0.f ? 1.f : -1.f) };
+				const float foldedV{ (1.f - fabsf(u)) * (v >= 0.f ? 1.f : -1.f) };
+				u = foldedU;
+				v = foldedV;
+			}
+
+			pEncoded[0] = QuantizeCoordinate(u, -1.f, 2.f);
+			pEncoded[1] = QuantizeCoordinate(v, -1.f, 2.f);
+		}
+#pragma endregion
+
+#pragma region DECODE
+		//Index at slot, stored in width bytes (1, 2 or 4)
+		static uint32_t ReadIndex(const uint8_t* pIndices, int width, int slot)
+		{
+			switch (width)
+			{
+			case 1:
+				return pIndices[slot];
+			case 2:
+			{
+				uint16_t index{};
+				std::memcpy(&index, pIndices + static_cast<size_t>(slot) * 2, sizeof(index));
+				return index;
+			}
+			default:
+			{
+				uint32_t index{};
+				std::memcpy(&index, pIndices + static_cast<size_t>(slot) * 4, sizeof(index));
+				return index;
+			}
+			}
+		}
+
+		static void DecodePosition(const TriangleDecoder& decoder, const uint16_t* pPositions, uint32_t vertex, float& x, float& y, float& z)
+		{
+			const float quantized[3]
+			{
+				static_cast<float>(pPositions[vertex * 3]),
+				static_cast<float>(pPositions[vertex * 3 + 1]),
+				static_cast<float>(pPositions[vertex * 3 + 2])
+			};
+
+			float* pWorld[3]{ &x, &y, &z };
+			for (int axis{}; axis < 3; ++axis)
+			{
+				const float* pRow{ decoder.position[axis] };
+				*pWorld[axis] = pRow[0] * quantized[0] + pRow[1] * quantized[1] + pRow[2] * quantized[2] + pRow[3];
+			}
+		}
+
+		//Not normalized, enough for culling (only the sign of a dot product), normalize it for shading
+		static void DecodeNormal(const TriangleDecoder& decoder, const uint16_t* pNormals, int triangle, float& x, float& y, float& z)
+		{
+			float u{ static_cast<float>(pNormals[triangle * 2]) / QUANTIZATION_STEPS * 2.f - 1.f };
+			float v{ static_cast<float>(pNormals[triangle * 2 + 1]) / QUANTIZATION_STEPS * 2.f - 1.f };
+			const float w{ 1.f - fabsf(u) - fabsf(v) };
+
+			//lower half, unfold
+			const float fold{ w < 0.f ? -w : 0.f };
+			u += u >= 0.f ? -fold : fold;
+			v += v >= 0.f ? -fold : fold;
+
+			const float local[3]{ u, v, w };
+			float* pWorld[3]{ &x, &y, &z };
+			for (int axis{}; axis < 3; ++axis)
+			{
+				const float* pRow{ decoder.normal[axis] };
+				*pWorld[axis] = pRow[0] * local[0] + pRow[1] * local[1] + pRow[2] * local[2];
+			}
+		}
+#pragma endregion
+	}
+}
@@ -0,0 +1,273 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <future>
+#include <thread>
+
+#include "MappedFile.h"
+
+namespace dae
+{
+	namespace
+	{
+		constexpr size_t MIN_CHUNK_SIZE{ 1 << 20 }; //smaller files are not worth splitting
+
+		struct ObjChunk
+		{
+			const char* pBegin{};
+			const char* pEnd{};
+
+			std::vector<Vector3> positions{};
+			std::vector<int> indices{};
+
+			//slots in indices that hold a negative (relative) index, these still need the amount of positions of the previous chunks added
+			std::vector<size_t> relativeIndexSlots{};
+
+			bool succeeded{ true };
+		};
+
+		bool IsBlank(char character)
+		{
+			return character == ' ' || character == '\t' || character == '\r';
+		}
+
+		const char* SkipBlanks(const char* pCurrent, const char* pEnd)
+		{
+			while (pCurrent < pEnd && IsBlank(*pCurrent)) ++pCurrent;
+			return pCurrent;
+		}
+
+		const char* SkipLine(const char* pCurrent, const char* pEnd)
+		{
+			while (pCurrent < pEnd && *pCurrent != '\n') ++pCurrent;
+			return pCurrent < pEnd ? pCurrent + 1 : pEnd;
+		}
+
+		//std::from_chars is locale independent and does not accept a leading '+'
+		const char* ParseFloat(const char* pCurrent, const char* pEnd, float& value)
+		{
+			pCurrent = SkipBlanks(pCurrent, pEnd);
+			if (pCurrent < pEnd && *pCurrent == '+') ++pCurrent;
+
+			const std::from_chars_result result{ std::from_chars(pCurrent, pEnd, value) };
+			return result.ec == std::errc{} ? result.ptr : nullptr;
+		}
+
+		void ParseVertex(const char* pCurrent, const char* pEnd, ObjChunk& chunk)
+		{
+			Vector3 position{};
+			for (int axis{}; axis < 3; ++axis)
+			{
+				pCurrent = ParseFloat(pCurrent, pEnd, position[axis]);
+				if (!pCurrent)
+				{
+					chunk.succeeded = false;
+					return;
+				}
+			}
+
+			chunk.positions.push_back(position);
+		}
+
+		void ParseFace(const char* pCurrent, const char* pLineEnd, ObjChunk& chunk)
+		{
+			const size_t firstSlot{ chunk.indices.size() };
+			int amountOfFaceVertices{};
+			int firstIndex{}, previousIndex{};
+			bool firstIsRelative{}, previousIsRelative{};
+
+			while (true)
+			{
+				pCurrent = SkipBlanks(pCurrent, pLineEnd);
+				if (pCurrent >= pLineEnd || *pCurrent == '#') break;
+
+				//only the position index is used: v, v/vt, v//vn and v/vt/vn
+				int objIndex{};
+				const std::from_chars_result result{ std::from_chars(pCurrent, pLineEnd, objIndex) };
+				if (result.ec != std::errc{} || objIndex == 0)
+				{
+					chunk.succeeded = false;
+					return;
+				}
+
+				pCurrent = result.ptr;
+				while (pCurrent < pLineEnd && !IsBlank(*pCurrent)) ++pCurrent;
+
+				//positive indices are 1 based and absolute, negative indices count back from the last position defined so far
+				const bool isRelative{ objIndex < 0 };
+				const int index{ isRelative ? static_cast<int>(chunk.positions.size()) + objIndex : objIndex - 1 };
+
+				//fan triangulation: (first, previous, current) for every vertex after the second
+				if (amountOfFaceVertices >= 2)
+				{
+					const int triangle[3]{ firstIndex, previousIndex, index };
+					const bool isTriangleRelative[3]{ firstIsRelative, previousIsRelative, isRelative };
+
+					for (int corner{}; corner < 3; ++corner)
+					{
+						if (isTriangleRelative[corner]) chunk.relativeIndexSlots.push_back(chunk.indices.size());
+						chunk.indices.push_back(triangle[corner]);
+					}
+				}
+
+				if (amountOfFaceVertices == 0)
+				{
+					firstIndex = index;
+					firstIsRelative = isRelative;
+				}
+
+				previousIndex = index;
+				previousIsRelative = isRelative;
+				++amountOfFaceVertices;
+			}
+
+			if (amountOfFaceVertices < 3)
+			{
+				chunk.indices.resize(firstSlot);
+				chunk.succeeded = false;
+			}
+		}
+
+		void ParseChunk(ObjChunk& chunk)
+		{
+			const char* pCurrent{ chunk.pBegin };
+			const char* pEnd{ chunk.pEnd };
+
+			while (pCurrent < pEnd && chunk.succeeded)
+			{
+				pCurrent = SkipBlanks(pCurrent, pEnd);
+				const char* pLineEnd{ std::find(pCurrent, pEnd, '\n') };
+
+				if (pLineEnd - pCurrent >= 2 && IsBlank(pCurrent[1]))
+				{
+					//vn, vt, vp, o, g, s, usemtl, ... are ignored
+					if (pCurrent[0] == 'v') ParseVertex(pCurrent + 1, pLineEnd, chunk);
+					else if (pCurrent[0] == 'f') ParseFace(pCurrent + 1, pLineEnd, chunk);
+				}
+
+				pCurrent = SkipLine(pLineEnd, pEnd);
+			}
+		}
+
+		//Runs function(begin, end) for [0, amount) split in one part per thread
+		template<typename Function>
+		void ParallelRanges(size_t amount, size_t amountOfTasks, const Function& function)
+		{
+			amountOfTasks = std::max<size_t>(1, std::min(amountOfTasks, amount));
+
+			std::vector<std::future<void>> futures{};
+			futures.reserve(amountOfTasks);
+
+			for (size_t taskIndex{}; taskIndex < amountOfTasks; ++taskIndex)
+			{
+				const size_t begin{ amount * taskIndex / amountOfTasks };
+				const size_t end{ amount * (taskIndex + 1) / amountOfTasks };
+				futures.push_back(std::async(std::launch::async, [&function, begin, end] { function(begin, end); }));
+			}
+
+			for (const std::future<void>& future : futures)
+			{
+				future.wait();
+			}
+		}
+	}
+
+	namespace Utils
+	{
+		bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		{
+			const MappedFile file{ filename };
+			if (!file.IsOpen())
+				return false;
+
+			const char* pData{ file.GetData() };
+			const char* pEnd{ pData + file.GetSize() };
+
+			const size_t amountOfThreads{ std::max(1u, std::thread::hardware_concurrency()) };
+			const size_t amountOfChunks{ std::max<size_t>(1, std::min(amountOfThreads, file.GetSize() / MIN_CHUNK_SIZE)) };
+
+			//split on line boundaries
+			std::vector<ObjChunk> chunks(amountOfChunks);
+			const char* pChunkBegin{ pData };
+			for (size_t chunkIndex{}; chunkIndex < amountOfChunks; ++chunkIndex)
+			{
+				const char* pChunkEnd{ pEnd };
+				if (chunkIndex + 1 < amountOfChunks)
+				{
+					pChunkEnd = std::max(pChunkBegin, pData + file.GetSize() * (chunkIndex + 1) / amountOfChunks);
+					pChunkEnd = SkipLine(pChunkEnd, pEnd);
+				}
+
+				chunks[chunkIndex].pBegin = pChunkBegin;
+				chunks[chunkIndex].pEnd = pChunkEnd;
+				pChunkBegin = pChunkEnd;
+			}
+
+			ParallelRanges(amountOfChunks, amountOfChunks, [&chunks](size_t begin, size_t end)
+				{
+					for (size_t chunkIndex{ begin }; chunkIndex < end; ++chunkIndex) ParseChunk(chunks[chunkIndex]);
+				});
+
+			//offsets of every chunk in the final arrays
+			std::vector<size_t> positionOffsets(amountOfChunks + 1);
+			std::vector<size_t> indexOffsets(amountOfChunks + 1);
+			for (size_t chunkIndex{}; chunkIndex < amountOfChunks; ++chunkIndex)
+			{
+				if (!chunks[chunkIndex].succeeded)
+					return false;
+
+				positionOffsets[chunkIndex + 1] = positionOffsets[chunkIndex] + chunks[chunkIndex].positions.size();
+				indexOffsets[chunkIndex + 1] = indexOffsets[chunkIndex] + chunks[chunkIndex].indices.size();
+			}
+
+			const int amountOfPositions{ static_cast<int>(positionOffsets.back()) };
+			positions.resize(positionOffsets.back());
+			indices.resize(indexOffsets.back());
+
+			std::atomic<bool> indicesValid{ true };
+			ParallelRanges(amountOfChunks, amountOfThreads, [&](size_t begin, size_t end)
+				{
+					for (size_t chunkIndex{ begin }; chunkIndex < end; ++chunkIndex)
+					{
+						ObjChunk& chunk{ chunks[chunkIndex] };
+						const int positionOffset{ static_cast<int>(positionOffsets[chunkIndex]) };
+
+						for (const size_t slot : chunk.relativeIndexSlots) chunk.indices[slot] += positionOffset;
+
+						std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionOffsets[chunkIndex]);
+						std::copy(chunk.indices.begin(), chunk.indices.end(), indices.begin() + indexOffsets[chunkIndex]);
+
+						for (const int index : chunk.indices)
+						{
+							if (index < 0 || index >= amountOfPositions) indicesValid = false;
+						}
+					}
+				});
+
+			if (!indicesValid)
+				return false;
+
+			//Precompute normals, degenerate triangles get a zero normal instead of NaN
+			const size_t amountOfTriangles{ indices.size() / 3 };
+			normals.resize(amountOfTriangles);
+			ParallelRanges(amountOfTriangles, amountOfThreads, [&](size_t begin, size_t end)
+				{
+					for (size_t triangleIndex{ begin }; triangleIndex < end; ++triangleIndex)
+					{
+						const Vector3& v0{ positions[indices[triangleIndex * 3]] };
+						const Vector3& v1{ positions[indices[triangleIndex * 3 + 1]] };
+						const Vector3& v2{ positions[indices[triangleIndex * 3 + 2]] };
+
+						const Vector3 normal{ Vector3::Cross(v1 - v0, v2 - v0) };
+						const float magnitude{ normal.Magnitude() };
+						normals[triangleIndex] = magnitude > 0.f ? normal / magnitude : Vector3::Zero;
+					}
+				});
+
+			return true;
+		}
+	}
+}
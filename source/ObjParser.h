@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	namespace Utils
+	{
+		//Parses the vertex positions and faces of an obj file and precomputes a normal per triangle
+		//The file is memory mapped and split into chunks that are parsed in parallel, faces support the v, v/vt, v//vn and v/vt/vn forms,
+		//negative (relative) indices and polygons with more than 3 vertices (triangulated as a fan)
+		bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dae
+{
+	//Index of an object in a Pool, unlike a pointer into the pool it stays valid when the pool grows
+	template<typename T>
+	struct Handle
+	{
+		static constexpr uint32_t INVALID_INDEX{ UINT32_MAX };
+
+		uint32_t index{ INVALID_INDEX };
+
+		bool IsValid() const { return index != INVALID_INDEX; }
+	};
+
+	//Every object of one type in one contiguous array, so the hit test loops walk memory in order and thousands of objects are
+	//a handful of allocations (one after Reserve). Objects are only ever added, Add hands out a handle instead of a pointer
+	//because growing moves them
+	template<typename T>
+	class Pool final
+	{
+	public:
+		template<typename... Args>
+		Handle<T> Add(Args&&... args)
+		{
+			m_Objects.emplace_back(std::forward<Args>(args)...);
+			return { static_cast<uint32_t>(m_Objects.size() - 1) };
+		}
+
+		void Reserve(size_t amount) { m_Objects.reserve(amount); }
+
+		T& operator[](Handle<T> handle)
+		{
+			assert(handle.index < m_Objects.size() && "handle of another pool or an invalid one");
+			return m_Objects[handle.index];
+		}
+
+		const T& operator[](Handle<T> handle) const
+		{
+			assert(handle.index < m_Objects.size() && "handle of another pool or an invalid one");
+			return m_Objects[handle.index];
+		}
+
+		T& operator[](size_t index) { return m_Objects[index]; }
+		const T& operator[](size_t index) const { return m_Objects[index]; }
+
+		size_t Size() const { return m_Objects.size(); }
+		bool Empty() const { return m_Objects.empty(); }
+
+		//the objects in the order they were added, handle.index is the position
+		const std::vector<T>& GetObjects() const { return m_Objects; }
+
+		auto begin() { return m_Objects.begin(); }
+		auto end() { return m_Objects.end(); }
+		auto begin() const { return m_Objects.begin(); }
+		auto end() const { return m_Objects.end(); }
+
+	private:
+		std::vector<T> m_Objects{};
+	};
+}
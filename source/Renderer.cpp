@@ -2,6 +2,7 @@
 #include "SDL.h"
 #include "SDL_surface.h"
 #include <future> //async
+#include <numeric> //accumulate
 #include <ppl.h> //parallel_for
 //to use thread_pool uncomment the next 2 #includes and unzip boost_1_80_0.7z found in the lib folder
 //#include <boost/asio/thread_pool.hpp> //thread_pool
@@ -15,6 +16,9 @@
 #include "Material.h"
 #include "Scene.h"
 #include "Utils.h"
+#include "Wavefront.h"
+#include "Kernels.h"
+#include "AllocationTracker.h"
 
 using namespace dae;
 
@@ -29,6 +33,9 @@ Renderer::Renderer(SDL_Window * pWindow) :
 	//Initialize
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
 	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+	m_SkippedShadowRaysPerPixel.resize(static_cast<size_t>(m_Width) * m_Height);
+	m_AccumulationBuffer.resize(static_cast<size_t>(m_Width) * m_Height);
+	m_FrameBuffer.resize(static_cast<size_t>(m_Width) * m_Height);
 }
 
 void Renderer::Render(Scene* pScene) const
@@ -40,14 +47,51 @@ void Renderer::Render(Scene* pScene) const
 	
 	const float aspectRatio{ static_cast<float>(m_Width) / static_cast<float>(m_Height) };
 
-	auto& solidColorMaterials = pScene->GetSolidColorMaterials();
-	auto& lambertMaterials = pScene->GetLambertMaterials();
-	auto& lambertPhongMaterials = pScene->GetLambertPhongMaterials();
-	auto& cookTorrenceMaterials = pScene->GetCookTorrenceMaterials();
+	auto& materials = pScene->GetMaterials();
 	auto& lights = pScene->GetLights();
 
 	const uint32_t amountOfPixels = m_Width * m_Height;
 
+	//light lists per world cell or the light bvh, lights can move every frame
+	{
+		const AllocationTracker::ScopedPhase phase{ AllocationTracker::Phase::Lights };
+		if (m_LightSamplingEnabled) m_LightBVH.Build(lights);
+		else m_LightGrid.Build(lights);
+	}
+	++m_FrameIndex;
+
+	if (m_AccumulationEnabled)
+	{
+		const bool cameraMoved{ !(camera.origin == m_AccumulatedCameraOrigin) || !(camera.forward == m_AccumulatedCameraForward) || camera.fovAngle != m_AccumulatedCameraFov };
+		if (cameraMoved || pScene != m_pAccumulatedScene || m_AccumulatedFrames == 0)
+		{
+			std::fill(m_AccumulationBuffer.begin(), m_AccumulationBuffer.end(), ColorRGB{});
+			m_AccumulatedFrames = 0;
+			m_pAccumulatedScene = pScene;
+			m_AccumulatedCameraOrigin = camera.origin;
+			m_AccumulatedCameraForward = camera.forward;
+			m_AccumulatedCameraFov = camera.fovAngle;
+		}
+
+		++m_AccumulatedFrames;
+	}
+
+	//present nests in it at the end
+	const AllocationTracker::ScopedPhase tracePhase{ AllocationTracker::Phase::Trace };
+
+	if (m_WavefrontEnabled)
+	{
+		RenderWavefront(pScene, fov, aspectRatio, camera, lights, materials);
+
+		const AllocationTracker::ScopedPhase presentPhase{ AllocationTracker::Phase::Present };
+		m_SkippedShadowRays = m_ShadowsEnabled ? std::accumulate(m_SkippedShadowRaysPerPixel.begin(), m_SkippedShadowRaysPerPixel.end(), uint64_t{}) : 0;
+		PackPixels();
+		SDL_UpdateWindowSurface(m_pWindow);
+		return;
+	}
+
+	const RenderPixelFunction renderPixel{ SelectRenderPixel() };
+
 	
 
 #if defined(ASYNC)
@@ -67,13 +111,13 @@ void Renderer::Render(Scene* pScene) const
 			--amountOfUnassignedPixels;
 		}
 
-		async_futures.push_back(std::async(std::launch::async, [=, this]
+		async_futures.push_back(std::async(std::launch::async, [=, this, &camera, &lights, &materials]
 			{
 				//render all pixels for this task (currentPixelIndex > currentPixelIndex + taskSize)
 				const uint32_t lastPixelIndex{ currentPixelIndex + taskSize };
 				for (uint32_t pixelIndex{ currentPixelIndex }; pixelIndex < lastPixelIndex; ++pixelIndex)
 				{
-					RenderPixel(pScene, pixelIndex, fov, aspectRatio, camera, lights, solidColorMaterials, lambertMaterials, lambertPhongMaterials, cookTorrenceMaterials);
+					(this->*renderPixel)(pScene, pixelIndex, fov, aspectRatio, camera, lights, materials);
 				}
 			}));
 
@@ -87,9 +131,10 @@ void Renderer::Render(Scene* pScene) const
 	}
 
 #elif defined(PARALLEL_FOR)
-	concurrency::parallel_for(0u, amountOfPixels, [=, this](int index)
+	//lights and materials by reference, capturing them by copy copied both vectors every frame
+	concurrency::parallel_for(0u, amountOfPixels, [=, this, &camera, &lights, &materials](int index)
 		{
-			RenderPixel(pScene, index, fov, aspectRatio, camera, lights, solidColorMaterials, lambertMaterials, lambertPhongMaterials, cookTorrenceMaterials);
+			(this->*renderPixel)(pScene, index, fov, aspectRatio, camera, lights, materials);
 		});
 
 #elif defined(THREAD_POOL)
@@ -111,13 +156,13 @@ void Renderer::Render(Scene* pScene) const
 			--amountOfUnassignedPixels;
 		}
 
-		boost::asio::post(m_ThreadPool, [=, this]
+		boost::asio::post(m_ThreadPool, [=, this, &camera, &lights, &materials]
 			{
 				//render all pixels for this task (currentPixelIndex > currentPixelIndex + taskSize)
 				const uint32_t lastPixelIndex{ currentPixelIndex + taskSize };
 				for (uint32_t pixelIndex{ currentPixelIndex }; pixelIndex < lastPixelIndex; ++pixelIndex)
 				{
-					RenderPixel(pScene, pixelIndex, fov, aspectRatio, camera, lights, solidColorMaterials, lambertMaterials, lambertPhongMaterials, cookTorrenceMaterials);
+					(this->*renderPixel)(pScene, pixelIndex, fov, aspectRatio, camera, lights, materials);
 				}
 			});
 
@@ -131,16 +176,52 @@ void Renderer::Render(Scene* pScene) const
 	//Synchronous Logic (no threading)
 	for (uint32_t index{}; index < amountOfPixels; ++index)
 	{
-		RenderPixel(pScene, index, fov, aspectRatio, camera, lights, solidColorMaterials, lambertMaterials, lambertPhongMaterials, cookTorrenceMaterials);
+		(this->*renderPixel)(pScene, index, fov, aspectRatio, camera, lights, materials);
 	}
 
 #endif
+
+	const AllocationTracker::ScopedPhase presentPhase{ AllocationTracker::Phase::Present };
+	m_SkippedShadowRays = m_ShadowsEnabled ? std::accumulate(m_SkippedShadowRaysPerPixel.begin(), m_SkippedShadowRaysPerPixel.end(), uint64_t{}) : 0;
 	
 	//@END
 	//Update SDL Surface
+	PackPixels();
 	SDL_UpdateWindowSurface(m_pWindow);
 }
 
+Renderer::RenderPixelFunction Renderer::SelectRenderPixel() const
+{
+	switch (m_CurrentLightingMode)
+	{
+	case LightingMode::ObservedArea:
+		return SelectRenderPixel<LightingMode::ObservedArea>();
+	case LightingMode::Radiance:
+		return SelectRenderPixel<LightingMode::Radiance>();
+	case LightingMode::BRFD:
+		return SelectRenderPixel<LightingMode::BRFD>();
+	case LightingMode::Combined:
+	default:
+		return SelectRenderPixel<LightingMode::Combined>();
+	}
+}
+
+template<Renderer::LightingMode lightingMode>
+Renderer::RenderPixelFunction Renderer::SelectRenderPixel() const
+{
+	switch (m_ShadingPrecision)
+	{
+	case ShadingPrecision::Fast:
+		return m_ShadowsEnabled ? &Renderer::RenderPixel<lightingMode, true, ShadingPrecision::Fast> : &Renderer::RenderPixel<lightingMode, false, ShadingPrecision::Fast>;
+	case ShadingPrecision::Tabulated:
+		return m_ShadowsEnabled ? &Renderer::RenderPixel<lightingMode, true, ShadingPrecision::Tabulated> : &Renderer::RenderPixel<lightingMode, false, ShadingPrecision::Tabulated>;
+	case ShadingPrecision::Exact:
+	default:
+		return m_ShadowsEnabled ? &Renderer::RenderPixel<lightingMode, true, ShadingPrecision::Exact> : &Renderer::RenderPixel<lightingMode, false, ShadingPrecision::Exact>;
+	}
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled, ShadingPrecision precision>
 void Renderer::RenderPixel
 (
 	Scene* pScene,
@@ -149,10 +230,7 @@ void Renderer::RenderPixel
 	float aspectRatio,
 	const Camera& camera,
 	const std::vector<Light>& lights,
-	const std::vector<Material_SolidColor*>& solidColorMaterials,
-	const std::vector<Material_Lambert*>& lambertMaterials,
-	const std::vector<Material_LambertPhong*>& lambertPhongMaterials,
-	const std::vector<Material_CookTorrence*>& cookTorrenceMaterials
+	const std::vector<Material>& materials
 ) const
 {
 	const int px = pixelIndex % m_Width;
@@ -174,43 +252,373 @@ void Renderer::RenderPixel
 	pScene->GetClosestHit(viewRay, closestHit);
 
 	ColorRGB finalColor{};
+	uint32_t skippedShadowRays{};
 
 	if (closestHit.didHit)
 	{
-		for (const Light& light : lights)
+		const Material& material{ materials[closestHit.materialId] };
+
+		switch (material.type)
+		{
+		case MaterialType::solidColor:
+			ShadeLights<lightingMode, shadowsEnabled, precision, MaterialType::solidColor>(pScene, closestHit, material, lights, rayDirection, finalColor, skippedShadowRays, pixelIndex);
+			break;
+		case MaterialType::lambert:
+			ShadeLights<lightingMode, shadowsEnabled, precision, MaterialType::lambert>(pScene, closestHit, material, lights, rayDirection, finalColor, skippedShadowRays, pixelIndex);
+			break;
+		case MaterialType::lambertPhong:
+			ShadeLights<lightingMode, shadowsEnabled, precision, MaterialType::lambertPhong>(pScene, closestHit, material, lights, rayDirection, finalColor, skippedShadowRays, pixelIndex);
+			break;
+		case MaterialType::cookTorrence:
+			ShadeLights<lightingMode, shadowsEnabled, precision, MaterialType::cookTorrence>(pScene, closestHit, material, lights, rayDirection, finalColor, skippedShadowRays, pixelIndex);
+			break;
+		}
+	}
+
+	if constexpr (shadowsEnabled)
+	{
+		m_SkippedShadowRaysPerPixel[pixelIndex] = skippedShadowRays;
+	}
+
+	WritePixel(px + (py * m_Width), finalColor);
+}
+
+void Renderer::WritePixel(uint32_t pixelIndex, ColorRGB finalColor) const
+{
+	if (m_AccumulationEnabled)
+	{
+		m_AccumulationBuffer[pixelIndex] += finalColor;
+
+		const ColorRGB& accumulatedColor{ m_AccumulationBuffer[pixelIndex] };
+		finalColor = accumulatedColor * (1.f / static_cast<float>(m_AccumulatedFrames));
+	}
+
+	//Update Color in Buffer, converted to the surface format by PackPixels once the frame is done
+	m_FrameBuffer[pixelIndex] = finalColor;
+}
+
+void Renderer::PackPixels() const
+{
+	const SDL_PixelFormat* pFormat{ m_pBuffer->format };
+	const Kernels::PixelFormat format
+	{
+		pFormat->Rshift, pFormat->Gshift, pFormat->Bshift,
+		pFormat->Rloss, pFormat->Gloss, pFormat->Bloss,
+		pFormat->Amask
+	};
+
+	const auto packPixels{ Kernels::Get().packPixels };
+
+#if defined(PARALLEL_FOR)
+	concurrency::parallel_for(0, m_Height, [=, this](int row)
 		{
-			Vector3 rayOrigin{ closestHit.origin };
-			rayOrigin += closestHit.normal * 0.0001f;
+			const size_t firstPixel{ static_cast<size_t>(row) * m_Width };
+			packPixels(m_FrameBuffer.data() + firstPixel, m_pBufferPixels + firstPixel, m_Width, format);
+		});
+#else
+	packPixels(m_FrameBuffer.data(), m_pBufferPixels, m_Width * m_Height, format);
+#endif
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled, ShadingPrecision precision, MaterialType materialType>
+void Renderer::ShadeLights
+(
+	Scene* pScene,
+	const HitRecord& closestHit,
+	const Material& material,
+	const std::vector<Light>& lights,
+	const Vector3& rayDirection,
+	ColorRGB& finalColor,
+	uint32_t& skippedShadowRays,
+	uint32_t pixelIndex
+) const
+{
+	Vector3 rayOrigin{ closestHit.origin };
+	rayOrigin += closestHit.normal * 0.0001f;
+
+	//weight scales the light's contribution, 1 / (samples * pdf) for sampled lights
+	const auto shadeLight = [&](uint32_t lightIndex, float weight)
+		{
+			const Light& light{ lights[lightIndex] };
 
 			Vector3 toLight{ LightUtils::GetDirectionToLight(light, rayOrigin) };
 			const float distanceToLight = toLight.Normalize();
 
-			if (m_ShadowsEnabled)
+			if (distanceToLight >= light.radius) return;
+
+			if constexpr (shadowsEnabled)
 			{
+				if (IsLightNegligible<lightingMode>(closestHit.normal, toLight, closestHit.origin, light, material))
+				{
+					++skippedShadowRays;
+					return;
+				}
+
 				Ray lightRay{};
 				lightRay.origin = rayOrigin;
 				lightRay.direction = toLight;
 				lightRay.max = distanceToLight;
 
-				if (!pScene->DoesHit(lightRay))
-				{
-					CalculateFinalColor(closestHit, toLight, solidColorMaterials, lambertMaterials, lambertPhongMaterials, cookTorrenceMaterials, light, rayDirection, finalColor);
-				}
+				if (pScene->DoesHit(lightRay)) return;
 			}
-			else
+
+			ColorRGB lightColor{};
+			CalculateFinalColor<lightingMode, precision, materialType>(closestHit, toLight, material, light, rayDirection, lightColor);
+			finalColor += lightColor * weight;
+		};
+
+	if (m_LightSamplingEnabled)
+	{
+		for (const uint32_t lightIndex : m_LightBVH.GetGlobalLights())
+		{
+			shadeLight(lightIndex, 1.f);
+		}
+
+		constexpr bool useCosineBound{ lightingMode == LightingMode::Combined || lightingMode == LightingMode::ObservedArea };
+		uint32_t randomState{ Hash(pixelIndex ^ Hash(m_FrameIndex)) };
+
+		for (int sampleIndex{}; sampleIndex < m_LightSamplesPerPixel; ++sampleIndex)
+		{
+			uint32_t lightIndex{};
+			float pdf{};
+			if (m_LightBVH.Sample(closestHit.origin, closestHit.normal, useCosineBound, RandomFloat(randomState), lightIndex, pdf))
 			{
-				CalculateFinalColor(closestHit, toLight, solidColorMaterials, lambertMaterials, lambertPhongMaterials, cookTorrenceMaterials, light, rayDirection, finalColor);
+				shadeLight(lightIndex, 1.f / (pdf * static_cast<float>(m_LightSamplesPerPixel)));
 			}
 		}
 	}
+	else
+	{
+		m_LightGrid.ForEachLight(closestHit.origin, [&](uint32_t lightIndex) { shadeLight(lightIndex, 1.f); });
+	}
+}
 
-	//Update Color in Buffer
-	finalColor.MaxToOne();
+void Renderer::RenderWavefront
+(
+	Scene* pScene,
+	float fov,
+	float aspectRatio,
+	const Camera& camera,
+	const std::vector<Light>& lights,
+	const std::vector<Material>& materials
+) const
+{
+	const RenderTileFunction renderTile{ SelectRenderTile() };
+
+	const int amountOfTilesX{ (m_Width + Wavefront::TILE_SIZE - 1) / Wavefront::TILE_SIZE };
+	const int amountOfTilesY{ (m_Height + Wavefront::TILE_SIZE - 1) / Wavefront::TILE_SIZE };
+	const uint32_t amountOfTiles{ static_cast<uint32_t>(amountOfTilesX * amountOfTilesY) };
+
+	//shadow rays a hit can emit, directional lights plus the samples or every light of its light grid cell
+	const size_t maxShadowRaysPerHit{ m_LightSamplingEnabled
+		? m_LightBVH.GetGlobalLights().size() + static_cast<size_t>(m_LightSamplesPerPixel)
+		: m_LightGrid.GetMaxLightsPerPosition() };
 
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
+	const auto renderTileAtIndex = [=, this, &camera, &lights, &materials](uint32_t tileIndex)
+		{
+			//the queues of this worker, reused by every tile it renders. They are the only per-thread scratch memory of a frame
+			//(bvh traversal recurses on the call stack), once reserved they don't allocate, so no separate frame arena backs them
+			static thread_local Wavefront::Queues queues{};
+			queues.Reserve(materials.size(), maxShadowRaysPerHit);
+
+			Wavefront::Tile tile{};
+			tile.x = static_cast<int>(tileIndex % amountOfTilesX) * Wavefront::TILE_SIZE;
+			tile.y = static_cast<int>(tileIndex / amountOfTilesX) * Wavefront::TILE_SIZE;
+			tile.width = std::min(Wavefront::TILE_SIZE, m_Width - tile.x);
+			tile.height = std::min(Wavefront::TILE_SIZE, m_Height - tile.y);
+
+			(this->*renderTile)(pScene, tile, fov, aspectRatio, camera, lights, materials, queues);
+		};
+
+#if defined(PARALLEL_FOR)
+	concurrency::parallel_for(0u, amountOfTiles, [&](int tileIndex)
+		{
+			renderTileAtIndex(tileIndex);
+		});
+#else
+	for (uint32_t tileIndex{}; tileIndex < amountOfTiles; ++tileIndex)
+	{
+		renderTileAtIndex(tileIndex);
+	}
+#endif
+}
+
+Renderer::RenderTileFunction Renderer::SelectRenderTile() const
+{
+	switch (m_CurrentLightingMode)
+	{
+	case LightingMode::ObservedArea:
+		return &Renderer::RenderTile<LightingMode::ObservedArea>;
+	case LightingMode::Radiance:
+		return &Renderer::RenderTile<LightingMode::Radiance>;
+	case LightingMode::BRFD:
+		return &Renderer::RenderTile<LightingMode::BRFD>;
+	case LightingMode::Combined:
+	default:
+		return &Renderer::RenderTile<LightingMode::Combined>;
+	}
+}
+
+template<Renderer::LightingMode lightingMode>
+void Renderer::RenderTile
+(
+	Scene* pScene,
+	const Wavefront::Tile& tile,
+	float fov,
+	float aspectRatio,
+	const Camera& camera,
+	const std::vector<Light>& lights,
+	const std::vector<Material>& materials,
+	Wavefront::Queues& queues
+) const
+{
+	Wavefront::GeneratePrimaryRays(camera, tile, m_Width, m_Height, fov, aspectRatio, queues.rays);
+	Wavefront::IntersectPrimaryRays(pScene, queues.rays, queues.hits);
+	Wavefront::SortHitsByMaterial(queues.hits, materials.size(), queues.materialOffsets, queues.sortedHits);
+	if (m_LightSamplingEnabled)
+	{
+		constexpr bool useCosineBound{ lightingMode == LightingMode::Combined || lightingMode == LightingMode::ObservedArea };
+		Wavefront::EmitSampledShadowRays(queues.sortedHits, lights, m_LightBVH, m_LightSamplesPerPixel, m_FrameIndex, useCosineBound, queues.shadowRays);
+	}
+	else
+	{
+		Wavefront::EmitShadowRays(queues.sortedHits, lights, m_LightGrid, queues.shadowRays);
+	}
+
+	if (m_ShadowsEnabled)
+	{
+		for (const uint32_t pixelIndex : queues.rays.pixelIndex)
+		{
+			m_SkippedShadowRaysPerPixel[pixelIndex] = 0;
+		}
+
+		CullShadowRays<lightingMode>(queues.sortedHits, queues.shadowRays, lights, materials);
+		Wavefront::TraceShadowRays(pScene, queues.shadowRays);
+	}
+
+	ShadeWavefront<lightingMode>(queues.sortedHits, queues.shadowRays, lights, materials);
+
+	//Update Color in Buffer, pixels without a hit stay black
+	for (const uint32_t pixelIndex : queues.rays.pixelIndex)
+	{
+		m_FrameBuffer[pixelIndex] = ColorRGB{};
+	}
+
+	const Wavefront::HitQueue& hits{ queues.sortedHits };
+	const size_t amountOfHits{ hits.Size() };
+	for (size_t hitIndex{}; hitIndex < amountOfHits; ++hitIndex)
+	{
+		WritePixel(hits.pixelIndex[hitIndex], hits.GetColor(hitIndex));
+	}
+}
+
+template<Renderer::LightingMode lightingMode>
+void Renderer::CullShadowRays
+(
+	const Wavefront::HitQueue& hits,
+	Wavefront::ShadowRayQueue& shadowRays,
+	const std::vector<Light>& lights,
+	const std::vector<Material>& materials
+) const
+{
+	const size_t amountOfShadowRays{ shadowRays.Size() };
+	size_t amountOfKeptShadowRays{};
+
+	for (size_t shadowRayIndex{}; shadowRayIndex < amountOfShadowRays; ++shadowRayIndex)
+	{
+		const uint32_t hitIndex{ shadowRays.hitIndex[shadowRayIndex] };
+		if (IsLightNegligible<lightingMode>(hits.GetNormal(hitIndex), shadowRays.GetDirection(shadowRayIndex), hits.GetOrigin(hitIndex),
+			lights[shadowRays.lightIndex[shadowRayIndex]], materials[hits.materialId[hitIndex]]))
+		{
+			++m_SkippedShadowRaysPerPixel[hits.pixelIndex[hitIndex]];
+			continue;
+		}
+
+		shadowRays.CopyEntry(shadowRayIndex, amountOfKeptShadowRays++);
+	}
+
+	shadowRays.Resize(amountOfKeptShadowRays);
+}
+
+template<Renderer::LightingMode lightingMode>
+void Renderer::ShadeWavefront
+(
+	Wavefront::HitQueue& hits,
+	const Wavefront::ShadowRayQueue& shadowRays,
+	const std::vector<Light>& lights,
+	const std::vector<Material>& materials
+) const
+{
+	const size_t amountOfShadowRays{ shadowRays.Size() };
+	size_t shadowRayIndex{};
+
+	while (shadowRayIndex < amountOfShadowRays)
+	{
+		//gather the next unoccluded shadow rays that hit the same material type
+		ShadingBatch batch{};
+		uint32_t batchShadowRays[BATCH_WIDTH]{};
+		const MaterialType materialType{ materials[hits.materialId[shadowRays.hitIndex[shadowRayIndex]]].type };
+
+		while (shadowRayIndex < amountOfShadowRays && batch.count < BATCH_WIDTH)
+		{
+			const uint32_t hitIndex{ shadowRays.hitIndex[shadowRayIndex] };
+			const Material& material{ materials[hits.materialId[hitIndex]] };
+			if (material.type != materialType) break;
+
+			if (!shadowRays.occluded[shadowRayIndex])
+			{
+				const int lane{ batch.count++ };
+				batch.normal.Set(lane, hits.GetNormal(hitIndex));
+				batch.view.Set(lane, hits.GetRayDirection(hitIndex));
+				batch.toLight.Set(lane, shadowRays.GetDirection(shadowRayIndex));
+				material.SetBatchLane(batch, lane);
+				batchShadowRays[lane] = static_cast<uint32_t>(shadowRayIndex);
+			}
+
+			++shadowRayIndex;
+		}
+
+		ColorRGBBatch brdf{};
+		if constexpr (lightingMode == LightingMode::Combined || lightingMode == LightingMode::BRFD)
+		{
+			//batched BRDF of the selected instruction set (see Kernels.h)
+			Kernels::Get().shadeBatch[static_cast<int>(m_ShadingPrecision)][static_cast<int>(materialType)](batch, brdf);
+		}
+
+		//accumulate lane by lane, the lights of a hit are added in the same order as RenderPixel does
+		for (int lane{}; lane < batch.count; ++lane)
+		{
+			const uint32_t shadowRayOfLane{ batchShadowRays[lane] };
+			const uint32_t hitIndex{ shadowRays.hitIndex[shadowRayOfLane] };
+			const Light& light{ lights[shadowRays.lightIndex[shadowRayOfLane]] };
+			const float weight{ shadowRays.weight[shadowRayOfLane] };
+
+			const float observedArea{ Vector3::Dot(batch.normal.Get(lane), batch.toLight.Get(lane)) };
+
+			if constexpr (lightingMode == LightingMode::Combined)
+			{
+				if (observedArea > 0.f)
+				{
+					hits.AddColor(hitIndex, LightUtils::GetRadiance(light, hits.GetOrigin(hitIndex)) * brdf.Get(lane) * observedArea * weight);
+				}
+			}
+			else if constexpr (lightingMode == LightingMode::ObservedArea)
+			{
+				if (observedArea > 0.f)
+				{
+					hits.AddColor(hitIndex, ColorRGB{ 1.f, 1.f, 1.f } *observedArea * weight);
+				}
+			}
+			else if constexpr (lightingMode == LightingMode::Radiance)
+			{
+				hits.AddColor(hitIndex, LightUtils::GetRadiance(light, hits.GetOrigin(hitIndex)) * weight);
+			}
+			else if constexpr (lightingMode == LightingMode::BRFD)
+			{
+				hits.AddColor(hitIndex, brdf.Get(lane) * weight);
+			}
+		}
+	}
 }
 
 bool Renderer::SaveBufferToImage() const
@@ -220,6 +628,8 @@ bool Renderer::SaveBufferToImage() const
 
 void Renderer::CycleLightingMode()
 {
+	m_AccumulatedFrames = 0;
+
 	switch (m_CurrentLightingMode)
 	{
 	case LightingMode::ObservedArea:
@@ -237,14 +647,169 @@ void Renderer::CycleLightingMode()
 	}
 }
 
+void Renderer::CycleShadingPrecision()
+{
+	m_AccumulatedFrames = 0;
+
+	switch (m_ShadingPrecision)
+	{
+	case ShadingPrecision::Exact:
+		m_ShadingPrecision = ShadingPrecision::Fast;
+		break;
+	case ShadingPrecision::Fast:
+		m_ShadingPrecision = ShadingPrecision::Tabulated;
+		break;
+	case ShadingPrecision::Tabulated:
+		m_ShadingPrecision = ShadingPrecision::Exact;
+		break;
+	}
+}
+
+void Renderer::CycleShadowRayThreshold()
+{
+	constexpr float thresholds[]{ 0.f, 0.001f, 0.004f, 0.016f };
+	constexpr size_t amountOfThresholds{ sizeof(thresholds) / sizeof(thresholds[0]) };
+
+	size_t thresholdIndex{};
+	while (thresholdIndex < amountOfThresholds && thresholds[thresholdIndex] != m_ShadowRayThreshold) ++thresholdIndex;
+
+	//a threshold that was set to something else starts the cycle over
+	SetShadowRayThreshold(thresholdIndex < amountOfThresholds ? thresholds[(thresholdIndex + 1) % amountOfThresholds] : thresholds[0]);
+}
+
+Renderer::ImageError Renderer::MeasureShadingError(Scene* pScene, ShadingPrecision precision)
+{
+	const ShadingPrecision shadingPrecision{ m_ShadingPrecision };
+	const bool accumulationEnabled{ m_AccumulationEnabled };
+	const uint32_t frameIndex{ m_FrameIndex };
+	m_AccumulationEnabled = false;
+
+	m_ShadingPrecision = ShadingPrecision::Exact;
+	Render(pScene);
+	const std::vector<ColorRGB> exactFrame{ m_FrameBuffer };
+
+	//same frame index so light sampling picks the same lights
+	m_FrameIndex = frameIndex;
+	m_ShadingPrecision = precision;
+	Render(pScene);
+
+	m_ShadingPrecision = shadingPrecision;
+	m_AccumulationEnabled = accumulationEnabled;
+	m_AccumulatedFrames = 0;
+
+	return CompareWithFrameBuffer(exactFrame);
+}
+
+Renderer::ImageError Renderer::CompareScenes(Scene* pReference, Scene* pScene)
+{
+	const bool accumulationEnabled{ m_AccumulationEnabled };
+	const uint32_t frameIndex{ m_FrameIndex };
+	m_AccumulationEnabled = false;
+
+	Render(pReference);
+	const std::vector<ColorRGB> referenceFrame{ m_FrameBuffer };
+
+	//same frame index so light sampling picks the same lights
+	m_FrameIndex = frameIndex;
+	Render(pScene);
+
+	m_AccumulationEnabled = accumulationEnabled;
+	m_AccumulatedFrames = 0;
+
+	return CompareWithFrameBuffer(referenceFrame);
+}
+
+Renderer::ImageError Renderer::CompareWithFrameBuffer(const std::vector<ColorRGB>& referenceFrame) const
+{
+	//compare what PackPixels would write, MaxToOne and truncated to 8 bit
+	const auto toChannels = [](ColorRGB color, int channels[3])
+		{
+			color.MaxToOne();
+			channels[0] = static_cast<int>(static_cast<uint8_t>(color.r * 255));
+			channels[1] = static_cast<int>(static_cast<uint8_t>(color.g * 255));
+			channels[2] = static_cast<int>(static_cast<uint8_t>(color.b * 255));
+		};
+
+	ImageError error{};
+	double sumOfErrors{};
+	double sumOfSquaredErrors{};
+	for (size_t pixelIndex{}; pixelIndex < m_FrameBuffer.size(); ++pixelIndex)
+	{
+		int referenceChannels[3]{};
+		int channels[3]{};
+		toChannels(referenceFrame[pixelIndex], referenceChannels);
+		toChannels(m_FrameBuffer[pixelIndex], channels);
+
+		int pixelError{};
+		for (int channel{}; channel < 3; ++channel)
+		{
+			const int channelError{ std::abs(referenceChannels[channel] - channels[channel]) };
+			pixelError = std::max(pixelError, channelError);
+			sumOfErrors += channelError;
+			sumOfSquaredErrors += static_cast<double>(channelError) * channelError;
+		}
+
+		error.maxError = std::max(error.maxError, pixelError);
+		if (pixelError > 1) ++error.amountOfEdgePixels;
+	}
+
+	const double amountOfChannels{ static_cast<double>(m_FrameBuffer.size()) * 3 };
+	const double meanSquaredError{ sumOfSquaredErrors / amountOfChannels };
+	error.meanError = static_cast<float>(sumOfErrors / amountOfChannels);
+	error.psnr = meanSquaredError > 0 ? static_cast<float>(10 * log10(255.0 * 255.0 / meanSquaredError)) : INFINITY;
+
+	return error;
+}
+
+template<Renderer::LightingMode lightingMode>
+bool Renderer::IsLightNegligible
+(
+	const Vector3& normal,
+	const Vector3& toLight,
+	const Vector3& hitOrigin,
+	const Light& light,
+	const Material& material
+) const
+{
+	const float observedArea{ Vector3::Dot(normal, toLight) };
+
+	//these modes only add light for observedArea > 0 (see CalculateFinalColor)
+	if constexpr (lightingMode == LightingMode::Combined || lightingMode == LightingMode::ObservedArea)
+	{
+		if (observedArea <= 0.f) return true;
+	}
+
+	if (m_ShadowRayThreshold <= 0.f) return false;
+
+	float maxContribution{};
+	if constexpr (lightingMode == LightingMode::Combined)
+	{
+		const ColorRGB radiance{ LightUtils::GetRadiance(light, hitOrigin) };
+		maxContribution = std::max(radiance.r, std::max(radiance.g, radiance.b)) * material.GetMaxBRDF() * observedArea;
+	}
+	else if constexpr (lightingMode == LightingMode::ObservedArea)
+	{
+		maxContribution = observedArea;
+	}
+	else if constexpr (lightingMode == LightingMode::Radiance)
+	{
+		const ColorRGB radiance{ LightUtils::GetRadiance(light, hitOrigin) };
+		maxContribution = std::max(radiance.r, std::max(radiance.g, radiance.b));
+	}
+	else if constexpr (lightingMode == LightingMode::BRFD)
+	{
+		maxContribution = material.GetMaxBRDF();
+	}
+
+	return maxContribution < m_ShadowRayThreshold;
+}
+
+template<Renderer::LightingMode lightingMode, ShadingPrecision precision, MaterialType materialType>
 void Renderer::CalculateFinalColor
 (
 	const HitRecord& closestHit,
 	const Vector3& toLight,
-	const std::vector<Material_SolidColor*>& solidColorMaterials,
-	const std::vector<Material_Lambert*>& lambertMaterials,
-	const std::vector<Material_LambertPhong*>& lambertPhongMaterials,
-	const std::vector<Material_CookTorrence*>& cookTorrenceMaterials,
+	const Material& material,
 	const Light& light,
 	const Vector3& rayDirection,
 	ColorRGB& finalColor
@@ -252,62 +817,26 @@ void Renderer::CalculateFinalColor
 {
 	const float observedArea{ Vector3::Dot(closestHit.normal, toLight) };
 
-	switch (m_CurrentLightingMode)
+	if constexpr (lightingMode == LightingMode::Combined)
 	{
-	case LightingMode::Combined:
 		if (observedArea > 0.f)
 		{
-			switch ( closestHit.materialType )
-			{
-			case MaterialType::solidColor:
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin) * solidColorMaterials[closestHit.materialIndex]->Shade(closestHit, toLight, rayDirection) * observedArea;
-				break;
-
-			case MaterialType::lambert:
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin) * lambertMaterials[closestHit.materialIndex]->Shade(closestHit, toLight, rayDirection) * observedArea;
-				break;
-
-			case MaterialType::lambertPhong:
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin) * lambertPhongMaterials[closestHit.materialIndex]->Shade(closestHit, toLight, rayDirection) * observedArea;
-				break;
-
-			case MaterialType::cookTorrence:
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin) * cookTorrenceMaterials[closestHit.materialIndex]->Shade(closestHit, toLight, rayDirection) * observedArea;
-				break;
-			}
+			finalColor += LightUtils::GetRadiance(light, closestHit.origin) * material.Shade<materialType, precision>(closestHit, toLight, rayDirection) * observedArea;
 		}
-		break;
-
-	case LightingMode::ObservedArea:
+	}
+	else if constexpr (lightingMode == LightingMode::ObservedArea)
+	{
 		if (observedArea > 0.f)
 		{
 			finalColor += ColorRGB{ 1.f, 1.f, 1.f } *observedArea;
 		}
-		break;
-
-	case LightingMode::Radiance:
+	}
+	else if constexpr (lightingMode == LightingMode::Radiance)
+	{
 		finalColor += LightUtils::GetRadiance(light, closestHit.origin);
-		break;
-	
-	case LightingMode::BRFD:
-		switch (closestHit.materialType)
-		{
-		case MaterialType::solidColor:
-			finalColor += solidColorMaterials[closestHit.materialIndex]->Shade(closestHit, toLight, rayDirection);
-			break;
-
-		case MaterialType::lambert:
-			finalColor += lambertMaterials[closestHit.materialIndex]->Shade(closestHit, toLight, rayDirection);
-			break;
-
-		case MaterialType::lambertPhong:
-			finalColor += lambertPhongMaterials[closestHit.materialIndex]->Shade(closestHit, toLight, rayDirection);
-			break;
-
-		case MaterialType::cookTorrence:
-			finalColor += cookTorrenceMaterials[closestHit.materialIndex]->Shade(closestHit, toLight, rayDirection);
-			break;
-		}
-		break;
+	}
+	else if constexpr (lightingMode == LightingMode::BRFD)
+	{
+		finalColor += material.Shade<materialType, precision>(closestHit, toLight, rayDirection);
 	}
 }
\ No newline at end of file
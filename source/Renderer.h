@@ -2,6 +2,9 @@
 #include <cstdint>
 #include <vector>
 
+#include "LightBVH.h"
+#include "LightGrid.h"
+
 struct SDL_Window;
 struct SDL_Surface;
 
@@ -13,13 +16,20 @@ namespace dae
 	struct ColorRGB;
 	struct Camera;
 
-	class Material_SolidColor;
-	class Material_Lambert;
-	class Material_LambertPhong;
-	class Material_CookTorrence;
+	struct Material;
+	enum class MaterialType;
+	enum class ShadingPrecision;
 
 	class Scene;
 
+	namespace Wavefront
+	{
+		struct Tile;
+		struct Queues;
+		struct HitQueue;
+		struct ShadowRayQueue;
+	}
+
 	class Renderer final
 	{
 	public:
@@ -33,9 +43,50 @@ namespace dae
 
 		void Render(Scene* pScene) const;
 		bool SaveBufferToImage() const;
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
 		
 		void CycleLightingMode();
-		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; };
+		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; m_AccumulatedFrames = 0; };
+		void ToggleWavefront() { m_WavefrontEnabled = !m_WavefrontEnabled; };
+
+		//Light sampling shades a fixed amount of point lights per pixel, picked at random through the light bvh
+		void ToggleLightSampling() { m_LightSamplingEnabled = !m_LightSamplingEnabled; m_AccumulatedFrames = 0; };
+		void SetLightSamplesPerPixel(int amountOfSamples) { m_LightSamplesPerPixel = amountOfSamples; m_AccumulatedFrames = 0; };
+		//Averages the frames while the camera doesn't move, removes the noise of the light sampling (animated geometry will smear)
+		void ToggleAccumulation() { m_AccumulationEnabled = !m_AccumulationEnabled; m_AccumulatedFrames = 0; };
+
+		//Exact, fast (powf, sqrtf and the divides in the BRDFs swapped for the approximations in FastMath.h)
+		//and tabulated (GGX and Schlick-GGX read from the lookup tables in BRDFTables.h) shading
+		void CycleShadingPrecision();
+
+		//Difference between two renders in 8 bit channel values (what ends up on screen)
+		struct ImageError
+		{
+			int maxError{};
+			float meanError{};
+			float psnr{}; //in dB, infinite when both images are the same
+			int amountOfEdgePixels{}; //pixels with a channel off by more than 1, where the two renders hit or shadow something else
+		};
+
+		//Renders the frame once with exact shading and once with the given precision (same light samples) and compares the two,
+		//accumulation is skipped for both and the shading precision is left as it was
+		ImageError MeasureShadingError(Scene* pScene, ShadingPrecision precision);
+		//Renders both scenes with the current settings (same light samples, no accumulation) and compares the two, both have to be loaded
+		ImageError CompareScenes(Scene* pReference, Scene* pScene);
+
+		//Shadow rays to lights whose contribution is bound below this are skipped (0 only skips lights behind the surface)
+		void SetShadowRayThreshold(float threshold) { m_ShadowRayThreshold = threshold; m_AccumulatedFrames = 0; };
+		float GetShadowRayThreshold() const { return m_ShadowRayThreshold; };
+		//Off, then thresholds of roughly a quarter, one and four 8 bit color steps
+		void CycleShadowRayThreshold();
+		//Lights behind the surface are culled in the modes that only add light in front of it, the threshold culls in every mode
+		bool IsShadowRayCullingEnabled() const
+		{
+			return m_ShadowsEnabled && (m_ShadowRayThreshold > 0.f
+				|| m_CurrentLightingMode == LightingMode::Combined || m_CurrentLightingMode == LightingMode::ObservedArea);
+		};
+		uint64_t GetSkippedShadowRays() const { return m_SkippedShadowRays; };
 
 	private:
 		SDL_Window* m_pWindow{};
@@ -56,7 +107,56 @@ namespace dae
 
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
 		bool m_ShadowsEnabled{ true };
+		bool m_WavefrontEnabled{ false };
+		ShadingPrecision m_ShadingPrecision{}; //exact
+
+		float m_ShadowRayThreshold{ 0.f };
+		mutable std::vector<uint32_t> m_SkippedShadowRaysPerPixel{}; //written by the render threads, summed at the end of the frame
+		mutable uint64_t m_SkippedShadowRays{}; //of the last frame
+
+		mutable LightGrid m_LightGrid{}; //rebuilt at the start of every frame
+
+		bool m_LightSamplingEnabled{ false };
+		int m_LightSamplesPerPixel{ 4 };
+		mutable LightBVH m_LightBVH{}; //rebuilt at the start of every frame when light sampling is enabled
+		mutable uint32_t m_FrameIndex{}; //seeds the light sampling so every frame picks different lights
 
+		bool m_AccumulationEnabled{ false };
+		mutable std::vector<ColorRGB> m_AccumulationBuffer{};
+		mutable uint32_t m_AccumulatedFrames{};
+		mutable const Scene* m_pAccumulatedScene{};
+		mutable Vector3 m_AccumulatedCameraOrigin{};
+		mutable Vector3 m_AccumulatedCameraForward{};
+		mutable float m_AccumulatedCameraFov{};
+
+		mutable std::vector<ColorRGB> m_FrameBuffer{}; //colors of the frame, packed into m_pBufferPixels at the end of Render
+
+		//Accumulates (when enabled) and writes the color of a pixel to the frame buffer
+		void WritePixel(uint32_t pixelIndex, ColorRGB finalColor) const;
+		//Converts the whole frame buffer to the surface's pixel format with the kernel of the selected instruction set
+		void PackPixels() const;
+		//ImageError of the frame buffer against a frame rendered before
+		ImageError CompareWithFrameBuffer(const std::vector<ColorRGB>& referenceFrame) const;
+
+		//RenderPixel is specialized per lighting mode, shadow flag and shading precision (picked once per frame by SelectRenderPixel),
+		//the light loop per material type (picked once per hit), so the per light loop has no branches on these
+		using RenderPixelFunction = void (Renderer::*)
+		(
+			Scene* pScene,
+			uint32_t pixelIndex,
+			float fov,
+			float aspectRatio,
+			const Camera& camera,
+			const std::vector<Light>& lights,
+			const std::vector<Material>& materials
+		) const;
+
+		RenderPixelFunction SelectRenderPixel() const;
+
+		template<LightingMode lightingMode>
+		RenderPixelFunction SelectRenderPixel() const;
+
+		template<LightingMode lightingMode, bool shadowsEnabled, ShadingPrecision precision>
 		void RenderPixel
 		(
 			Scene* pScene,
@@ -65,23 +165,102 @@ namespace dae
 			float aspectRatio,
 			const Camera& camera,
 			const std::vector<Light>& lights,
-			const std::vector<Material_SolidColor*>& solidColorMaterials,
-			const std::vector<Material_Lambert*>& lambertMaterials,
-			const std::vector<Material_LambertPhong*>& lambertPhongMaterials,
-			const std::vector<Material_CookTorrence*>& cookTorrenceMaterials
+			const std::vector<Material>& materials
+		) const;
+
+		template<LightingMode lightingMode, bool shadowsEnabled, ShadingPrecision precision, MaterialType materialType>
+		void ShadeLights
+		(
+			Scene* pScene,
+			const HitRecord& closestHit,
+			const Material& material,
+			const std::vector<Light>& lights,
+			const Vector3& rayDirection,
+			ColorRGB& finalColor,
+			uint32_t& skippedShadowRays,
+			uint32_t pixelIndex
+		) const;
+
+		//True when the light can't visibly contribute, either it is behind the surface or an upper bound
+		//of its contribution (radiance * max BRDF * observed area) is below m_ShadowRayThreshold
+		template<LightingMode lightingMode>
+		bool IsLightNegligible
+		(
+			const Vector3& normal,
+			const Vector3& toLight,
+			const Vector3& hitOrigin,
+			const Light& light,
+			const Material& material
 		) const;
 
+		template<LightingMode lightingMode, ShadingPrecision precision, MaterialType materialType>
 		void CalculateFinalColor
 		(
 			const HitRecord& closestHit,
 			const Vector3& toLight,
-			const std::vector<Material_SolidColor*>& solidColorMaterials,
-			const std::vector<Material_Lambert*>& lambertMaterials,
-			const std::vector<Material_LambertPhong*>& lambertPhongMaterials,
-			const std::vector<Material_CookTorrence*>& cookTorrenceMaterials,
+			const Material& material,
 			const Light& light,
 			const Vector3& rayDirection,
 			ColorRGB& finalColor
 		) const;
+
+		//Wavefront mode, the frame is split in tiles that each run through the stages in Wavefront.h,
+		//only the shading stage lives here since it depends on the lighting mode
+		using RenderTileFunction = void (Renderer::*)
+		(
+			Scene* pScene,
+			const Wavefront::Tile& tile,
+			float fov,
+			float aspectRatio,
+			const Camera& camera,
+			const std::vector<Light>& lights,
+			const std::vector<Material>& materials,
+			Wavefront::Queues& queues
+		) const;
+
+		void RenderWavefront
+		(
+			Scene* pScene,
+			float fov,
+			float aspectRatio,
+			const Camera& camera,
+			const std::vector<Light>& lights,
+			const std::vector<Material>& materials
+		) const;
+
+		RenderTileFunction SelectRenderTile() const;
+
+		template<LightingMode lightingMode>
+		void RenderTile
+		(
+			Scene* pScene,
+			const Wavefront::Tile& tile,
+			float fov,
+			float aspectRatio,
+			const Camera& camera,
+			const std::vector<Light>& lights,
+			const std::vector<Material>& materials,
+			Wavefront::Queues& queues
+		) const;
+
+		//Removes the shadow rays of negligible lights from the queue (see IsLightNegligible)
+		template<LightingMode lightingMode>
+		void CullShadowRays
+		(
+			const Wavefront::HitQueue& hits,
+			Wavefront::ShadowRayQueue& shadowRays,
+			const std::vector<Light>& lights,
+			const std::vector<Material>& materials
+		) const;
+
+		//Shades the unoccluded shadow rays in batches of BATCH_WIDTH, a batch holds one material type (hits are sorted by material)
+		template<LightingMode lightingMode>
+		void ShadeWavefront
+		(
+			Wavefront::HitQueue& hits,
+			const Wavefront::ShadowRayQueue& shadowRays,
+			const std::vector<Light>& lights,
+			const std::vector<Material>& materials
+		) const;
 	};
 }
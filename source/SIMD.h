@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+#include "Vector3.h"
+
+//SSE is always there on x64 (and with /arch:SSE2 on x86), with /arch:AVX or -mavx the same intrinsics compile to VEX encoded AVX
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DAE_SIMD_SSE 1
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#else
+#define DAE_SIMD_SSE 0
+#endif
+
+namespace dae
+{
+	//4 floats in one SSE register, the scalar fallback keeps the same interface on other targets
+	//Vector3 values are loaded as {x, y, z, 0}, the horizontal XYZ functions ignore the 4th lane
+	struct alignas(16) Float4
+	{
+#if DAE_SIMD_SSE
+		__m128 value;
+
+		Float4() : value{ _mm_setzero_ps() } {}
+		Float4(__m128 v) : value{ v } {}
+		Float4(float x, float y, float z, float w) : value{ _mm_set_ps(w, z, y, x) } {}
+		explicit Float4(float v) : value{ _mm_set1_ps(v) } {}
+		explicit Float4(const Vector3& v) : value{ _mm_set_ps(0.f, v.z, v.y, v.x) } {}
+
+		float X() const { return _mm_cvtss_f32(value); }
+		float Y() const { return _mm_cvtss_f32(_mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1))); }
+		float Z() const { return _mm_cvtss_f32(_mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 2, 2, 2))); }
+		float W() const { return _mm_cvtss_f32(_mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+		//lane copied to all 4 lanes
+		Float4 SplatX() const { return _mm_shuffle_ps(value, value, _MM_SHUFFLE(0, 0, 0, 0)); }
+		Float4 SplatY() const { return _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1)); }
+		Float4 SplatZ() const { return _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 2, 2, 2)); }
+
+		Float4 operator+(const Float4& v) const { return _mm_add_ps(value, v.value); }
+		Float4 operator-(const Float4& v) const { return _mm_sub_ps(value, v.value); }
+		Float4 operator*(const Float4& v) const { return _mm_mul_ps(value, v.value); }
+		Float4 operator/(const Float4& v) const { return _mm_div_ps(value, v.value); }
+		Float4 operator-() const { return _mm_xor_ps(value, _mm_set1_ps(-0.f)); }
+
+		static Float4 Min(const Float4& v1, const Float4& v2) { return _mm_min_ps(v1.value, v2.value); }
+		static Float4 Max(const Float4& v1, const Float4& v2) { return _mm_max_ps(v1.value, v2.value); }
+		static Float4 Sqrt(const Float4& v) { return _mm_sqrt_ps(v.value); }
+
+		//all bits set in the lanes where v1 < v2
+		static Float4 Less(const Float4& v1, const Float4& v2) { return _mm_cmplt_ps(v1.value, v2.value); }
+		//per lane mask ? ifTrue : ifFalse, mask lanes are all ones or all zeros
+		static Float4 Select(const Float4& mask, const Float4& ifTrue, const Float4& ifFalse)
+		{
+			return _mm_or_ps(_mm_and_ps(mask.value, ifTrue.value), _mm_andnot_ps(mask.value, ifFalse.value));
+		}
+
+		float MinXYZ() const
+		{
+			const __m128 minXY{ _mm_min_ss(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1))) };
+			return _mm_cvtss_f32(_mm_min_ss(minXY, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 2, 2, 2))));
+		}
+
+		float MaxXYZ() const
+		{
+			const __m128 maxXY{ _mm_max_ss(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1))) };
+			return _mm_cvtss_f32(_mm_max_ss(maxXY, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 2, 2, 2))));
+		}
+#else
+		float value[4]{};
+
+		Float4() = default;
+		Float4(float x, float y, float z, float w) : value{ x, y, z, w } {}
+		explicit Float4(float v) : value{ v, v, v, v } {}
+		explicit Float4(const Vector3& v) : value{ v.x, v.y, v.z, 0.f } {}
+
+		float X() const { return value[0]; }
+		float Y() const { return value[1]; }
+		float Z() const { return value[2]; }
+		float W() const { return value[3]; }
+
+		Float4 SplatX() const { return Float4{ value[0] }; }
+		Float4 SplatY() const { return Float4{ value[1] }; }
+		Float4 SplatZ() const { return Float4{ value[2] }; }
+
+		Float4 operator+(const Float4& v) const { return { value[0] + v.value[0], value[1] + v.value[1], value[2] + v.value[2], value[3] + v.value[3] }; }
+		Float4 operator-(const Float4& v) const { return { value[0] - v.value[0], value[1] - v.value[1], value[2] - v.value[2], value[3] - v.value[3] }; }
+		Float4 operator*(const Float4& v) const { return { value[0] * v.value[0], value[1] * v.value[1], value[2] * v.value[2], value[3] * v.value[3] }; }
+		Float4 operator/(const Float4& v) const { return { value[0] / v.value[0], value[1] / v.value[1], value[2] / v.value[2], value[3] / v.value[3] }; }
+		Float4 operator-() const { return { -value[0], -value[1], -value[2], -value[3] }; }
+
+		//same operand order as minps/maxps: the second operand wins when a lane is NaN
+		static Float4 Min(const Float4& v1, const Float4& v2)
+		{
+			Float4 result{};
+			for (int lane{}; lane < 4; ++lane) result.value[lane] = v1.value[lane] < v2.value[lane] ? v1.value[lane] : v2.value[lane];
+			return result;
+		}
+
+		static Float4 Max(const Float4& v1, const Float4& v2)
+		{
+			Float4 result{};
+			for (int lane{}; lane < 4; ++lane) result.value[lane] = v1.value[lane] > v2.value[lane] ? v1.value[lane] : v2.value[lane];
+			return result;
+		}
+
+		static Float4 Sqrt(const Float4& v) { return { sqrtf(v.value[0]), sqrtf(v.value[1]), sqrtf(v.value[2]), sqrtf(v.value[3]) }; }
+
+		//lanes are 1 where v1 < v2, Select only looks at nonzero
+		static Float4 Less(const Float4& v1, const Float4& v2)
+		{
+			Float4 result{};
+			for (int lane{}; lane < 4; ++lane) result.value[lane] = v1.value[lane] < v2.value[lane] ? 1.f : 0.f;
+			return result;
+		}
+
+		static Float4 Select(const Float4& mask, const Float4& ifTrue, const Float4& ifFalse)
+		{
+			Float4 result{};
+			for (int lane{}; lane < 4; ++lane) result.value[lane] = mask.value[lane] != 0.f ? ifTrue.value[lane] : ifFalse.value[lane];
+			return result;
+		}
+
+		float MinXYZ() const
+		{
+			const float minXY{ value[0] < value[1] ? value[0] : value[1] };
+			return minXY < value[2] ? minXY : value[2];
+		}
+
+		float MaxXYZ() const
+		{
+			const float maxXY{ value[0] > value[1] ? value[0] : value[1] };
+			return maxXY > value[2] ? maxXY : value[2];
+		}
+#endif
+
+		Vector3 ToVector3() const { return { X(), Y(), Z() }; }
+	};
+}
@@ -1,5 +1,9 @@
 #include "Scene.h"
+
+#include <iostream>
+
 #include "Utils.h"
+#include "MeshCache.h"
 #include "Material.h"
 
 namespace dae {
@@ -7,154 +11,319 @@ namespace dae {
 #pragma region Base Scene
 	Scene::Scene()
 	{
-		m_SphereGeometries.reserve(32);
-		m_PlaneGeometries.reserve(32);
-		m_TriangleMeshGeometries.reserve(32);
-		m_Lights.reserve(32);
+		m_PlaneGeometries.Reserve(32);
+		m_TriangleMeshGeometries.Reserve(32);
+		m_Lights.Reserve(32);
 	}
 
-	Scene::~Scene()
+	Scene::~Scene() = default;
+
+	//Traversal only keeps t and which primitive was hit, the hit attributes are computed once at the end
+	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
 	{
-		for (auto& pMaterial : m_SolidColorMaterials)
+		//spheres and triangles go through the kernels of the selected instruction set (see Kernels.h)
+		const Kernels::Table& kernels{ Kernels::Get() };
+
+		const int closestSphere{ kernels.closestHitSpheres(GeometryUtils::GetSphereList(m_SphereGeometries), ray, closestHit.t) };
+		if (closestSphere >= 0)
 		{
-			delete pMaterial;
-			pMaterial = nullptr;
+			closestHit.primitiveType = PrimitiveType::Sphere;
+			closestHit.primitiveIndex = closestSphere;
 		}
-		m_SolidColorMaterials.clear();
 
-		for (auto& pMaterial : m_LambertMaterials)
+		//only the mesh traversal needs the prepared ray, built once here for all meshes
+		if (!m_TriangleMeshGeometries.Empty() || !m_StreamedMeshes.empty())
 		{
-			delete pMaterial;
-			pMaterial = nullptr;
+			const PreparedRay preparedRay{ ray };
+			if (GeometryUtils::SlabTest_TriangleMesh(m_AABBTriangleMeshes.min, m_AABBTriangleMeshes.max, preparedRay))
+			{
+				const int amountOfTrianglesMeshes{ static_cast<int>(m_TriangleMeshGeometries.Size()) };
+				for (int index{}; index < amountOfTrianglesMeshes; ++index)
+				{
+					if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[index], preparedRay, closestHit))
+					{
+						closestHit.primitiveType = PrimitiveType::TriangleMesh;
+						closestHit.primitiveIndex = index;
+					}
+				}
+
+				const int amountOfStreamedMeshes{ static_cast<int>(m_StreamedMeshes.size()) };
+				for (int index{}; index < amountOfStreamedMeshes; ++index)
+				{
+					if (GeometryUtils::HitTest_StreamedMesh(*m_StreamedMeshes[index], preparedRay, closestHit))
+					{
+						closestHit.primitiveType = PrimitiveType::StreamedMesh;
+						closestHit.primitiveIndex = index;
+					}
+				}
+			}
 		}
-		m_LambertMaterials.clear();
 
-		for (auto& pMaterial : m_LambertPhongMaterials)
+		const int amountOfPlanes{ static_cast<int>(m_PlaneGeometries.Size()) };
+		for (int index{}; index < amountOfPlanes; ++index)
 		{
-			delete pMaterial;
-			pMaterial = nullptr;
+			if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[index], ray, closestHit))
+			{
+				closestHit.primitiveType = PrimitiveType::Plane;
+				closestHit.primitiveIndex = index;
+			}
 		}
-		m_LambertPhongMaterials.clear();
 
-		for (auto& pMaterial : m_CookTorrenceMaterials)
+		switch (closestHit.primitiveType)
 		{
-			delete pMaterial;
-			pMaterial = nullptr;
+		case PrimitiveType::Sphere:
+			GeometryUtils::GetHitAttributes(m_SphereGeometries, static_cast<int>(closestHit.primitiveIndex), ray, closestHit);
+			break;
+		case PrimitiveType::Plane:
+			GeometryUtils::GetHitAttributes(m_PlaneGeometries[closestHit.primitiveIndex], ray, closestHit);
+			break;
+		case PrimitiveType::TriangleMesh:
+			GeometryUtils::GetHitAttributes(m_TriangleMeshGeometries[closestHit.primitiveIndex], ray, closestHit);
+			break;
+		case PrimitiveType::StreamedMesh:
+			GeometryUtils::GetHitAttributes(*m_StreamedMeshes[closestHit.primitiveIndex], ray, closestHit);
+			break;
+		default:
+			break;
 		}
-		m_CookTorrenceMaterials.clear();
 	}
 
-	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
+	//Occlusion path: any-hit tests only, nothing writes a hit record and every test stops at the first blocker
+	bool Scene::DoesHit(const Ray& ray) const
 	{
-		const int amountOfSpheres{ static_cast<int>(m_SphereGeometries.size()) };
-		for (int index{}; index < amountOfSpheres; ++index)
-		{
-			GeometryUtils::HitTest_Sphere(m_SphereGeometries[index], ray, closestHit);
+		if (Kernels::Get().anyHitSpheres(GeometryUtils::GetSphereList(m_SphereGeometries), ray)) return true;
 
-		}
-
-		if (GeometryUtils::SlabTest_TriangleMesh(m_AABBTriangleMeshes.min, m_AABBTriangleMeshes.max, ray))
+		//only the mesh traversal needs the prepared ray, built once here for all meshes
+		if (!m_TriangleMeshGeometries.Empty() || !m_StreamedMeshes.empty())
 		{
-			const int amountOfTrianglesMeshes{ static_cast<int>(m_TriangleMeshGeometries.size()) };
-			for (int index{}; index < amountOfTrianglesMeshes; ++index)
+			const PreparedRay preparedRay{ ray };
+			if (GeometryUtils::SlabTest_TriangleMesh(m_AABBTriangleMeshes.min, m_AABBTriangleMeshes.max, preparedRay))
 			{
-				GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[index], ray, closestHit);
+				const int amountOfTriangles{ static_cast<int>(m_TriangleMeshGeometries.Size()) };
+				for (int index{}; index < amountOfTriangles; ++index)
+				{
+					if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[index], preparedRay))
+					{
+						return true;
+					}
+				}
+
+				for (const std::unique_ptr<StreamedMesh>& pMesh : m_StreamedMeshes)
+				{
+					if (GeometryUtils::HitTest_StreamedMesh(*pMesh, preparedRay))
+					{
+						return true;
+					}
+				}
 			}
 		}
 
-		const int amountOfPlanes{ static_cast<int>(m_PlaneGeometries.size()) };
+		const int amountOfPlanes{static_cast<int>(m_PlaneGeometries.Size()) };
 		for (int index{}; index < amountOfPlanes; ++index)
 		{
-			GeometryUtils::HitTest_Plane(m_PlaneGeometries[index], ray, closestHit);
+			if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[index], ray))
+			{
+				return true;
+			}
 		}
+
+		return false;
 	}
 
-	bool Scene::DoesHit(const Ray& ray) const
+#pragma region Async Loading
+	void Scene::LoadTriangleMeshAsync(Handle<TriangleMesh> meshHandle, const std::string& objFilename)
 	{
-		HitRecord closestHit{};
+		AsyncMeshLoad load{};
+		load.mesh = meshHandle;
+		load.objFilename = objFilename;
 
-		const int amountOfSpheres{ static_cast<int>(m_SphereGeometries.size()) };
-		for (int index{}; index < amountOfSpheres; ++index)
-		{
-			if (GeometryUtils::HitTest_Sphere(m_SphereGeometries[index], ray, closestHit, true))
+		std::promise<AABB> boundsPromise{};
+		load.bounds = boundsPromise.get_future();
+
+		//the worker loads into its own copy of the mesh (same settings and transforms), the scene only sees it once it is swapped in
+		load.loadedMesh = std::async(std::launch::async, [mesh = m_TriangleMeshGeometries[meshHandle], objFilename, boundsPromise = std::move(boundsPromise)]() mutable
 			{
-				return true;
-			}
-		}
+				//nothing may escape the worker, get() would rethrow it on the main thread. A failed load hands back the mesh as it was
+				//before loading (no geometry), swapping it in drops the placeholder
+				const TriangleMesh emptyMesh{ mesh };
+				AsyncMeshLoad::Result result{};
 
-		if (GeometryUtils::SlabTest_TriangleMesh(m_AABBTriangleMeshes.min, m_AABBTriangleMeshes.max, ray))
+				bool boundsSet{ false };
+				try
+				{
+					const bool loaded{ Utils::LoadTriangleMeshCached(objFilename, mesh, [&](const TriangleMesh& loadedMesh)
+						{
+							AABB bounds{};
+							bounds.Grow(loadedMesh.minAABB);
+							bounds.Grow(loadedMesh.maxAABB);
+							boundsPromise.set_value(bounds);
+							boundsSet = true;
+						}) };
+
+					if (!loaded) result.error = "the file could not be read";
+				}
+				catch (const std::exception& exception)
+				{
+					result.error = exception.what();
+				}
+				catch (...)
+				{
+					result.error = "unknown exception";
+				}
+
+				if (!boundsSet) boundsPromise.set_value(AABB{});
+
+				result.mesh = result.error.empty() ? std::move(mesh) : emptyMesh;
+				return result;
+			});
+
+		m_AsyncMeshLoads.push_back(std::move(load));
+	}
+
+	//Called at the start of every frame (from Scene::Update) so geometry never changes while a frame is rendering
+	void Scene::UpdateAsyncMeshLoads()
+	{
+		for (auto it{ m_AsyncMeshLoads.begin() }; it != m_AsyncMeshLoads.end();)
 		{
-			const int amountOfTriangles{ static_cast<int>(m_TriangleMeshGeometries.size()) };
-			for (int index{}; index < amountOfTriangles; ++index)
+			TriangleMesh& mesh{ m_TriangleMeshGeometries[it->mesh] };
+
+			if (it->loadedMesh.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
 			{
-				if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[index], ray, closestHit, true))
+				AsyncMeshLoad::Result result{ it->loadedMesh.get() };
+				TriangleMesh& loadedMesh{ result.mesh };
+
+				//keep the transforms that were set while the mesh was loading
+				loadedMesh.rotationTransform = mesh.rotationTransform;
+				loadedMesh.translationTransform = mesh.translationTransform;
+				loadedMesh.scaleTransform = mesh.scaleTransform;
+				loadedMesh.UpdateTransforms();
+				if (loadedMesh.useBVH) loadedMesh.RefitBVH();
+
+				mesh = std::move(loadedMesh);
+				if (result.error.empty())
 				{
-					return true;
+					m_AABBTriangleMeshes.Grow(mesh.transformedMinAABB);
+					m_AABBTriangleMeshes.Grow(mesh.transformedMaxAABB);
 				}
+				else
+				{
+					std::cout << "Loading " << it->objFilename << " failed: " << result.error << std::endl;
+				}
+
+				it = m_AsyncMeshLoads.erase(it);
+				continue;
 			}
-		}
 
-		const int amountOfPlanes{static_cast<int>(m_PlaneGeometries.size()) };
-		for (int index{}; index < amountOfPlanes; ++index)
-		{
-			if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[index], ray, closestHit, true))
+			if (!it->hasPlaceholder && it->bounds.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
 			{
-				return true;
+				it->hasPlaceholder = true;
+
+				const AABB bounds{ it->bounds.get() };
+				if (bounds.min.x <= bounds.max.x)
+				{
+					//box with outward facing triangles
+					const Vector3 center{ (bounds.min + bounds.max) / 2.f };
+					std::vector<Triangle> boxTriangles{};
+					for (int axis{}; axis < 3; ++axis)
+					{
+						for (const float side : { bounds.min[axis], bounds.max[axis] })
+						{
+							Vector3 corners[4]{};
+							for (int cornerIndex{}; cornerIndex < 4; ++cornerIndex)
+							{
+								corners[cornerIndex][axis] = side;
+								corners[cornerIndex][(axis + 1) % 3] = (cornerIndex == 1 || cornerIndex == 2) ? bounds.max[(axis + 1) % 3] : bounds.min[(axis + 1) % 3];
+								corners[cornerIndex][(axis + 2) % 3] = (cornerIndex >= 2) ? bounds.max[(axis + 2) % 3] : bounds.min[(axis + 2) % 3];
+							}
+
+							for (const Triangle& triangle : { Triangle{ corners[0], corners[1], corners[2] }, Triangle{ corners[0], corners[2], corners[3] } })
+							{
+								const bool facesInward{ Vector3::Dot(triangle.normal, triangle.v0 - center) < 0.f };
+								boxTriangles.push_back(facesInward ? Triangle{ triangle.v0, triangle.v2, triangle.v1 } : triangle);
+							}
+						}
+					}
+
+					mesh.lazyBVH = false;
+					mesh.AppendTriangles(boxTriangles);
+					if (mesh.useBVH) mesh.BuildBVH();
+
+					m_AABBTriangleMeshes.Grow(mesh.transformedMinAABB);
+					m_AABBTriangleMeshes.Grow(mesh.transformedMaxAABB);
+				}
 			}
-		}
 
-		return false;
+			++it;
+		}
 	}
+#pragma endregion
 
 #pragma region Scene Helpers
-	Sphere* Scene::AddSphere(const Vector3& origin, float radius, MaterialType materialType, unsigned char materialIndex)
+	//spheres only exist as entries of the sphere arrays, there is no sphere object to return
+	void Scene::AddSphere(const Vector3& origin, float radius, uint16_t materialId)
 	{
-		Sphere s;
-		s.origin = origin;
-		s.radius = radius;
-		s.materialIndex = materialIndex;
-		s.materialType = materialType;
-
-		m_SphereGeometries.emplace_back(s);
-		return &m_SphereGeometries.back();
+		m_SphereGeometries.Push(origin, radius, materialId);
 	}
 
-	Plane* Scene::AddPlane(const Vector3& origin, const Vector3& normal, MaterialType materialType, unsigned char materialIndex)
+	Handle<Plane> Scene::AddPlane(const Vector3& origin, const Vector3& normal, uint16_t materialId)
 	{
 		Plane p;
 		p.origin = origin;
 		p.normal = normal;
-		p.materialIndex = materialIndex;
-		p.materialType = materialType;
+		p.materialId = materialId;
 
-		m_PlaneGeometries.emplace_back(p);
-		return &m_PlaneGeometries.back();
+		return m_PlaneGeometries.Add(p);
 	}
 
-	TriangleMesh* Scene::AddTriangleMesh(TriangleCullMode cullMode, MaterialType materialType, unsigned char materialIndex)
+	//constructed in place, a mesh is only moved when the pool grows
+	Handle<TriangleMesh> Scene::AddTriangleMesh(TriangleCullMode cullMode, uint16_t materialId)
 	{
-		TriangleMesh m{};
+		const Handle<TriangleMesh> handle{ m_TriangleMeshGeometries.Add() };
+
+		TriangleMesh& m{ m_TriangleMeshGeometries[handle] };
 		m.cullMode = cullMode;
-		m.materialIndex = materialIndex;
-		m.materialType = materialType;
+		m.materialId = materialId;
+		m.bvhLeafSize = Kernels::Get().triangleLeafSize;
+
+		return handle;
+	}
+
+	StreamedMesh* Scene::AddStreamedMesh(const std::string& filename, TriangleCullMode cullMode, uint16_t materialId, size_t memoryBudget)
+	{
+		StreamedMesh* pMesh{ m_StreamedMeshes.emplace_back(std::make_unique<StreamedMesh>()).get() };
+		pMesh->cullMode = cullMode;
+		pMesh->materialId = materialId;
+		pMesh->SetMemoryBudget(memoryBudget);
+
+		if (pMesh->Open(filename))
+		{
+			m_AABBTriangleMeshes.Grow(pMesh->GetBounds().min);
+			m_AABBTriangleMeshes.Grow(pMesh->GetBounds().max);
+		}
 
-		m_TriangleMeshGeometries.emplace_back(m);
-		return &m_TriangleMeshGeometries.back();
+		return pMesh;
 	}
 
-	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
+	StreamingStatistics Scene::GetStreamingStatistics() const
+	{
+		StreamingStatistics statistics{};
+		for (const std::unique_ptr<StreamedMesh>& pMesh : m_StreamedMeshes) statistics += pMesh->GetStatistics();
+		return statistics;
+	}
+
+	Handle<Light> Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color, float radius)
 	{
 		Light l;
 		l.origin = origin;
 		l.intensity = intensity;
 		l.color = color;
+		l.radius = radius;
 		l.type = LightType::Point;
 
-		m_Lights.emplace_back(l);
-		return &m_Lights.back();
+		return m_Lights.Add(l);
 	}
 
-	Light* Scene::AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color)
+	Handle<Light> Scene::AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color)
 	{
 		Light l;
 		l.direction = direction;
@@ -162,32 +331,13 @@ namespace dae {
 		l.color = color;
 		l.type = LightType::Directional;
 
-		m_Lights.emplace_back(l);
-		return &m_Lights.back();
-	}
-
-	unsigned char Scene::AddMaterialSolidColor(Material_SolidColor* pMaterial)
-	{
-		m_SolidColorMaterials.push_back(pMaterial);
-		return static_cast<unsigned char>(m_SolidColorMaterials.size() - 1);
-	}
-
-	unsigned char Scene::AddMaterialLambert(Material_Lambert* pMaterial)
-	{
-		m_LambertMaterials.push_back(pMaterial);
-		return static_cast<unsigned char>(m_LambertMaterials.size() - 1);
-	}
-
-	unsigned char Scene::AddMaterialLambertPhong(Material_LambertPhong* pMaterial)
-	{
-		m_LambertPhongMaterials.push_back(pMaterial);
-		return static_cast<unsigned char>(m_LambertPhongMaterials.size() - 1);
+		return m_Lights.Add(l);
 	}
 
-	unsigned char Scene::AddMaterialCookTorrence(Material_CookTorrence* pMaterial)
+	uint16_t Scene::AddMaterial(const Material& material)
 	{
-		m_CookTorrenceMaterials.push_back(pMaterial);
-		return static_cast<unsigned char>(m_CookTorrenceMaterials.size() - 1);
+		m_Materials.push_back(material);
+		return static_cast<uint16_t>(m_Materials.size() - 1);
 	}
 #pragma endregion
 #pragma endregion
@@ -195,23 +345,23 @@ namespace dae {
 #pragma region SCENE W1
 	void Scene_W1::Initialize()
 	{
-		const unsigned char matId_Solid_Red = AddMaterialSolidColor(new Material_SolidColor{ colors::Red });
-		const unsigned char matId_Solid_Blue = AddMaterialSolidColor(new Material_SolidColor{ colors::Blue });
+		const uint16_t matId_Solid_Red = AddMaterial(Material_SolidColor{ colors::Red });
+		const uint16_t matId_Solid_Blue = AddMaterial(Material_SolidColor{ colors::Blue });
 
-		const unsigned char matId_Solid_Yellow = AddMaterialSolidColor(new Material_SolidColor{ colors::Yellow });
-		const unsigned char matId_Solid_Green = AddMaterialSolidColor(new Material_SolidColor{ colors::Green });
-		const unsigned char matId_Solid_Magenta = AddMaterialSolidColor(new Material_SolidColor{ colors::Magenta });
+		const uint16_t matId_Solid_Yellow = AddMaterial(Material_SolidColor{ colors::Yellow });
+		const uint16_t matId_Solid_Green = AddMaterial(Material_SolidColor{ colors::Green });
+		const uint16_t matId_Solid_Magenta = AddMaterial(Material_SolidColor{ colors::Magenta });
 
 		//Spheres
-		AddSphere({ -25.f, 0.f, 100.f }, 50.f, MaterialType::solidColor, matId_Solid_Red);
-		AddSphere({ 25.f, 0.f, 100.f }, 50.f, MaterialType::solidColor, matId_Solid_Blue);
+		AddSphere({ -25.f, 0.f, 100.f }, 50.f, matId_Solid_Red);
+		AddSphere({ 25.f, 0.f, 100.f }, 50.f, matId_Solid_Blue);
 
 		//Plane
-		AddPlane({ -75.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, MaterialType::solidColor, matId_Solid_Green);
-		AddPlane({ 75.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, MaterialType::solidColor, matId_Solid_Green);
-		AddPlane({ 0.f, -75.f, 0.f }, { 0.f, 1.f, 0.f }, MaterialType::solidColor, matId_Solid_Yellow);
-		AddPlane({ 0.f, 75.f, 0.f }, { 0.f, -1.f, 0.f }, MaterialType::solidColor, matId_Solid_Yellow);
-		AddPlane({ 0.f, 0.f, 125.f }, { 0.f, 0.f,-1.f }, MaterialType::solidColor, matId_Solid_Magenta);
+		AddPlane({ -75.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, matId_Solid_Green);
+		AddPlane({ 75.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, matId_Solid_Green);
+		AddPlane({ 0.f, -75.f, 0.f }, { 0.f, 1.f, 0.f }, matId_Solid_Yellow);
+		AddPlane({ 0.f, 75.f, 0.f }, { 0.f, -1.f, 0.f }, matId_Solid_Yellow);
+		AddPlane({ 0.f, 0.f, 125.f }, { 0.f, 0.f,-1.f }, matId_Solid_Magenta);
 	}
 #pragma endregion
 
@@ -221,27 +371,27 @@ namespace dae {
 		m_Camera.origin = { 0.f, 3.f, -9.f };
 		m_Camera.fovAngle = 45.f;
 
-		const unsigned char matId_Solid_Red = AddMaterialSolidColor(new Material_SolidColor{ colors::Red });
-		const unsigned char matId_Solid_Blue = AddMaterialSolidColor(new Material_SolidColor{ colors::Blue });
+		const uint16_t matId_Solid_Red = AddMaterial(Material_SolidColor{ colors::Red });
+		const uint16_t matId_Solid_Blue = AddMaterial(Material_SolidColor{ colors::Blue });
 
-		const unsigned char matId_Solid_Yellow = AddMaterialSolidColor(new Material_SolidColor{ colors::Yellow });
-		const unsigned char matId_Solid_Green = AddMaterialSolidColor(new Material_SolidColor{ colors::Green });
-		const unsigned char matId_Solid_Magenta = AddMaterialSolidColor(new Material_SolidColor{ colors::Magenta });
+		const uint16_t matId_Solid_Yellow = AddMaterial(Material_SolidColor{ colors::Yellow });
+		const uint16_t matId_Solid_Green = AddMaterial(Material_SolidColor{ colors::Green });
+		const uint16_t matId_Solid_Magenta = AddMaterial(Material_SolidColor{ colors::Magenta });
 
 		//Plane
-		AddPlane({ -5.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, MaterialType::solidColor, matId_Solid_Green);
-		AddPlane({ 5.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, MaterialType::solidColor, matId_Solid_Green);
-		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, MaterialType::solidColor, matId_Solid_Yellow);
-		AddPlane({ 0.f, 10.f, 0.f }, { 0.f, -1.f, 0.f }, MaterialType::solidColor, matId_Solid_Yellow);
-		AddPlane({ 0.f, 0.f, 10.f }, { 0.f, 0.f, -1.f }, MaterialType::solidColor, matId_Solid_Magenta);
+		AddPlane({ -5.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, matId_Solid_Green);
+		AddPlane({ 5.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, matId_Solid_Green);
+		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, matId_Solid_Yellow);
+		AddPlane({ 0.f, 10.f, 0.f }, { 0.f, -1.f, 0.f }, matId_Solid_Yellow);
+		AddPlane({ 0.f, 0.f, 10.f }, { 0.f, 0.f, -1.f }, matId_Solid_Magenta);
 
 		//Spheres
-		AddSphere({ -1.75f, 1.f, 0.f }, .75f, MaterialType::solidColor, matId_Solid_Red);
-		AddSphere({ 0.f, 1.f, 0.f }, .75f, MaterialType::solidColor, matId_Solid_Blue);
-		AddSphere({ 1.75f, 1.f, 0.f }, .75f, MaterialType::solidColor, matId_Solid_Red);
-		AddSphere({ -1.75f, 3.f, 0.f }, .75f, MaterialType::solidColor, matId_Solid_Blue);
-		AddSphere({ 0.f, 3.f, 0.f }, .75f, MaterialType::solidColor, matId_Solid_Red);
-		AddSphere({ 1.75f, 3.f, 0.f }, .75f, MaterialType::solidColor, matId_Solid_Blue);
+		AddSphere({ -1.75f, 1.f, 0.f }, .75f, matId_Solid_Red);
+		AddSphere({ 0.f, 1.f, 0.f }, .75f, matId_Solid_Blue);
+		AddSphere({ 1.75f, 1.f, 0.f }, .75f, matId_Solid_Red);
+		AddSphere({ -1.75f, 3.f, 0.f }, .75f, matId_Solid_Blue);
+		AddSphere({ 0.f, 3.f, 0.f }, .75f, matId_Solid_Red);
+		AddSphere({ 1.75f, 3.f, 0.f }, .75f, matId_Solid_Blue);
 
 		//Light
 		AddPointLight({ 0.f, 5.f, -5.f }, 70.f, colors::White);
@@ -254,38 +404,38 @@ namespace dae {
 		m_Camera.origin = { 0.f, 3.f, -9.f };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matCT_GrayRoughMetal{ AddMaterialCookTorrence(new Material_CookTorrence({.972f, .960f, .915f}, 1.f, 1.f)) };
-		const auto matCT_GrayMediumMetal{ AddMaterialCookTorrence(new Material_CookTorrence({.972f, .960f, .915f}, 1.f, .6f)) };
-		const auto matCT_GraySmoothMetal{ AddMaterialCookTorrence(new Material_CookTorrence({.972f, .960f, .915f}, 1.f, .1f)) };
-		const auto matCT_GrayRoughPlastic{ AddMaterialCookTorrence(new Material_CookTorrence({.75f, .75f, .75f}, .0f, 1.f)) };
-		const auto matCT_GrayMediumPlastic{ AddMaterialCookTorrence(new Material_CookTorrence({.75f, .75f, .75f}, .0f, .6f)) };
-		const auto matCT_GraySmoothPlastic{ AddMaterialCookTorrence(new Material_CookTorrence({.75f, .75f, .75f}, .0f, .1f)) };
+		const auto matCT_GrayRoughMetal{ AddMaterial(Material_CookTorrence({.972f, .960f, .915f}, 1.f, 1.f)) };
+		const auto matCT_GrayMediumMetal{ AddMaterial(Material_CookTorrence({.972f, .960f, .915f}, 1.f, .6f)) };
+		const auto matCT_GraySmoothMetal{ AddMaterial(Material_CookTorrence({.972f, .960f, .915f}, 1.f, .1f)) };
+		const auto matCT_GrayRoughPlastic{ AddMaterial(Material_CookTorrence({.75f, .75f, .75f}, .0f, 1.f)) };
+		const auto matCT_GrayMediumPlastic{ AddMaterial(Material_CookTorrence({.75f, .75f, .75f}, .0f, .6f)) };
+		const auto matCT_GraySmoothPlastic{ AddMaterial(Material_CookTorrence({.75f, .75f, .75f}, .0f, .1f)) };
 
-		const auto matLambert_GrayBlue{ AddMaterialLambert(new Material_Lambert({.49f, .57f, .57f}, 1.f)) };
+		const auto matLambert_GrayBlue{ AddMaterial(Material_Lambert({.49f, .57f, .57f}, 1.f)) };
 
 		//lambert-Phong spheres and materials for testing
-		//const auto matLambertPhong1 = AddMaterialLambertPhong(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 3.f));
-		//const auto matLambertPhong2 = AddMaterialLambertPhong(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 15.f));
-		//const auto matLambertPhong3 = AddMaterialLambertPhong(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 50.f));
+		//const auto matLambertPhong1 = AddMaterial(Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 3.f));
+		//const auto matLambertPhong2 = AddMaterial(Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 15.f));
+		//const auto matLambertPhong3 = AddMaterial(Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 50.f));
 
-		//AddSphere(Vector3{ -1.75f, 1.f, 0.f }, .75f, MaterialType::lambertPhong, matLambertPhong1);
-		//AddSphere(Vector3{ 0.f, 1.f, 0.f }, .75f, MaterialType::lambertPhong, matLambertPhong2);
-		//AddSphere(Vector3{ 1.75f, 1.f, 0.f }, .75f, MaterialType::lambertPhong, matLambertPhong3);
+		//AddSphere(Vector3{ -1.75f, 1.f, 0.f }, .75f, matLambertPhong1);
+		//AddSphere(Vector3{ 0.f, 1.f, 0.f }, .75f, matLambertPhong2);
+		//AddSphere(Vector3{ 1.75f, 1.f, 0.f }, .75f, matLambertPhong3);
 
 		//Planes
-		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, MaterialType::lambertPhong, matLambert_GrayBlue); //back
-		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, MaterialType::lambertPhong, matLambert_GrayBlue); //bottom
-		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, MaterialType::lambertPhong, matLambert_GrayBlue); //top
-		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, MaterialType::lambertPhong, matLambert_GrayBlue); //right
-		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, MaterialType::lambertPhong, matLambert_GrayBlue); //left
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //back
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //bottom
+		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, matLambert_GrayBlue); //top
+		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //right
+		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //left
 
 		//Spheres
-		AddSphere(Vector3{ -1.75, 1.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GrayRoughMetal);
-		AddSphere(Vector3{ 0.f, 1.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GrayMediumMetal);
-		AddSphere(Vector3{ 1.75, 1.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GraySmoothMetal);
-		AddSphere(Vector3{ -1.75, 3.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GrayRoughPlastic);
-		AddSphere(Vector3{ 0.f, 3.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GrayMediumPlastic);
-		AddSphere(Vector3{ 1.75, 3.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GraySmoothPlastic);
+		AddSphere(Vector3{ -1.75, 1.f, 0.f }, .75f, matCT_GrayRoughMetal);
+		AddSphere(Vector3{ 0.f, 1.f, 0.f }, .75f, matCT_GrayMediumMetal);
+		AddSphere(Vector3{ 1.75, 1.f, 0.f }, .75f, matCT_GraySmoothMetal);
+		AddSphere(Vector3{ -1.75, 3.f, 0.f }, .75f, matCT_GrayRoughPlastic);
+		AddSphere(Vector3{ 0.f, 3.f, 0.f }, .75f, matCT_GrayMediumPlastic);
+		AddSphere(Vector3{ 1.75, 3.f, 0.f }, .75f, matCT_GraySmoothPlastic);
 
 		//Lights
 		AddPointLight(Vector3{ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //Back Light
@@ -300,24 +450,23 @@ namespace dae {
 		m_Camera.origin = { 0.f, 1.f, -5.f };
 		m_Camera.fovAngle = 45.f;
 
-		const unsigned char matId_Solid_Red = AddMaterialSolidColor(new Material_SolidColor{ colors::Red });
-		const unsigned char matId_Solid_Blue = AddMaterialSolidColor(new Material_SolidColor{ colors::Blue });
-		const unsigned char matId_Solid_Yellow = AddMaterialSolidColor(new Material_SolidColor{ colors::Yellow });
+		const uint16_t matId_Solid_Red = AddMaterial(Material_SolidColor{ colors::Red });
+		const uint16_t matId_Solid_Yellow = AddMaterial(Material_SolidColor{ colors::Yellow });
 
 		//Lambert Materials
-		//const auto matLambert_Red = AddMaterialLambert(new Material_Lambert{ colors::Red, 1.f });
-		//const auto matLambert_Blue = AddMaterialLambert(new Material_Lambert{ colors::Blue, 1.f });
-		//const auto matLambert_Yellow = AddMaterialLambert(new Material_Lambert{ colors::Yellow, 1.f });
+		//const auto matLambert_Red = AddMaterial(Material_Lambert{ colors::Red, 1.f });
+		//const auto matLambert_Blue = AddMaterial(Material_Lambert{ colors::Blue, 1.f });
+		//const auto matLambert_Yellow = AddMaterial(Material_Lambert{ colors::Yellow, 1.f });
 
 		//Phong Material
-		const auto matLambertPhong_Blue = AddMaterialLambertPhong(new Material_LambertPhong(colors::Blue, 1.f, 1.f, 6.f));
+		const auto matLambertPhong_Blue = AddMaterial(Material_LambertPhong(colors::Blue, 1.f, 1.f, 6.f));
 
 		//Spheres
-		AddSphere({ -.75f, 1.f, .0f }, 1.f, MaterialType::solidColor, matId_Solid_Red);
-		AddSphere({ .75f, 1.f, .0f }, 1.f, MaterialType::solidColor, matLambertPhong_Blue);
+		AddSphere({ -.75f, 1.f, .0f }, 1.f, matId_Solid_Red);
+		AddSphere({ .75f, 1.f, .0f }, 1.f, matLambertPhong_Blue);
 
 		//Plane
-		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, MaterialType::solidColor, matId_Solid_Yellow);
+		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, matId_Solid_Yellow);
 
 		//Light
 		AddPointLight({ 0.f, 5.f, 5.f }, 25.f, colors::White);
@@ -332,15 +481,15 @@ namespace dae {
 		m_Camera.fovAngle = 45.f;
 
 		//Materials
-		const auto matLambert_GrayBlue = AddMaterialLambert(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const auto matLambert_White = AddMaterialLambert(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material_Lambert({ .49f, .57f, .57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material_Lambert(colors::White, 1.f));
 
 		//planes
-		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, MaterialType::lambert, matLambert_GrayBlue); //back
-		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //bottom
-		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //top
-		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //right
-		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //left
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //back
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //bottom
+		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, matLambert_GrayBlue); //top
+		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //right
+		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //left
 
 		//triangle (temp) DOES NOT WORK ANYMORE ADD m_Triangles in Scene.h for this to work!
 		//auto triangle = Triangle{ {-.75f, .5f, 0.f}, {-.75f, 2.f, 0.f}, {.75f, .5f, 0.f} };
@@ -350,17 +499,23 @@ namespace dae {
 		//m_Triangles.emplace_back(triangle);
 
 		//Triangle Mesh
-		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, MaterialType::lambert, matLambert_White);
+		m_Mesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
+		TriangleMesh& mesh{ m_TriangleMeshGeometries[m_Mesh] };
 
 		Utils::ParseOBJ("Resources/simple_object.obj",
-			pMesh->positions,
-			pMesh->normals,
-			pMesh->indices);
+			mesh.positions,
+			mesh.normals,
+			mesh.indices);
 
-		pMesh->Scale({ .7f, .7f, .7f });
-		pMesh->Translate({ 0.f, 1.f, 0.f });
+		mesh.Scale({ .7f, .7f, .7f });
+		mesh.Translate({ 0.f, 1.f, 0.f });
 
-		pMesh->UpdateTransforms();
+		mesh.UpdateAABB();
+		mesh.UpdateTransforms();
+
+		//parsed every time (no cache), so the nodes are only split the first time a ray reaches them
+		mesh.lazyBVH = true;
+		if (mesh.useBVH) mesh.BuildBVH();
 
 		//Lights
 		AddPointLight(Vector3{ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //backLight
@@ -372,8 +527,21 @@ namespace dae {
 	{
 		Scene::Update(pTimer);
 
-		pMesh->RotateY(PI_DIV_2 * pTimer->GetTotal());
-		pMesh->UpdateTransforms();
+		TriangleMesh& mesh{ m_TriangleMeshGeometries[m_Mesh] };
+		mesh.RotateY(PI_DIV_2 * pTimer->GetTotal());
+		mesh.UpdateTransforms();
+
+		if (mesh.useBVH)
+		{
+			mesh.RefitBVH();
+			m_AABBTriangleMeshes.Grow(mesh.bvhNodes[mesh.rootNodeIndex].AABBMin);
+			m_AABBTriangleMeshes.Grow(mesh.bvhNodes[mesh.rootNodeIndex].AABBMax);
+		}
+		else
+		{
+			m_AABBTriangleMeshes.Grow(mesh.transformedMinAABB);
+			m_AABBTriangleMeshes.Grow(mesh.transformedMaxAABB);
+		}
 	}
 #pragma endregion
 
@@ -384,60 +552,59 @@ namespace dae {
 		m_Camera.origin = { 0, 3, -9 };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matCT_GrayRoughMetal{ AddMaterialCookTorrence(new Material_CookTorrence({.972f, .960f, .915f}, 1.f, 1.f)) };
-		const auto matCT_GrayMediumMetal{ AddMaterialCookTorrence(new Material_CookTorrence({.972f, .960f, .915f}, 1.f, .6f)) };
-		const auto matCT_GraySmoothMetal{ AddMaterialCookTorrence(new Material_CookTorrence({.972f, .960f, .915f}, 1.f, .1f)) };
-		const auto matCT_GrayRoughPlastic{ AddMaterialCookTorrence(new Material_CookTorrence({.75f, .75f, .75f}, .0f, 1.f)) };
-		const auto matCT_GrayMediumPlastic{ AddMaterialCookTorrence(new Material_CookTorrence({.75f, .75f, .75f}, .0f, .6f)) };
-		const auto matCT_GraySmoothPlastic{ AddMaterialCookTorrence(new Material_CookTorrence({.75f, .75f, .75f}, .0f, .1f)) };
+		const auto matCT_GrayRoughMetal{ AddMaterial(Material_CookTorrence({.972f, .960f, .915f}, 1.f, 1.f)) };
+		const auto matCT_GrayMediumMetal{ AddMaterial(Material_CookTorrence({.972f, .960f, .915f}, 1.f, .6f)) };
+		const auto matCT_GraySmoothMetal{ AddMaterial(Material_CookTorrence({.972f, .960f, .915f}, 1.f, .1f)) };
+		const auto matCT_GrayRoughPlastic{ AddMaterial(Material_CookTorrence({.75f, .75f, .75f}, .0f, 1.f)) };
+		const auto matCT_GrayMediumPlastic{ AddMaterial(Material_CookTorrence({.75f, .75f, .75f}, .0f, .6f)) };
+		const auto matCT_GraySmoothPlastic{ AddMaterial(Material_CookTorrence({.75f, .75f, .75f}, .0f, .1f)) };
 
-		const auto matLambert_GrayBlue{ AddMaterialLambert(new Material_Lambert({.49f, .57f, .57f}, 1.f)) };
-		const auto matLambert_White{ AddMaterialLambert(new Material_Lambert(colors::White, 1.f)) };
+		const auto matLambert_GrayBlue{ AddMaterial(Material_Lambert({.49f, .57f, .57f}, 1.f)) };
+		const auto matLambert_White{ AddMaterial(Material_Lambert(colors::White, 1.f)) };
 
 		//Planes
-		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, MaterialType::lambert, matLambert_GrayBlue); //back
-		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //bottom
-		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //top
-		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //right
-		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //left
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //back
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //bottom
+		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, matLambert_GrayBlue); //top
+		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //right
+		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //left
 
 		//Spheres
-		AddSphere(Vector3{ -1.75, 1.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GrayRoughMetal);
-		AddSphere(Vector3{ 0.f, 1.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GrayMediumMetal);
-		AddSphere(Vector3{ 1.75, 1.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GraySmoothMetal);
-		AddSphere(Vector3{ -1.75, 3.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GrayRoughPlastic);
-		AddSphere(Vector3{ 0.f, 3.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GrayMediumPlastic);
-		AddSphere(Vector3{ 1.75, 3.f, 0.f }, .75f, MaterialType::cookTorrence, matCT_GraySmoothPlastic);
+		AddSphere(Vector3{ -1.75, 1.f, 0.f }, .75f, matCT_GrayRoughMetal);
+		AddSphere(Vector3{ 0.f, 1.f, 0.f }, .75f, matCT_GrayMediumMetal);
+		AddSphere(Vector3{ 1.75, 1.f, 0.f }, .75f, matCT_GraySmoothMetal);
+		AddSphere(Vector3{ -1.75, 3.f, 0.f }, .75f, matCT_GrayRoughPlastic);
+		AddSphere(Vector3{ 0.f, 3.f, 0.f }, .75f, matCT_GrayMediumPlastic);
+		AddSphere(Vector3{ 1.75, 3.f, 0.f }, .75f, matCT_GraySmoothPlastic);
 
 		//TriangleMesh
 		const Triangle baseTriangle{ Vector3{-0.75f, 1.5f, 0.f}, Vector3{.75f, 0.f, 0.f}, Vector3{-.75f, 0.f, 0.f} };
 
-		m_Meshes[0] = AddTriangleMesh(TriangleCullMode::BackFaceCulling, MaterialType::lambert, matLambert_White);
-		m_Meshes[0]->AppendTriangle(baseTriangle, true);
-		m_Meshes[0]->Translate({ -1.75f, 4.5f, 0.f });
-		m_Meshes[0]->UpdateAABB();
-		m_Meshes[0]->UpdateTransforms();
+		m_Meshes[0] = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
+		m_Meshes[1] = AddTriangleMesh(TriangleCullMode::FrontFaceCulling, matLambert_White);
+		m_Meshes[2] = AddTriangleMesh(TriangleCullMode::NoCulling, matLambert_White);
+
+		TriangleMesh& mesh0{ m_TriangleMeshGeometries[m_Meshes[0]] };
+		TriangleMesh& mesh1{ m_TriangleMeshGeometries[m_Meshes[1]] };
+		TriangleMesh& mesh2{ m_TriangleMeshGeometries[m_Meshes[2]] };
+
+		mesh0.Translate({ -1.75f, 4.5f, 0.f });
+		mesh0.AppendTriangles({ baseTriangle });
 
-		m_Meshes[1] = AddTriangleMesh(TriangleCullMode::FrontFaceCulling, MaterialType::lambert, matLambert_White);
-		m_Meshes[1]->AppendTriangle(baseTriangle, true);
-		m_Meshes[1]->Translate({ 0.f, 4.5f, 0.f });
-		m_Meshes[1]->UpdateAABB();
-		m_Meshes[1]->UpdateTransforms();
+		mesh1.Translate({ 0.f, 4.5f, 0.f });
+		mesh1.AppendTriangles({ baseTriangle });
 
-		m_Meshes[2] = AddTriangleMesh(TriangleCullMode::NoCulling, MaterialType::lambert, matLambert_White);
-		m_Meshes[2]->AppendTriangle(baseTriangle, true);
-		m_Meshes[2]->Translate({ 1.75f, 4.5f, 0.f });
-		m_Meshes[2]->UpdateAABB();
-		m_Meshes[2]->UpdateTransforms();
+		mesh2.Translate({ 1.75f, 4.5f, 0.f });
+		mesh2.AppendTriangles({ baseTriangle });
 
 		//to turn on bvh comment the next three lines
-		m_Meshes[0]->useBVH = false;
-		m_Meshes[1]->useBVH = false;
-		m_Meshes[2]->useBVH = false;
+		mesh0.useBVH = false;
+		mesh1.useBVH = false;
+		mesh2.useBVH = false;
 
-		if (m_Meshes[0]->useBVH) m_Meshes[0]->BuildBVH();
-		if (m_Meshes[1]->useBVH) m_Meshes[1]->BuildBVH();
-		if (m_Meshes[2]->useBVH) m_Meshes[2]->BuildBVH();
+		if (mesh0.useBVH) mesh0.BuildBVH();
+		if (mesh1.useBVH) mesh1.BuildBVH();
+		if (mesh2.useBVH) mesh2.BuildBVH();
 
 		//Lights
 		AddPointLight(Vector3{ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //Back Light
@@ -450,21 +617,22 @@ namespace dae {
 		Scene::Update(pTimer);
 
 		const auto yawAngle = (cos(pTimer->GetTotal()) + 1.f) / 2.f * PI_2;
-		for (const auto m : m_Meshes)
+		for (const auto handle : m_Meshes)
 		{
-			m->RotateY(yawAngle);
-			m->UpdateTransforms();
+			TriangleMesh& m{ m_TriangleMeshGeometries[handle] };
+			m.RotateY(yawAngle);
+			m.UpdateTransforms();
 			
-			if (m->useBVH)
+			if (m.useBVH)
 			{
-				m->RefitBVH();
-				m_AABBTriangleMeshes.Grow(m->bvhNodes[m->rootNodeIndex].AABBMin);
-				m_AABBTriangleMeshes.Grow(m->bvhNodes[m->rootNodeIndex].AABBMax);
+				m.RefitBVH();
+				m_AABBTriangleMeshes.Grow(m.bvhNodes[m.rootNodeIndex].AABBMin);
+				m_AABBTriangleMeshes.Grow(m.bvhNodes[m.rootNodeIndex].AABBMax);
 			}
 			else
 			{
-				m_AABBTriangleMeshes.Grow(m->transformedMinAABB);
-				m_AABBTriangleMeshes.Grow(m->transformedMaxAABB);
+				m_AABBTriangleMeshes.Grow(m.transformedMinAABB);
+				m_AABBTriangleMeshes.Grow(m.transformedMaxAABB);
 			}
 		}
 	}
@@ -473,35 +641,30 @@ namespace dae {
 #pragma region SCENE W4 BUNNYSCENE
 	void Scene_W4_BunnyScene::Initialize()
 	{
+		sceneName = "Bunny Scene";
 		m_Camera.origin = { 0, 3, -9 };
 		m_Camera.fovAngle = 45.f;
 
 		//Material
-		const auto matLambert_GrayBlue = AddMaterialLambert(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const auto matLambert_White = AddMaterialLambert(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material_Lambert({ .49f, .57f, .57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material_Lambert(colors::White, 1.f));
 
 		//planes
-		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, MaterialType::lambert, matLambert_GrayBlue); //back
-		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //bottom
-		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //top
-		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //right
-		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, MaterialType::lambert, matLambert_GrayBlue); //left
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //back
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //bottom
+		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, matLambert_GrayBlue); //top
+		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //right
+		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //left
 
 		//Bunny Mesh
-		m_pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, MaterialType::lambert, matLambert_White);
-
-		Utils::ParseOBJ("Resources/lowpoly_bunny2.obj",
-			m_pMesh->positions,
-			m_pMesh->normals,
-			m_pMesh->indices);
-
-		m_pMesh->Scale({ 2.f, 2.f, 2.f });
+		m_Mesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
+		m_TriangleMeshGeometries[m_Mesh].Scale({ 2.f, 2.f, 2.f });
 
-		m_pMesh->UpdateAABB();
-		m_pMesh->UpdateTransforms();
+		//m_TriangleMeshGeometries[m_Mesh].useBVH = false; //to turn off bvh uncommnent this line
 
-		//m_pMesh->useBVH = false; //to turn off bvh uncommnent this line
-		if(m_pMesh->useBVH) m_pMesh->BuildBVH();
+		//loaded on a worker thread, its AABB is rendered until it is done
+		//the first run parses the obj, builds the bvh and writes Resources/lowpoly_bunny2.obj.meshcache, later runs map the cache
+		LoadTriangleMeshAsync(m_Mesh, "Resources/lowpoly_bunny2.obj");
 
 		//Lights
 		AddPointLight(Vector3{ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //Back Light
@@ -515,19 +678,126 @@ namespace dae {
 
 		const auto yawAngle = (cos(pTimer->GetTotal()) + 1.f) / 2.f * PI_2;
 		
-		m_pMesh->RotateY(yawAngle);
-		m_pMesh->UpdateTransforms();
+		TriangleMesh& mesh{ m_TriangleMeshGeometries[m_Mesh] };
+		mesh.RotateY(yawAngle);
+		mesh.UpdateTransforms();
 
-		if (m_pMesh->useBVH)
+		//nothing to bound until the async load placed the placeholder
+		if (mesh.GetAmountOfTriangles() == 0) return;
+
+		if (mesh.useBVH)
 		{
-			m_pMesh->RefitBVH();
-			m_AABBTriangleMeshes.Grow(m_pMesh->bvhNodes[m_pMesh->rootNodeIndex].AABBMin);
-			m_AABBTriangleMeshes.Grow(m_pMesh->bvhNodes[m_pMesh->rootNodeIndex].AABBMax);
+			mesh.RefitBVH();
+			m_AABBTriangleMeshes.Grow(mesh.bvhNodes[mesh.rootNodeIndex].AABBMin);
+			m_AABBTriangleMeshes.Grow(mesh.bvhNodes[mesh.rootNodeIndex].AABBMax);
 		}
 		else
 		{
-			m_AABBTriangleMeshes.Grow(m_pMesh->transformedMinAABB);
-			m_AABBTriangleMeshes.Grow(m_pMesh->transformedMaxAABB);
+			m_AABBTriangleMeshes.Grow(mesh.transformedMinAABB);
+			m_AABBTriangleMeshes.Grow(mesh.transformedMaxAABB);
+		}
+	}
+#pragma endregion
+
+#pragma region SCENE W4 STATICBUNNYSCENE
+	void Scene_W4_StaticBunnyScene::Initialize()
+	{
+		switch (m_MeshStorage)
+		{
+		case MeshStorage::InMemory:
+			sceneName = "Static Bunny Scene";
+			break;
+		case MeshStorage::Compressed:
+			sceneName = "Compressed Bunny Scene";
+			break;
+		case MeshStorage::Streamed:
+			sceneName = "Streamed Bunny Scene";
+			break;
+		}
+
+		m_Camera.origin = { 0, 3, -9 };
+		m_Camera.fovAngle = 45.f;
+
+		//Material
+		const auto matLambert_GrayBlue = AddMaterial(Material_Lambert({ .49f, .57f, .57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material_Lambert(colors::White, 1.f));
+
+		//planes
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //back
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //bottom
+		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, matLambert_GrayBlue); //top
+		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //right
+		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //left
+
+		//Bunny Mesh, loaded before the first frame (no placeholder) in both storages
+		TriangleMesh bunny{};
+		bunny.cullMode = TriangleCullMode::BackFaceCulling;
+		bunny.materialId = matLambert_White;
+		bunny.bvhLeafSize = Kernels::Get().triangleLeafSize;
+		bunny.Scale({ 2.f, 2.f, 2.f });
+		bunny.RotateY(PI_DIV_4);
+		bunny.compressOnLoad = m_MeshStorage == MeshStorage::Compressed;
+
+		if (Utils::LoadTriangleMeshCached("Resources/lowpoly_bunny2.obj", bunny))
+		{
+			if (m_MeshStorage != MeshStorage::Streamed)
+			{
+				m_AABBTriangleMeshes.Grow(bunny.transformedMinAABB);
+				m_AABBTriangleMeshes.Grow(bunny.transformedMaxAABB);
+				m_TriangleMeshGeometries.Add(std::move(bunny));
+			}
+			else
+			{
+				//rewritten on every run so it always matches the transforms above. Treelets of 64 triangles and a budget of a few
+				//of them, so a frame pages treelets in and evicts them
+				const std::string streamedFilename{ "Resources/lowpoly_bunny2.streamedmesh" };
+				if (Utils::WriteStreamedMesh(streamedFilename, bunny, 64))
+				{
+					AddStreamedMesh(streamedFilename, TriangleCullMode::BackFaceCulling, matLambert_White, 16 << 10);
+				}
+			}
+		}
+
+		//Lights
+		AddPointLight(Vector3{ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, .61f, .45f }); //Back Light
+		AddPointLight(Vector3{ -2.5f, 5.f, -5.f }, 70.f, ColorRGB{ 1.f, .8f, .45f }); //Front Left Light
+		AddPointLight(Vector3{ 2.5f, 2.5f, -5.f }, 50.f, ColorRGB{ .34f, .47f, .68f });
+	}
+#pragma endregion
+
+#pragma region SCENE MANY LIGHTS
+	void Scene_ManyLights::Initialize()
+	{
+		sceneName = "Many Lights Scene";
+		m_Camera.origin = { 0, 3, -9 };
+		m_Camera.fovAngle = 45.f;
+
+		const auto matLambert_GrayBlue{ AddMaterial(Material_Lambert({.49f, .57f, .57f}, 1.f)) };
+		const auto matLambert_White{ AddMaterial(Material_Lambert(colors::White, 1.f)) };
+
+		//Planes
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //back
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //bottom
+
+		//Spheres
+		for (int row{}; row < 3; ++row)
+		{
+			for (int column{}; column < 5; ++column)
+			{
+				AddSphere(Vector3{ -4.f + 2.f * column, .5f, 1.f + 2.5f * row }, .5f, matLambert_White);
+			}
+		}
+
+		//Lights, a 16x16 grid of small colored point lights just above the floor
+		const ColorRGB lightColors[]{ colors::Red, colors::Green, colors::Blue, colors::Yellow, colors::Cyan, colors::Magenta };
+		constexpr int amountOfLightsPerSide{ 16 };
+		for (int row{}; row < amountOfLightsPerSide; ++row)
+		{
+			for (int column{}; column < amountOfLightsPerSide; ++column)
+			{
+				const Vector3 origin{ -6.f + 12.f * column / (amountOfLightsPerSide - 1), .3f + .4f * ((row + column) % 3), -2.f + 12.f * row / (amountOfLightsPerSide - 1) };
+				AddPointLight(origin, 1.5f, lightColors[(row * amountOfLightsPerSide + column) % 6], 2.f);
+			}
 		}
 	}
 #pragma endregion
@@ -1,21 +1,21 @@
 #pragma once
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "Math.h"
 #include "DataTypes.h"
+#include "Material.h"
 #include "Camera.h"
+#include "Pool.h"
+#include "StreamedMesh.h"
 
 namespace dae
 {
 	//Forward Declarations
 	class Timer;
-	class Material_SolidColor;
-	class Material_Lambert;
-	class Material_LambertPhong;
-	class Material_CookTorrence;
 	struct Plane;
-	struct Sphere;
 	struct Light;
 
 	//Scene Base Class
@@ -33,47 +33,68 @@ namespace dae
 		virtual void Initialize() = 0;
 		virtual void Update(dae::Timer* pTimer)
 		{
+			UpdateAsyncMeshLoads();
 			m_Camera.Update(pTimer);
 		}
 
 		Camera& GetCamera() { return m_Camera; }
+		const std::string& GetName() const { return sceneName; }
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
 		bool DoesHit(const Ray& ray) const;
+		bool IsLoading() const { return !m_AsyncMeshLoads.empty(); }
+		bool HasStreamedMeshes() const { return !m_StreamedMeshes.empty(); }
+		//summed over all streamed meshes of the scene
+		StreamingStatistics GetStreamingStatistics() const;
 
-		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
-		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
-		const std::vector<Light>& GetLights() const { return m_Lights; }
-		const std::vector<Material_SolidColor*> GetSolidColorMaterials() const { return m_SolidColorMaterials; }
-		const std::vector<Material_Lambert*> GetLambertMaterials() const { return m_LambertMaterials; }
-		const std::vector<Material_LambertPhong*> GetLambertPhongMaterials() const { return m_LambertPhongMaterials; }
-		const std::vector<Material_CookTorrence*> GetCookTorrenceMaterials() const { return m_CookTorrenceMaterials; }
+		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries.GetObjects(); }
+		const SphereGeometries& GetSphereGeometries() const { return m_SphereGeometries; }
+		const std::vector<Light>& GetLights() const { return m_Lights.GetObjects(); }
+		const std::vector<Material>& GetMaterials() const { return m_Materials; }
 
 	protected:
 		std::string	sceneName;
 
-		std::vector<Plane> m_PlaneGeometries{};
-		std::vector<Sphere> m_SphereGeometries{};
-		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
-		std::vector<Light> m_Lights{};
-		std::vector<Material_SolidColor*> m_SolidColorMaterials{};
-		std::vector<Material_Lambert*> m_LambertMaterials{};
-		std::vector<Material_LambertPhong*> m_LambertPhongMaterials{};
-		std::vector<Material_CookTorrence*> m_CookTorrenceMaterials{};
+		//objects are referred to by their handle (see Pool), the pools move them when they grow
+		Pool<Plane> m_PlaneGeometries{};
+		SphereGeometries m_SphereGeometries{};
+		Pool<TriangleMesh> m_TriangleMeshGeometries{};
+		std::vector<std::unique_ptr<StreamedMesh>> m_StreamedMeshes{}; //by pointer, the cache of a streamed mesh can't move
+		Pool<Light> m_Lights{};
+		std::vector<Material> m_Materials{}; //all materials of the scene by value, indexed by materialId
 
 		AABB m_AABBTriangleMeshes{}; //an AABB around all the triangleMeshes
 
 		Camera m_Camera{};
 
-		Sphere* AddSphere(const Vector3& origin, float radius, MaterialType materialType, unsigned char materialIndex = 0);
-		Plane* AddPlane(const Vector3& origin, const Vector3& normal, MaterialType materialType, unsigned char materialIndex = 0);
-		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, MaterialType materialType, unsigned char materialIndex = 0);
-
-		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
-		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
-		unsigned char AddMaterialSolidColor(Material_SolidColor* pMaterial);
-		unsigned char AddMaterialLambert(Material_Lambert* pMaterial);
-		unsigned char AddMaterialLambertPhong(Material_LambertPhong* pMaterial);
-		unsigned char AddMaterialCookTorrence(Material_CookTorrence* pMaterial);
+		//mesh that is parsed and built on a worker thread, its AABB is rendered as a placeholder until the mesh is swapped in by Update
+		struct AsyncMeshLoad
+		{
+			struct Result
+			{
+				TriangleMesh mesh{}; //without geometry when the load failed
+				std::string error{}; //empty when the mesh loaded
+			};
+
+			Handle<TriangleMesh> mesh{};
+			std::string objFilename{};
+			std::future<AABB> bounds{}; //an empty AABB when the load failed before the geometry was read
+			std::future<Result> loadedMesh{};
+			bool hasPlaceholder{ false };
+		};
+		std::vector<AsyncMeshLoad> m_AsyncMeshLoads{};
+
+		void LoadTriangleMeshAsync(Handle<TriangleMesh> meshHandle, const std::string& objFilename);
+		void UpdateAsyncMeshLoads();
+
+		void AddSphere(const Vector3& origin, float radius, uint16_t materialId = 0);
+		Handle<Plane> AddPlane(const Vector3& origin, const Vector3& normal, uint16_t materialId = 0);
+		Handle<TriangleMesh> AddTriangleMesh(TriangleCullMode cullMode, uint16_t materialId = 0);
+		//Opens a file written by Utils::WriteStreamedMesh, check IsOpen on the result (a mesh that failed to open is never hit)
+		StreamedMesh* AddStreamedMesh(const std::string& filename, TriangleCullMode cullMode, uint16_t materialId = 0, size_t memoryBudget = StreamedMesh::DEFAULT_MEMORY_BUDGET);
+
+		Handle<Light> AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color, float radius = FLT_MAX);
+		Handle<Light> AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
+		uint16_t AddMaterial(const Material& material);
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -149,7 +170,7 @@ namespace dae
 		void Update(Timer* pTimer) override;
 
 	private:
-		TriangleMesh* pMesh{nullptr};
+		Handle<TriangleMesh> m_Mesh{};
 	};
 
 	class Scene_W4_ReferenceScene final : public Scene
@@ -167,7 +188,7 @@ namespace dae
 		void Update(Timer* pTimer) override;
 
 	private:
-		TriangleMesh* m_Meshes[3]{};
+		Handle<TriangleMesh> m_Meshes[3]{};
 	};
 
 	class Scene_W4_BunnyScene final : public Scene
@@ -185,6 +206,48 @@ namespace dae
 		void Update(Timer* pTimer) override;
 
 	private:
-		TriangleMesh* m_pMesh{ nullptr };
+		Handle<TriangleMesh> m_Mesh{};
+	};
+
+	//The bunny scene with a bunny that doesn't turn, kept in memory (with float or compressed attributes) or streamed from a treelet
+	//file written from the loaded mesh. Streamed renders the same image as in memory (--streaming-test), compressed stays within
+	//its quantization error (--compression-test)
+	class Scene_W4_StaticBunnyScene final : public Scene
+	{
+	public:
+		enum class MeshStorage
+		{
+			InMemory,
+			Compressed, //TriangleMesh::compressOnLoad
+			Streamed
+		};
+
+		explicit Scene_W4_StaticBunnyScene(MeshStorage meshStorage = MeshStorage::InMemory) : m_MeshStorage{ meshStorage } {}
+		~Scene_W4_StaticBunnyScene() override = default;
+
+		Scene_W4_StaticBunnyScene(const Scene_W4_StaticBunnyScene&) = delete;
+		Scene_W4_StaticBunnyScene(Scene_W4_StaticBunnyScene&&) noexcept = delete;
+		Scene_W4_StaticBunnyScene& operator=(const Scene_W4_StaticBunnyScene&) = delete;
+		Scene_W4_StaticBunnyScene& operator=(Scene_W4_StaticBunnyScene&&) noexcept = delete;
+
+		void Initialize() override;
+
+	private:
+		MeshStorage m_MeshStorage;
+	};
+
+	//Hundreds of point lights with a limited radius, rendered through the renderer's light grid
+	class Scene_ManyLights final : public Scene
+	{
+	public:
+		Scene_ManyLights() = default;
+		~Scene_ManyLights() override = default;
+
+		Scene_ManyLights(const Scene_ManyLights&) = delete;
+		Scene_ManyLights(Scene_ManyLights&&) noexcept = delete;
+		Scene_ManyLights& operator=(const Scene_ManyLights&) = delete;
+		Scene_ManyLights& operator=(Scene_ManyLights&&) noexcept = delete;
+
+		void Initialize() override;
 	};
 }
\ No newline at end of file
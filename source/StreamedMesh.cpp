@@ -0,0 +1,429 @@
+#include "StreamedMesh.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+
+namespace dae
+{
+	namespace
+	{
+		constexpr char STREAMED_MESH_MAGIC[8]{ 'D', 'A', 'E', 'S', 'T', 'R', 'M', '\0' };
+		constexpr uint32_t STREAMED_MESH_VERSION{ 1 };
+		constexpr uint64_t STREAMED_MESH_ALIGNMENT{ 16 };
+		constexpr int AMOUNT_OF_TRIANGLE_ARRAYS{ 12 };
+
+		struct StreamedMeshHeader
+		{
+			char magic[8];
+			uint32_t version;
+
+			//layout checks, the nodes are stored exactly as they are in memory
+			uint32_t bvhNodeSize;
+			uint32_t treeletRecordSize;
+
+			int32_t amountOfTopNodes;
+			int32_t amountOfTreelets;
+			int32_t amountOfTriangles;
+
+			Vector3 minAABB;
+			Vector3 maxAABB;
+
+			uint64_t topNodesOffset;
+			uint64_t treeletRecordsOffset;
+		};
+
+		uint64_t AlignOffset(uint64_t offset)
+		{
+			return (offset + STREAMED_MESH_ALIGNMENT - 1) & ~(STREAMED_MESH_ALIGNMENT - 1);
+		}
+
+		//amount elements of elementSize bytes at offset fit in the file, without overflowing on damaged values
+		bool IsInFile(uint64_t offset, int64_t amount, uint64_t elementSize, uint64_t fileSize)
+		{
+			return amount >= 0 && offset <= fileSize && static_cast<uint64_t>(amount) <= (fileSize - offset) / elementSize;
+		}
+
+		//the arrays of PackedTriangles in the order they are stored
+		template<typename Triangles>
+		auto GetTriangleArrays(Triangles& triangles)
+		{
+			return std::array<decltype(&triangles.normalX), AMOUNT_OF_TRIANGLE_ARRAYS>
+			{
+				&triangles.vertexX[0], &triangles.vertexY[0], &triangles.vertexZ[0],
+				&triangles.vertexX[1], &triangles.vertexY[1], &triangles.vertexZ[1],
+				&triangles.vertexX[2], &triangles.vertexY[2], &triangles.vertexZ[2],
+				&triangles.normalX, &triangles.normalY, &triangles.normalZ
+			};
+		}
+
+		void WritePadding(std::ofstream& file, uint64_t offset)
+		{
+			static constexpr char padding[STREAMED_MESH_ALIGNMENT]{};
+			const uint64_t currentOffset{ static_cast<uint64_t>(file.tellp()) };
+			file.write(padding, static_cast<std::streamsize>(offset - currentOffset));
+		}
+
+		//Splits the bvh of the mesh, subtrees of at most trianglesPerTreelet triangles become treelets, the nodes above them the top
+		struct TreeletSplitter
+		{
+			const std::vector<BVHNode>& sourceNodes;
+			int trianglesPerTreelet;
+
+			std::vector<int> amountOfTriangles{}; //per source node
+			std::vector<int> firstTriangle{}; //per source node, the triangles of a subtree are contiguous
+
+			std::vector<BVHNode> topNodes{};
+			std::vector<int> treeletRoots{}; //source node of every treelet
+
+			void CountTriangles(int nodeIndex)
+			{
+				const BVHNode& node{ sourceNodes[nodeIndex] };
+				if (node.amountOfMeshes != 0)
+				{
+					amountOfTriangles[nodeIndex] = node.amountOfMeshes;
+					firstTriangle[nodeIndex] = node.leftChildIndex;
+					return;
+				}
+
+				CountTriangles(node.leftChildIndex);
+				CountTriangles(node.leftChildIndex + 1);
+				amountOfTriangles[nodeIndex] = amountOfTriangles[node.leftChildIndex] + amountOfTriangles[node.leftChildIndex + 1];
+				firstTriangle[nodeIndex] = std::min(firstTriangle[node.leftChildIndex], firstTriangle[node.leftChildIndex + 1]);
+			}
+
+			//depth first, left before right, so the treelets are ordered by their first triangle
+			void AddTopNode(int sourceIndex, int topIndex)
+			{
+				const BVHNode& source{ sourceNodes[sourceIndex] };
+				topNodes[topIndex] = source;
+
+				if (source.amountOfMeshes != 0 || amountOfTriangles[sourceIndex] <= trianglesPerTreelet)
+				{
+					topNodes[topIndex].leftChildIndex = static_cast<int>(treeletRoots.size());
+					topNodes[topIndex].amountOfMeshes = 1;
+					treeletRoots.push_back(sourceIndex);
+					return;
+				}
+
+				const int leftIndex{ static_cast<int>(topNodes.size()) };
+				topNodes.resize(topNodes.size() + 2);
+				topNodes[topIndex].leftChildIndex = leftIndex;
+				topNodes[topIndex].amountOfMeshes = 0;
+
+				AddTopNode(source.leftChildIndex, leftIndex);
+				AddTopNode(source.leftChildIndex + 1, leftIndex + 1);
+			}
+
+			//nodes of one treelet with local indices, triangles relative to the first one of the treelet
+			void AddTreeletNode(int sourceIndex, int localIndex, int treeletFirstTriangle, std::vector<BVHNode>& nodes) const
+			{
+				const BVHNode& source{ sourceNodes[sourceIndex] };
+				nodes[localIndex] = source;
+
+				if (source.amountOfMeshes != 0)
+				{
+					nodes[localIndex].leftChildIndex = source.leftChildIndex - treeletFirstTriangle;
+					return;
+				}
+
+				const int leftIndex{ static_cast<int>(nodes.size()) };
+				nodes.resize(nodes.size() + 2);
+				nodes[localIndex].leftChildIndex = leftIndex;
+
+				AddTreeletNode(source.leftChildIndex, leftIndex, treeletFirstTriangle, nodes);
+				AddTreeletNode(source.leftChildIndex + 1, leftIndex + 1, treeletFirstTriangle, nodes);
+			}
+		};
+	}
+
+	bool StreamedMesh::Open(const std::string& filename)
+	{
+		std::lock_guard lock{ m_CacheMutex };
+
+		m_TopNodes.clear();
+		m_TreeletRecords.clear();
+		m_Cache.clear();
+		m_UseClock = 0;
+		m_Bounds = AABB{};
+
+		m_Statistics = StreamingStatistics{};
+
+		if (!m_File.Open(filename) || m_File.GetSize() < sizeof(StreamedMeshHeader)) return false;
+
+		StreamedMeshHeader header{};
+		std::memcpy(&header, m_File.GetData(), sizeof(StreamedMeshHeader));
+
+		const bool isValid
+		{
+			std::memcmp(header.magic, STREAMED_MESH_MAGIC, sizeof(STREAMED_MESH_MAGIC)) == 0
+			&& header.version == STREAMED_MESH_VERSION
+			&& header.bvhNodeSize == sizeof(BVHNode) && header.treeletRecordSize == sizeof(TreeletRecord)
+			&& header.amountOfTopNodes > 0 && header.amountOfTreelets > 0 && header.amountOfTriangles > 0
+			&& IsInFile(header.topNodesOffset, header.amountOfTopNodes, sizeof(BVHNode), m_File.GetSize())
+			&& IsInFile(header.treeletRecordsOffset, header.amountOfTreelets, sizeof(TreeletRecord), m_File.GetSize())
+		};
+
+		if (!isValid)
+		{
+			m_File.Close();
+			return false;
+		}
+
+		m_TopNodes.resize(header.amountOfTopNodes);
+		std::memcpy(m_TopNodes.data(), m_File.GetData() + header.topNodesOffset, m_TopNodes.size() * sizeof(BVHNode));
+
+		m_TreeletRecords.resize(header.amountOfTreelets);
+		std::memcpy(m_TreeletRecords.data(), m_File.GetData() + header.treeletRecordsOffset, m_TreeletRecords.size() * sizeof(TreeletRecord));
+
+		//a damaged file is rejected here instead of reading out of bounds during traversal, the nodes of a treelet are checked
+		//when it is paged in (see PageIn)
+		bool areRecordsValid{ AreBVHNodesValid(m_TopNodes, header.amountOfTreelets) };
+		for (const TreeletRecord& record : m_TreeletRecords)
+		{
+			areRecordsValid = areRecordsValid
+				&& record.amountOfNodes > 0 && record.amountOfTriangles > 0 && record.firstTriangle >= 0
+				&& record.amountOfTriangles <= header.amountOfTriangles - record.firstTriangle;
+		}
+
+		if (!areRecordsValid)
+		{
+			m_TopNodes.clear();
+			m_TreeletRecords.clear();
+			m_File.Close();
+			return false;
+		}
+
+		m_Cache = std::vector<CacheEntry>(m_TreeletRecords.size());
+		m_Bounds.Grow(header.minAABB);
+		m_Bounds.Grow(header.maxAABB);
+		m_Statistics.amountOfTreelets = header.amountOfTreelets;
+
+		return true;
+	}
+
+	void StreamedMesh::SetMemoryBudget(size_t bytes)
+	{
+		std::lock_guard lock{ m_CacheMutex };
+		m_MemoryBudget = bytes;
+		EvictOverBudget(-1);
+	}
+
+	StreamingStatistics StreamedMesh::GetStatistics() const
+	{
+		std::lock_guard lock{ m_CacheMutex };
+
+		StreamingStatistics statistics{ m_Statistics };
+		statistics.memoryBudget = m_MemoryBudget;
+		for (const CacheEntry& entry : m_Cache)
+		{
+			statistics.cacheHits += entry.hits.load(std::memory_order_relaxed);
+		}
+		return statistics;
+	}
+
+	std::shared_ptr<const StreamedMesh::Treelet> StreamedMesh::AcquireTreelet(int treeletIndex) const
+	{
+		CacheEntry& entry{ m_Cache[treeletIndex] };
+
+		//resident, no lock
+		if (std::shared_ptr<const Treelet> pTreelet{ entry.pTreelet.load(std::memory_order_acquire) })
+		{
+			//only written when it changes, most visits between two misses just read the stamp
+			const uint64_t useClock{ m_UseClock.load(std::memory_order_relaxed) };
+			if (entry.lastUse.load(std::memory_order_relaxed) != useClock) entry.lastUse.store(useClock, std::memory_order_relaxed);
+
+			entry.hits.fetch_add(1, std::memory_order_relaxed);
+			return pTreelet;
+		}
+
+		{
+			std::lock_guard lock{ m_CacheMutex };
+
+			//paged in by another thread since the load above
+			if (std::shared_ptr<const Treelet> pTreelet{ entry.pTreelet.load(std::memory_order_acquire) })
+			{
+				entry.hits.fetch_add(1, std::memory_order_relaxed);
+				return pTreelet;
+			}
+
+			++m_Statistics.cacheMisses;
+		}
+
+		//copied without holding the lock, reading the pages from disk is the slow part
+		std::shared_ptr<const Treelet> pTreelet{ PageIn(treeletIndex) };
+		if (!pTreelet) return nullptr;
+
+		std::lock_guard lock{ m_CacheMutex };
+		m_Statistics.pagedInBytes += pTreelet->size;
+
+		//another thread paged it in at the same time, keep theirs
+		if (std::shared_ptr<const Treelet> pResident{ entry.pTreelet.load(std::memory_order_acquire) }) return pResident;
+
+		entry.lastUse.store(m_UseClock.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		entry.pTreelet.store(pTreelet, std::memory_order_release);
+		m_Statistics.residentBytes += pTreelet->size;
+		++m_Statistics.residentTreelets;
+
+		EvictOverBudget(treeletIndex);
+		return pTreelet;
+	}
+
+	std::shared_ptr<StreamedMesh::Treelet> StreamedMesh::PageIn(int treeletIndex) const
+	{
+		const TreeletRecord& record{ m_TreeletRecords[treeletIndex] };
+
+		const uint64_t nodesSize{ static_cast<uint64_t>(record.amountOfNodes) * sizeof(BVHNode) };
+		const uint64_t arraySize{ static_cast<uint64_t>(record.amountOfTriangles) * sizeof(float) };
+		if (!IsInFile(record.nodesOffset, record.amountOfNodes, sizeof(BVHNode), m_File.GetSize())) return nullptr;
+		if (!IsInFile(record.trianglesOffset, static_cast<int64_t>(record.amountOfTriangles) * AMOUNT_OF_TRIANGLE_ARRAYS, sizeof(float), m_File.GetSize())) return nullptr;
+
+		std::shared_ptr<Treelet> pTreelet{ std::make_shared<Treelet>() };
+		pTreelet->firstTriangle = record.firstTriangle;
+
+		pTreelet->nodes.resize(record.amountOfNodes);
+		std::memcpy(pTreelet->nodes.data(), m_File.GetData() + record.nodesOffset, static_cast<size_t>(nodesSize));
+		if (!AreBVHNodesValid(pTreelet->nodes, record.amountOfTriangles)) return nullptr;
+
+		//the kernels load whole registers past the last triangle, Resize adds the padding
+		pTreelet->triangles.Resize(record.amountOfTriangles);
+		const char* pSource{ m_File.GetData() + record.trianglesOffset };
+		for (std::vector<float>* pArray : GetTriangleArrays(pTreelet->triangles))
+		{
+			std::memcpy(pArray->data(), pSource, static_cast<size_t>(arraySize));
+			pSource += arraySize;
+		}
+
+		pTreelet->size = static_cast<size_t>(nodesSize) + AMOUNT_OF_TRIANGLE_ARRAYS * (static_cast<size_t>(record.amountOfTriangles) + TRIANGLE_PADDING) * sizeof(float);
+		return pTreelet;
+	}
+
+	//least recently used first, the treelet used last stays even when it is over the budget on its own
+	void StreamedMesh::EvictOverBudget(int keepIndex) const
+	{
+		const int amountOfTreelets{ static_cast<int>(m_Cache.size()) };
+		while (m_Statistics.residentBytes > m_MemoryBudget)
+		{
+			//a scan instead of a list, evicting only follows a read from disk which costs far more
+			int evictIndex{ -1 };
+			uint64_t oldestUse{ UINT64_MAX };
+			for (int treeletIndex{}; treeletIndex < amountOfTreelets; ++treeletIndex)
+			{
+				const CacheEntry& entry{ m_Cache[treeletIndex] };
+				const uint64_t lastUse{ entry.lastUse.load(std::memory_order_relaxed) };
+				if (treeletIndex == keepIndex || lastUse >= oldestUse || !entry.pTreelet.load(std::memory_order_relaxed)) continue;
+
+				evictIndex = treeletIndex;
+				oldestUse = lastUse;
+			}
+
+			if (evictIndex < 0) return;
+
+			//rays still in it keep their own reference, the memory is freed when the last one leaves
+			CacheEntry& entry{ m_Cache[evictIndex] };
+			m_Statistics.residentBytes -= entry.pTreelet.load(std::memory_order_relaxed)->size;
+			entry.pTreelet.store(nullptr, std::memory_order_release);
+			--m_Statistics.residentTreelets;
+			++m_Statistics.evictions;
+		}
+	}
+
+	Kernels::TriangleList StreamedMesh::GetTriangles(const Treelet& treelet) const
+	{
+		const PackedTriangles& packed{ treelet.triangles };
+
+		//only the packed arrays, no positions and indices
+		Kernels::TriangleList triangles{};
+		for (int vertex{}; vertex < 3; ++vertex)
+		{
+			triangles.pVertexX[vertex] = packed.vertexX[vertex].data();
+			triangles.pVertexY[vertex] = packed.vertexY[vertex].data();
+			triangles.pVertexZ[vertex] = packed.vertexZ[vertex].data();
+		}
+		triangles.pNormalX = packed.normalX.data();
+		triangles.pNormalY = packed.normalY.data();
+		triangles.pNormalZ = packed.normalZ.data();
+		triangles.cullMode = cullMode;
+
+		return triangles;
+	}
+
+	namespace Utils
+	{
+		bool WriteStreamedMesh(const std::string& filename, const TriangleMesh& mesh, int trianglesPerTreelet)
+		{
+			//the treelets are cut out of the complete tree and the packed world space triangles
+			if (!mesh.useBVH || mesh.lazyBVH || mesh.compressed || mesh.bvhNodes.empty() || mesh.GetAmountOfTriangles() == 0) return false;
+
+			TreeletSplitter splitter{ mesh.bvhNodes, std::max(trianglesPerTreelet, 1) };
+			splitter.amountOfTriangles.resize(mesh.bvhNodes.size());
+			splitter.firstTriangle.resize(mesh.bvhNodes.size());
+			splitter.CountTriangles(mesh.rootNodeIndex);
+
+			splitter.topNodes.resize(1);
+			splitter.AddTopNode(mesh.rootNodeIndex, 0);
+
+			StreamedMeshHeader header{};
+			std::memcpy(header.magic, STREAMED_MESH_MAGIC, sizeof(STREAMED_MESH_MAGIC));
+			header.version = STREAMED_MESH_VERSION;
+			header.bvhNodeSize = sizeof(BVHNode);
+			header.treeletRecordSize = sizeof(StreamedMesh::TreeletRecord);
+			header.amountOfTopNodes = static_cast<int32_t>(splitter.topNodes.size());
+			header.amountOfTreelets = static_cast<int32_t>(splitter.treeletRoots.size());
+			header.amountOfTriangles = mesh.GetAmountOfTriangles();
+			header.minAABB = mesh.bvhNodes[mesh.rootNodeIndex].AABBMin;
+			header.maxAABB = mesh.bvhNodes[mesh.rootNodeIndex].AABBMax;
+
+			header.topNodesOffset = AlignOffset(sizeof(StreamedMeshHeader));
+			header.treeletRecordsOffset = AlignOffset(header.topNodesOffset + splitter.topNodes.size() * sizeof(BVHNode));
+
+			//records first, the treelets follow in the same order
+			std::vector<StreamedMesh::TreeletRecord> records(splitter.treeletRoots.size());
+			std::vector<std::vector<BVHNode>> treeletNodes(splitter.treeletRoots.size());
+			uint64_t offset{ header.treeletRecordsOffset + records.size() * sizeof(StreamedMesh::TreeletRecord) };
+
+			for (size_t treeletIndex{}; treeletIndex < records.size(); ++treeletIndex)
+			{
+				const int rootIndex{ splitter.treeletRoots[treeletIndex] };
+				StreamedMesh::TreeletRecord& record{ records[treeletIndex] };
+				record.firstTriangle = splitter.firstTriangle[rootIndex];
+				record.amountOfTriangles = splitter.amountOfTriangles[rootIndex];
+
+				std::vector<BVHNode>& nodes{ treeletNodes[treeletIndex] };
+				nodes.resize(1);
+				splitter.AddTreeletNode(rootIndex, 0, record.firstTriangle, nodes);
+				record.amountOfNodes = static_cast<int32_t>(nodes.size());
+
+				record.nodesOffset = AlignOffset(offset);
+				record.trianglesOffset = AlignOffset(record.nodesOffset + nodes.size() * sizeof(BVHNode));
+				offset = record.trianglesOffset + AMOUNT_OF_TRIANGLE_ARRAYS * static_cast<uint64_t>(record.amountOfTriangles) * sizeof(float);
+			}
+
+			std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+			if (!file) return false;
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(StreamedMeshHeader));
+			WritePadding(file, header.topNodesOffset);
+			file.write(reinterpret_cast<const char*>(splitter.topNodes.data()), static_cast<std::streamsize>(splitter.topNodes.size() * sizeof(BVHNode)));
+			WritePadding(file, header.treeletRecordsOffset);
+			file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(StreamedMesh::TreeletRecord)));
+
+			for (size_t treeletIndex{}; treeletIndex < records.size(); ++treeletIndex)
+			{
+				const StreamedMesh::TreeletRecord& record{ records[treeletIndex] };
+
+				WritePadding(file, record.nodesOffset);
+				file.write(reinterpret_cast<const char*>(treeletNodes[treeletIndex].data()), static_cast<std::streamsize>(record.amountOfNodes * sizeof(BVHNode)));
+
+				WritePadding(file, record.trianglesOffset);
+				for (const std::vector<float>* pArray : GetTriangleArrays(mesh.packedTriangles))
+				{
+					file.write(reinterpret_cast<const char*>(pArray->data() + record.firstTriangle), static_cast<std::streamsize>(record.amountOfTriangles * sizeof(float)));
+				}
+			}
+
+			return file.good();
+		}
+	}
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DataTypes.h"
+#include "Kernels.h"
+#include "MappedFile.h"
+
+namespace dae
+{
+	//Cache counters of a streamed mesh, summed over all render threads since it was opened (see StreamedMesh::GetStatistics)
+	struct StreamingStatistics
+	{
+		uint64_t cacheHits{}; //treelets that were resident when a ray reached them
+		uint64_t cacheMisses{}; //treelets that had to be paged in
+		uint64_t evictions{};
+		uint64_t pagedInBytes{};
+		size_t residentBytes{};
+		size_t memoryBudget{};
+		int residentTreelets{};
+		int amountOfTreelets{};
+
+		StreamingStatistics& operator+=(const StreamingStatistics& other)
+		{
+			cacheHits += other.cacheHits;
+			cacheMisses += other.cacheMisses;
+			evictions += other.evictions;
+			pagedInBytes += other.pagedInBytes;
+			residentBytes += other.residentBytes;
+			memoryBudget += other.memoryBudget;
+			residentTreelets += other.residentTreelets;
+			amountOfTreelets += other.amountOfTreelets;
+			return *this;
+		}
+	};
+
+	//Triangle mesh that stays on disk, for meshes that don't fit in memory (written once with Utils::WriteStreamedMesh)
+	//Only the top of the bvh is loaded, every subtree below it (a treelet, its nodes and packed triangles) is copied out of the
+	//memory mapped file when a ray first reaches it and evicted least recently used first when the resident treelets go over the budget
+	//The triangles are stored in world space, the mesh can't be transformed
+	//Reaching a resident treelet takes no lock (an atomic load of its pointer and a use stamp), only paging in and evicting lock the cache
+	class StreamedMesh final
+	{
+	public:
+		struct Treelet
+		{
+			std::vector<BVHNode> nodes{}; //root at 0, leaves hold [leftChildIndex, leftChildIndex + amountOfMeshes) of the triangles below
+			PackedTriangles triangles{};
+			int firstTriangle{}; //index of triangle 0 in the whole mesh
+			size_t size{}; //bytes counted against the budget
+		};
+
+		StreamedMesh() = default;
+		~StreamedMesh() = default;
+
+		StreamedMesh(const StreamedMesh&) = delete;
+		StreamedMesh(StreamedMesh&&) noexcept = delete;
+		StreamedMesh& operator=(const StreamedMesh&) = delete;
+		StreamedMesh& operator=(StreamedMesh&&) noexcept = delete;
+
+		//Maps the file and loads the top of the bvh, a mesh that failed to open has no triangles (and never gets hit)
+		bool Open(const std::string& filename);
+		bool IsOpen() const { return m_File.IsOpen(); }
+
+		//Evicts right away when the resident treelets are over the new budget. The treelet a ray is in is never evicted under it,
+		//a budget smaller than one treelet still renders (paging in on every access)
+		void SetMemoryBudget(size_t bytes);
+		StreamingStatistics GetStatistics() const;
+
+		//Resident treelet, paged in when it isn't, nullptr when the file is damaged. The pointer keeps it alive after an eviction,
+		//acquire it once per visit and use it for everything the visit needs (see GeometryUtils::HitTest_StreamedMesh)
+		std::shared_ptr<const Treelet> AcquireTreelet(int treeletIndex) const;
+		Kernels::TriangleList GetTriangles(const Treelet& treelet) const;
+
+		//top of the bvh, a leaf (amountOfMeshes != 0) holds the index of its treelet in leftChildIndex
+		const std::vector<BVHNode>& GetTopNodes() const { return m_TopNodes; }
+		const AABB& GetBounds() const { return m_Bounds; }
+
+		uint16_t materialId{};
+		TriangleCullMode cullMode{ TriangleCullMode::BackFaceCulling };
+
+		static constexpr size_t DEFAULT_MEMORY_BUDGET{ 256ull << 20 };
+
+		//where a treelet is in the file
+		struct TreeletRecord
+		{
+			uint64_t nodesOffset;
+			uint64_t trianglesOffset; //12 arrays of amountOfTriangles floats, in the order of PackedTriangles
+			int32_t amountOfNodes;
+			int32_t amountOfTriangles;
+			int32_t firstTriangle;
+			int32_t padding;
+		};
+
+	private:
+		struct CacheEntry
+		{
+			std::atomic<std::shared_ptr<const Treelet>> pTreelet{}; //empty when it isn't resident
+			std::atomic<uint64_t> lastUse{}; //m_UseClock when a ray last reached it, the smallest one is evicted first
+			std::atomic<uint64_t> hits{}; //per entry, so rays in different treelets don't write the same counter
+		};
+
+		MappedFile m_File{};
+		std::vector<BVHNode> m_TopNodes{};
+		std::vector<TreeletRecord> m_TreeletRecords{}; //ordered by firstTriangle
+		AABB m_Bounds{};
+
+		//taken on a miss and to evict, not when a resident treelet is reached (reading from disk happens outside of it too)
+		mutable std::mutex m_CacheMutex{};
+		mutable std::vector<CacheEntry> m_Cache{}; //per treelet
+		//advances on every miss, so the stamps order the treelets by use between misses (an approximate lru without a shared list)
+		mutable std::atomic<uint64_t> m_UseClock{};
+		mutable StreamingStatistics m_Statistics{}; //everything but cacheHits, under the lock
+		size_t m_MemoryBudget{ DEFAULT_MEMORY_BUDGET };
+
+		std::shared_ptr<Treelet> PageIn(int treeletIndex) const;
+		//keepIndex (the treelet that was just used) is never evicted
+		void EvictOverBudget(int keepIndex) const;
+	};
+
+	namespace Utils
+	{
+		//Splits the bvh of mesh into treelets of at most trianglesPerTreelet triangles and writes them with their transformed, packed
+		//triangles. The mesh has to be loaded (and its complete bvh built) once to write the file, uncompressed
+		bool WriteStreamedMesh(const std::string& filename, const TriangleMesh& mesh, int trianglesPerTreelet = 4096);
+	}
+}
@@ -1,8 +1,11 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
-#include <fstream>
 #include "Math.h"
 #include "DataTypes.h"
+#include "ObjParser.h"
+#include "Kernels.h"
+#include "StreamedMesh.h"
 
 namespace dae
 {
@@ -10,12 +13,13 @@ namespace dae
 	{
 #pragma region Sphere HitTest
 		//SPHERE HIT-TESTS
-		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		//closest-hit: only accepts hits closer than hitRecord.t and only stores t, see GetHitAttributes
+		inline bool HitTest_Sphere(const Vector3& center, float squaredRadius, const Ray& ray, HitRecord& hitRecord)
 		{
-			const Vector3 sphereToRayOriginVector{ ray.origin - sphere.origin };
+			const Vector3 sphereToRayOriginVector{ ray.origin - center };
 			const float A{ Vector3::Dot(ray.direction, ray.direction) };
 			const float B{ 2 * Vector3::Dot(ray.direction, sphereToRayOriginVector) };
-			const float C{ Vector3::Dot(sphereToRayOriginVector, sphereToRayOriginVector) - sphere.radius * sphere.radius };
+			const float C{ Vector3::Dot(sphereToRayOriginVector, sphereToRayOriginVector) - squaredRadius };
 
 			const float discriminant{ B * B - 4 * A * C };
 
@@ -27,15 +31,7 @@ namespace dae
 
 				if (t0 > ray.min && t0 < ray.max && t0 < hitRecord.t)
 				{
-					if (ignoreHitRecord) return true;
-
-					hitRecord.didHit = true;
-					hitRecord.materialIndex = sphere.materialIndex;
-					hitRecord.origin = ray.origin + t0 * ray.direction;
-					hitRecord.normal = (hitRecord.origin - sphere.origin).Normalized();
 					hitRecord.t = t0;
-					hitRecord.materialType = sphere.materialType;
-
 					return true;
 				}
 
@@ -43,15 +39,7 @@ namespace dae
 
 				if (t1 > ray.min && t1 < ray.max && t1 < hitRecord.t)
 				{
-					if (ignoreHitRecord) return true;
-
-					hitRecord.didHit = true;
-					hitRecord.materialIndex = sphere.materialIndex;
-					hitRecord.origin = ray.origin + t1 * ray.direction;
-					hitRecord.normal = (hitRecord.origin - sphere.origin).Normalized();
 					hitRecord.t = t1;
-					hitRecord.materialType = sphere.materialType;
-
 					return true;
 				}
 			}
@@ -59,261 +47,409 @@ namespace dae
 			return false;
 		}
 
-		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray)
+		inline void GetHitAttributes(const SphereGeometries& spheres, int index, const Ray& ray, HitRecord& hitRecord)
+		{
+			hitRecord.didHit = true;
+			hitRecord.materialId = spheres.materialId[index];
+			hitRecord.origin = ray.origin + hitRecord.t * ray.direction;
+			hitRecord.normal = (hitRecord.origin - spheres.GetCenter(index)).Normalized();
+		}
+
+		//any-hit: true as soon as one of both intersections lies within [ray.min, ray.max]
+		inline bool HitTest_Sphere(const Vector3& center, float squaredRadius, const Ray& ray)
+		{
+			const Vector3 sphereToRayOriginVector{ ray.origin - center };
+			const float A{ Vector3::Dot(ray.direction, ray.direction) };
+			const float B{ 2 * Vector3::Dot(ray.direction, sphereToRayOriginVector) };
+			const float C{ Vector3::Dot(sphereToRayOriginVector, sphereToRayOriginVector) - squaredRadius };
+
+			const float discriminant{ B * B - 4 * A * C };
+
+			if (discriminant > 0)
+			{
+				const float sqrtDiscriminant{ sqrtf(discriminant) };
+
+				const float t0{ (-B - sqrtDiscriminant) / (2.f * A) };
+				if (t0 > ray.min && t0 < ray.max) return true;
+
+				const float t1{ (-B + sqrtDiscriminant) / (2.f * A) };
+				if (t1 > ray.min && t1 < ray.max) return true;
+			}
+
+			return false;
+		}
+
+		inline Kernels::SphereList GetSphereList(const SphereGeometries& spheres)
 		{
-			HitRecord temp{};
-			return HitTest_Sphere(sphere, ray, temp, true);
+			return { spheres.centerX.data(), spheres.centerY.data(), spheres.centerZ.data(), spheres.squaredRadius.data(), spheres.Size() };
 		}
 #pragma endregion
 
 #pragma region Plane HitTest
 		//PLANE HIT-TESTS
-		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord)
 		{
 			//todo W1
 			const float t = Vector3::Dot(plane.origin - ray.origin, plane.normal) / Vector3::Dot(ray.direction, plane.normal);
 
 			if (t >= ray.min && t <= ray.max && t < hitRecord.t)
 			{
-				if (ignoreHitRecord) return true;
-
-				hitRecord.didHit = true;
-				hitRecord.materialIndex = plane.materialIndex;
-				hitRecord.normal = plane.normal;
-				hitRecord.origin = ray.origin + t * ray.direction;
 				hitRecord.t = t;
-				hitRecord.materialType = plane.materialType;
-
 				return true;
 			}
 
 			return  false;
 		}
 
+		inline void GetHitAttributes(const Plane& plane, const Ray& ray, HitRecord& hitRecord)
+		{
+			hitRecord.didHit = true;
+			hitRecord.materialId = plane.materialId;
+			hitRecord.normal = plane.normal;
+			hitRecord.origin = ray.origin + hitRecord.t * ray.direction;
+		}
+
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_Plane(plane, ray, temp, true);
+			const float t = Vector3::Dot(plane.origin - ray.origin, plane.normal) / Vector3::Dot(ray.direction, plane.normal);
+
+			return t >= ray.min && t <= ray.max;
 		}
 #pragma endregion
 
 #pragma region Triangle HitTest
 		//TRIANGLE HIT-TESTS
-		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		//Shared intersection of the closest-hit and any-hit tests, the cull mode is a template parameter so it is picked once per mesh
+		//instead of being checked for every triangle. Any-hit rays start at a surface and point away from the viewer,
+		//so they cull the opposite side
+		template<TriangleCullMode cullMode, bool anyHit>
+		inline bool IntersectTriangle(const Triangle& triangle, const PreparedRay& ray, float tMax, float& t, float& beta, float& gamma)
 		{
-			const float normalDotViewRay{ Vector3::Dot(triangle.normal, ray.direction) };
-
-			if (ignoreHitRecord)
+			if constexpr (cullMode != TriangleCullMode::NoCulling)
 			{
-				if (triangle.cullMode == TriangleCullMode::BackFaceCulling && normalDotViewRay < 0) return false;
+				const float normalDotViewRay{ Vector3::Dot(triangle.normal, ray.direction) };
 
-				if (triangle.cullMode == TriangleCullMode::FrontFaceCulling && normalDotViewRay > 0) return false;
+				if constexpr ((cullMode == TriangleCullMode::BackFaceCulling) != anyHit)
+				{
+					if (normalDotViewRay > 0) return false;
+				}
+				else
+				{
+					if (normalDotViewRay < 0) return false;
+				}
 			}
-			else
-			{
-				if (triangle.cullMode == TriangleCullMode::BackFaceCulling && normalDotViewRay > 0) return false;
 
-				if (triangle.cullMode == TriangleCullMode::FrontFaceCulling && normalDotViewRay < 0) return false;
+			//watertight test (Woop et al. 2013): shear the vertices into the ray's space where the ray runs along +z through the origin,
+			//the edge functions are then 2D and a ray through a shared edge hits exactly one of the two triangles
+			const Float4 a{ ray.ToRaySpace(triangle.v0) };
+			const Float4 b{ ray.ToRaySpace(triangle.v1) };
+			const Float4 c{ ray.ToRaySpace(triangle.v2) };
+
+			const float ax{ a.X() };
+			const float ay{ a.Y() };
+			const float bx{ b.X() };
+			const float by{ b.Y() };
+			const float cx{ c.X() };
+			const float cy{ c.Y() };
+
+			float u{ cx * by - cy * bx };
+			float v{ ax * cy - ay * cx };
+			float w{ bx * ay - by * ax };
+
+			//exactly on an edge, redo the edge functions in double so the sign is reliable
+			if (u == 0.f || v == 0.f || w == 0.f)
+			{
+				u = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+				v = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+				w = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
 			}
 
-			const Vector3 v0MinusV1{ triangle.v0 - triangle.v1 };
-			const Vector3 v0MinusV2{ triangle.v0 - triangle.v2 };
-
-			Matrix A{ Vector3{v0MinusV1.x, v0MinusV2.x, ray.direction.x},
-					  Vector3{v0MinusV1.y, v0MinusV2.y, ray.direction.y},
-					  Vector3{v0MinusV1.z, v0MinusV2.z, ray.direction.z},
-					  Vector3{}											 };
+			//both windings are accepted here, culling is done on the normal above
+			if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0)) return false;
 
-			const float determinantA{ A.Determinant() };
+			const float determinant{ u + v + w };
+			if (determinant == 0.f) return false;
 
-			const Vector3 v0MinusRayOrigin{ triangle.v0 - ray.origin };
+			const float inverseDeterminant{ 1.f / determinant };
+			t = (u * a.Z() + v * b.Z() + w * c.Z()) * inverseDeterminant;
 
-			const float t{ Matrix{ Vector3{v0MinusV1.x, v0MinusV2.x, v0MinusRayOrigin.x},
-								   Vector3{v0MinusV1.y, v0MinusV2.y, v0MinusRayOrigin.y},
-								   Vector3{v0MinusV1.z, v0MinusV2.z, v0MinusRayOrigin.z},
-								   Vector3{} }.Determinant() / determinantA				 };
+			if (t < ray.min || t > tMax) return false;
 
-			if (t < ray.min || t > ray.max || t > hitRecord.t) return false;
+			beta = v * inverseDeterminant;
+			gamma = w * inverseDeterminant;
 
-			const float gamma{ Matrix{ Vector3{v0MinusV1.x, v0MinusRayOrigin.x, ray.direction.x},
-									   Vector3{v0MinusV1.y, v0MinusRayOrigin.y, ray.direction.y},
-									   Vector3{v0MinusV1.z, v0MinusRayOrigin.z, ray.direction.z},
-									   Vector3{} }.Determinant() / determinantA					 };
+			return true;
+		}
 
-			if (gamma < 0 || gamma > 1) return false;
+		//closest-hit: stores t and the barycentrics, see GetHitAttributes
+		template<TriangleCullMode cullMode>
+		inline bool HitTest_Triangle(const Triangle& triangle, const PreparedRay& ray, HitRecord& hitRecord)
+		{
+			float t{}, beta{}, gamma{};
+			if (!IntersectTriangle<cullMode, false>(triangle, ray, std::min(ray.max, hitRecord.t), t, beta, gamma)) return false;
 
-			const float beta{ Matrix{ Vector3{v0MinusRayOrigin.x, v0MinusV2.x, ray.direction.x},
-									  Vector3{v0MinusRayOrigin.y, v0MinusV2.y, ray.direction.y},
-									  Vector3{v0MinusRayOrigin.z, v0MinusV2.z, ray.direction.z},
-									  Vector3{} }.Determinant() / determinantA					};
+			hitRecord.t = t;
+			hitRecord.beta = beta;
+			hitRecord.gamma = gamma;
 
-			if (beta < 0 || beta >(1 - gamma)) return false;
+			return true;
+		}
 
-			if (ignoreHitRecord) return true;
+		template<TriangleCullMode cullMode>
+		inline bool HitTest_Triangle(const Triangle& triangle, const PreparedRay& ray)
+		{
+			float t{}, beta{}, gamma{};
+			return IntersectTriangle<cullMode, true>(triangle, ray, ray.max, t, beta, gamma);
+		}
 
+		inline void GetHitAttributes(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord)
+		{
 			hitRecord.didHit = true;
-			hitRecord.materialIndex = triangle.materialIndex;
+			hitRecord.materialId = triangle.materialId;
 			hitRecord.normal = triangle.normal;
-			hitRecord.origin = ray.origin + t * ray.direction;
-			hitRecord.t = t;
-			hitRecord.materialType = triangle.materialType;
+			hitRecord.origin = ray.origin + hitRecord.t * ray.direction;
+		}
 
-			return true;
+		//Runtime cull mode versions for single triangles
+		inline bool HitTest_Triangle(const Triangle& triangle, const PreparedRay& ray, HitRecord& hitRecord)
+		{
+			switch (triangle.cullMode)
+			{
+			case TriangleCullMode::FrontFaceCulling:
+				return HitTest_Triangle<TriangleCullMode::FrontFaceCulling>(triangle, ray, hitRecord);
+			case TriangleCullMode::BackFaceCulling:
+				return HitTest_Triangle<TriangleCullMode::BackFaceCulling>(triangle, ray, hitRecord);
+			default:
+				return HitTest_Triangle<TriangleCullMode::NoCulling>(triangle, ray, hitRecord);
+			}
 		}
 
-		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray)
+		inline bool HitTest_Triangle(const Triangle& triangle, const PreparedRay& ray)
 		{
-			HitRecord temp{};
-			return HitTest_Triangle(triangle, ray, temp, true);
+			switch (triangle.cullMode)
+			{
+			case TriangleCullMode::FrontFaceCulling:
+				return HitTest_Triangle<TriangleCullMode::FrontFaceCulling>(triangle, ray);
+			case TriangleCullMode::BackFaceCulling:
+				return HitTest_Triangle<TriangleCullMode::BackFaceCulling>(triangle, ray);
+			default:
+				return HitTest_Triangle<TriangleCullMode::NoCulling>(triangle, ray);
+			}
 		}
 #pragma endregion
 
 #pragma region TriangleMesh SlabTest
-		inline bool SlabTest_TriangleMesh(Vector3 min, Vector3 max, const Ray& ray)
+		inline bool SlabTest_TriangleMesh(const Vector3& min, const Vector3& max, const PreparedRay& ray)
 		{
-			//Smits algorithm
+			//Smits algorithm
 			//source: https://www.researchgate.net/publication/220494140_An_Efficient_and_Robust_Ray-Box_Intersection_Algorithm
+			//all three slabs at once, the sign mask of the prepared ray picks the near and far plane per axis
 
-			const Vector3 minAABB{ min };
-			const Vector3 maxAABB{ max };
+			const Float4 minBounds{ min };
+			const Float4 maxBounds{ max };
 
-			float tMin{}, tMax{};
-			const float divX{ 1.f / ray.direction.x };
+			const Float4 tNear{ (Float4::Select(ray.signMask, maxBounds, minBounds) - ray.originLanes) * ray.inverseDirection };
+			const Float4 tFar{ (Float4::Select(ray.signMask, minBounds, maxBounds) - ray.originLanes) * ray.inverseDirection };
 
-			if (ray.direction.x >= 0)
-			{
-				tMin = (minAABB.x - ray.origin.x) * divX; //multiplying twice is faster the dividing twice
-				tMax = (maxAABB.x - ray.origin.x) * divX;
-			}
-			else
-			{
-				tMin = (maxAABB.x - ray.origin.x) * divX;
-				tMax = (minAABB.x - ray.origin.x) * divX;
-			}
+			const float tMin{ tNear.MaxXYZ() };
+			const float tMax{ tFar.MinXYZ() };
 
-			float tYMin{}, tYMax{};
-			const float divY{ 1.f / ray.direction.y };
+			return tMin <= tMax && tMin < ray.max && tMax > ray.min;
+		}
 
-			if (ray.direction.y >= 0)
-			{
-				tYMin = (minAABB.y - ray.origin.y) * divY;
-				tYMax = (maxAABB.y - ray.origin.y) * divY;
-			}
-			else
-			{
-				tYMin = (maxAABB.y - ray.origin.y) * divY;
-				tYMax = (minAABB.y - ray.origin.y) * divY;
-			}
+		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const PreparedRay& ray)
+		{
+			return SlabTest_TriangleMesh(mesh.transformedMinAABB, mesh.transformedMaxAABB, ray);
+		}
+#pragma endregion
 
-			if (tMin > tYMax || tYMin > tMax) return false;
+		//Runs testTriangles(first, count) for the triangles of every leaf the ray passes through (in the same depth first order
+		//as before), stops and returns true as soon as testTriangles does, which is what the any-hit traversal needs
+		template<typename TriangleRangeTest>
+		inline bool HitTest_BVH(const TriangleMesh& mesh, const PreparedRay& ray, int nodeIndex, const TriangleRangeTest& testTriangles)
+		{
+			const BVHNode& node{ mesh.bvhNodes[nodeIndex] };
 
-			if (tYMin > tMin) tMin = tYMin;
+			if (!SlabTest_TriangleMesh(node.AABBMin, node.AABBMax, ray)) return false;
 
-			if (tYMax < tMax) tMax = tYMax;
+			if (mesh.lazyBVH) mesh.ExpandLazyNode(nodeIndex);
 
-			float tZMin{}, tZMax{};
-			const float divZ{ 1.f / ray.direction.z };
+			if (node.amountOfMeshes != 0) return testTriangles(node.leftChildIndex, node.amountOfMeshes);
 
-			if (ray.direction.z >= 0)
+			return HitTest_BVH(mesh, ray, node.leftChildIndex, testTriangles)
+				|| HitTest_BVH(mesh, ray, node.leftChildIndex + 1, testTriangles); //leftChildIndex + 1 == rightChildIndex
+		}
+
+#pragma region TriangeMesh HitTest
+		//Loops over the candidate triangle ranges of the mesh (the bvh leaves, or all triangles without a bvh), stops when testTriangles returns true
+		template<typename TriangleRangeTest>
+		inline bool ForEachMeshTriangleRange(const TriangleMesh& mesh, const PreparedRay& ray, const TriangleRangeTest& testTriangles)
+		{
+			//mesh is still being loaded
+			if (mesh.GetAmountOfTriangles() == 0 || (mesh.useBVH && mesh.bvhNodes.empty())) return false;
+
+			//slabTest
+			if (!SlabTest_TriangleMesh(mesh, ray)) return false;
+
+			if (mesh.useBVH) return HitTest_BVH(mesh, ray, mesh.rootNodeIndex, testTriangles);
+
+			return testTriangles(0, mesh.GetAmountOfTriangles());
+		}
+
+		inline Kernels::TriangleList GetMeshTriangles(const TriangleMesh& mesh)
+		{
+			if (mesh.compressed)
 			{
-				tZMin = (minAABB.z - ray.origin.z) * divZ;
-				tZMax = (maxAABB.z - ray.origin.z) * divZ;
+				const CompressedTriangles& compressed{ mesh.compressedTriangles };
+
+				Kernels::TriangleList triangles{};
+				triangles.pQuantizedPositions = compressed.positions.data();
+				triangles.pEncodedNormals = compressed.normals.data();
+				triangles.pCompressedIndices = compressed.indices.data();
+				triangles.indexWidth = compressed.indexWidth;
+				triangles.pDecoder = &compressed.decoder;
+				triangles.cullMode = mesh.cullMode;
+
+				return triangles;
 			}
-			else
+
+			const PackedTriangles& packed{ mesh.packedTriangles };
+
+			Kernels::TriangleList triangles{ mesh.transformedPositions.data(), mesh.indices.data(), mesh.transformedNormals.data() };
+			for (int vertex{}; vertex < 3; ++vertex)
 			{
-				tZMin = (maxAABB.z - ray.origin.z) * divZ;
-				tZMax = (minAABB.z - ray.origin.z) * divZ;
+				triangles.pVertexX[vertex] = packed.vertexX[vertex].data();
+				triangles.pVertexY[vertex] = packed.vertexY[vertex].data();
+				triangles.pVertexZ[vertex] = packed.vertexZ[vertex].data();
 			}
+			triangles.pNormalX = packed.normalX.data();
+			triangles.pNormalY = packed.normalY.data();
+			triangles.pNormalZ = packed.normalZ.data();
+			triangles.cullMode = mesh.cullMode;
 
-			if (tMin > tZMax || tZMin > tMax) return false;
+			return triangles;
+		}
 
-			if (tZMin > tMin) tMin = tZMin;
+		//closest-hit: the triangles of every range are tested by the kernel of the selected instruction set (see Kernels.h),
+		//stores t, the barycentrics and the triangle index, see GetHitAttributes
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const PreparedRay& ray, HitRecord& hitRecord)
+		{
+			const Kernels::TriangleList triangles{ GetMeshTriangles(mesh) };
+			const auto closestHitTriangles{ Kernels::Get().closestHitTriangles };
+
+			bool didHit{};
+			ForEachMeshTriangleRange(mesh, ray, [&](int first, int count)
+				{
+					const int closest{ closestHitTriangles(triangles, first, count, ray, hitRecord) };
+					if (closest >= 0)
+					{
+						hitRecord.triangleIndex = static_cast<uint32_t>(closest);
+						didHit = true;
+					}
+					return false;
+				});
+
+			return didHit;
+		}
 
-			if (tZMax < tMax) tMax = tZMax;
+		//any-hit: stops at the first range with a triangle that blocks the ray, no hit record
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const PreparedRay& ray)
+		{
+			const Kernels::TriangleList triangles{ GetMeshTriangles(mesh) };
+			const auto anyHitTriangles{ Kernels::Get().anyHitTriangles };
 
-			return tMin < ray.max&& tMax > ray.min;
+			return ForEachMeshTriangleRange(mesh, ray, [&](int first, int count)
+				{
+					return anyHitTriangles(triangles, first, count, ray);
+				});
 		}
 
-		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		inline void GetHitAttributes(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord)
 		{
-			return SlabTest_TriangleMesh(mesh.transformedMinAABB, mesh.transformedMaxAABB, ray);
+			hitRecord.didHit = true;
+			hitRecord.materialId = mesh.materialId;
+			hitRecord.normal = mesh.GetTransformedNormal(hitRecord.triangleIndex);
+			hitRecord.origin = ray.origin + hitRecord.t * ray.direction;
 		}
 #pragma endregion
 
-		inline bool HitTest_BVH(const TriangleMesh& mesh, const Ray& ray, int nodeIndex, HitRecord& hitRecord, std::vector<int>& triangleIndicesToTest, bool ignoreHitRecord = false)
+#pragma region StreamedMesh HitTest
+		//Depth first over a complete tree (the top of a streamed mesh or one of its treelets), the same order as HitTest_BVH,
+		//runs testLeaf(first, count) for every leaf the ray passes through and stops as soon as it returns true
+		template<typename LeafTest>
+		inline bool HitTest_BVH(const BVHNode* pNodes, const PreparedRay& ray, int nodeIndex, const LeafTest& testLeaf)
 		{
-			const BVHNode& node{ mesh.bvhNodes[nodeIndex] };
+			const BVHNode& node{ pNodes[nodeIndex] };
 
 			if (!SlabTest_TriangleMesh(node.AABBMin, node.AABBMax, ray)) return false;
 
-			if (node.amountOfMeshes != 0)
-			{
-				triangleIndicesToTest.push_back(nodeIndex);
-			}
-			else
-			{
-				HitTest_BVH(mesh, ray, node.leftChildIndex, hitRecord, triangleIndicesToTest, ignoreHitRecord);
-				HitTest_BVH(mesh, ray, node.leftChildIndex + 1, hitRecord, triangleIndicesToTest, ignoreHitRecord); //leftChildIndex + 1 == rightChildIndex
-			}
+			if (node.amountOfMeshes != 0) return testLeaf(node.leftChildIndex, node.amountOfMeshes);
+
+			return HitTest_BVH(pNodes, ray, node.leftChildIndex, testLeaf)
+				|| HitTest_BVH(pNodes, ray, node.leftChildIndex + 1, testLeaf);
 		}
 
-#pragma region TriangeMesh HitTest
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		//Runs testTriangles(treelet, triangles, first, count) for the triangles of every leaf the ray passes through, a treelet is
+		//acquired (paged in when it isn't resident) once per ray that reaches it
+		template<typename TriangleRangeTest>
+		inline bool ForEachStreamedTriangleRange(const StreamedMesh& mesh, const PreparedRay& ray, const TriangleRangeTest& testTriangles)
 		{
-			//slabTest
-			if (!SlabTest_TriangleMesh(mesh, ray))
-			{
-				return false;
-			}
+			//failed to open
+			if (mesh.GetTopNodes().empty()) return false;
 
-			Triangle triangle{};
-			triangle.cullMode = mesh.cullMode;
-			triangle.materialIndex = mesh.materialIndex;
-			triangle.materialType = mesh.materialType;
-
-			if(mesh.useBVH)
-			{
-				std::vector<int> trianglesToTestIndices{};
-				 HitTest_BVH(mesh, ray, mesh.rootNodeIndex, hitRecord, trianglesToTestIndices, ignoreHitRecord);
+			return HitTest_BVH(mesh.GetTopNodes().data(), ray, 0, [&](int treeletIndex, int)
+				{
+					const std::shared_ptr<const StreamedMesh::Treelet> pTreelet{ mesh.AcquireTreelet(treeletIndex) };
+					if (!pTreelet) return false;
+
+					const Kernels::TriangleList triangles{ mesh.GetTriangles(*pTreelet) };
+					return HitTest_BVH(pTreelet->nodes.data(), ray, 0, [&](int first, int count)
+						{
+							return testTriangles(*pTreelet, triangles, first, count);
+						});
+				});
+		}
 
-				 if (trianglesToTestIndices.empty()) return false;
+		//closest-hit: stores t, the barycentrics, the index of the triangle in the whole mesh and its normal, see GetHitAttributes
+		//the normal is read while the treelet is still acquired, the hit attributes don't go through the cache again
+		inline bool HitTest_StreamedMesh(const StreamedMesh& mesh, const PreparedRay& ray, HitRecord& hitRecord)
+		{
+			const auto closestHitTriangles{ Kernels::Get().closestHitTriangles };
 
-				for (int index{}; index < trianglesToTestIndices.size(); ++index)
+			bool didHit{};
+			ForEachStreamedTriangleRange(mesh, ray, [&](const StreamedMesh::Treelet& treelet, const Kernels::TriangleList& triangles, int first, int count)
 				{
-					 int start{ mesh.bvhNodes[trianglesToTestIndices[index]].leftChildIndex };
-					 int end{ start + mesh.bvhNodes[trianglesToTestIndices[index]].amountOfMeshes };
-					 for (int index{start}; index < end; ++index)
-					 {
-						 triangle.normal = mesh.transformedNormals[index];
-						 triangle.v0 = mesh.transformedPositions[mesh.indices[index * 3]];
-						 triangle.v1 = mesh.transformedPositions[mesh.indices[index * 3 + 1]];
-						 triangle.v2 = mesh.transformedPositions[mesh.indices[index * 3 + 2]];
-
-						 if (HitTest_Triangle(triangle, ray, hitRecord, ignoreHitRecord) && ignoreHitRecord) return true;
-					 }
-				}	 
-			}
-			else
-			{
-				const int amountOfTriangles{ static_cast<int>(mesh.indices.size()) / 3 };
-				for (int index{}; index < amountOfTriangles; ++index)
-				{
-					triangle.normal = mesh.transformedNormals[index];
-					triangle.v0 = mesh.transformedPositions[mesh.indices[index * 3]];
-					triangle.v1 = mesh.transformedPositions[mesh.indices[index * 3 + 1]];
-					triangle.v2 = mesh.transformedPositions[mesh.indices[index * 3 + 2]];
+					const int closest{ closestHitTriangles(triangles, first, count, ray, hitRecord) };
+					if (closest >= 0)
+					{
+						const PackedTriangles& packed{ treelet.triangles };
+						hitRecord.triangleIndex = static_cast<uint32_t>(treelet.firstTriangle + closest);
+						hitRecord.normal = { packed.normalX[closest], packed.normalY[closest], packed.normalZ[closest] }; //stored normalized
+						didHit = true;
+					}
+					return false;
+				});
+
+			return didHit;
+		}
 
-					if (HitTest_Triangle(triangle, ray, hitRecord, ignoreHitRecord) && ignoreHitRecord) return true;
-				}
-			}
+		//any-hit: stops at the first range with a triangle that blocks the ray, no hit record
+		inline bool HitTest_StreamedMesh(const StreamedMesh& mesh, const PreparedRay& ray)
+		{
+			const auto anyHitTriangles{ Kernels::Get().anyHitTriangles };
 
-			return false;
+			return ForEachStreamedTriangleRange(mesh, ray, [&](const StreamedMesh::Treelet&, const Kernels::TriangleList& triangles, int first, int count)
+				{
+					return anyHitTriangles(triangles, first, count, ray);
+				});
 		}
 
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		inline void GetHitAttributes(const StreamedMesh& mesh, const Ray& ray, HitRecord& hitRecord)
 		{
-			HitRecord temp{};
-			return HitTest_TriangleMesh(mesh, ray, temp, true);
+			hitRecord.didHit = true;
+			hitRecord.materialId = mesh.materialId;
+			//the normal was stored by HitTest_StreamedMesh
+			hitRecord.origin = ray.origin + hitRecord.t * ray.direction;
 		}
 #pragma endregion
 	}
@@ -333,91 +469,26 @@ namespace dae
 			if(light.type == LightType::Point)
 			{
 				const Vector3 targetToLight{ GetDirectionToLight(light, target) };
-				const float irradiance{ light.intensity / (targetToLight.SqrMagnitude()) };
-				return{ light.color * irradiance };
-			}
-
-			if(light.type == LightType::Directional)
-			{
-				return{ light.color * light.intensity };
-			}
-
-			return ColorRGB{ 0.f, 0.f, 0.f };
-		}
-	}
-
-	namespace Utils
-	{
-		//Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
-		{
-			std::ifstream file(filename);
-			if (!file)
-				return false;
+				const float sqrDistance{ targetToLight.SqrMagnitude() };
+				const float irradiance{ light.intensity / (sqrDistance) };
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
-			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
-				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
-				}
-				else if (sCommand == "f")
+				if (light.radius < FLT_MAX)
 				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
-
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
+					//smooth window that reaches 0 at the influence radius: (1 - (d / r)^4)^2
+					const float sqrDistanceRatio{ sqrDistance / (light.radius * light.radius) };
+					const float window{ std::max(1.f - sqrDistanceRatio * sqrDistanceRatio, 0.f) };
+					return{ light.color * (irradiance * window * window) };
 				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
 
-				if (file.eof()) 
-					break;
+				return{ light.color * irradiance };
 			}
 
-			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
+			if(light.type == LightType::Directional)
 			{
-				uint32_t i0 = indices[index];
-				uint32_t i1 = indices[index + 1];
-				uint32_t i2 = indices[index + 2];
-
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
-
-				if(isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normal.Normalize();
-				if (isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normals.push_back(normal);
+				return{ light.color * light.intensity };
 			}
 
-			return true;
+			return ColorRGB{ 0.f, 0.f, 0.f };
 		}
-#pragma warning(pop)
 	}
 }
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "Wavefront.h"
+
+#include "Camera.h"
+#include "LightBVH.h"
+#include "LightGrid.h"
+#include "Scene.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace Wavefront
+	{
+#pragma region QUEUES
+		void RayQueue::Clear()
+		{
+			directionX.clear();
+			directionY.clear();
+			directionZ.clear();
+			pixelIndex.clear();
+		}
+
+		void RayQueue::Reserve(size_t size)
+		{
+			directionX.reserve(size);
+			directionY.reserve(size);
+			directionZ.reserve(size);
+			pixelIndex.reserve(size);
+		}
+
+		void RayQueue::Push(const Vector3& direction, uint32_t pixel)
+		{
+			directionX.push_back(direction.x);
+			directionY.push_back(direction.y);
+			directionZ.push_back(direction.z);
+			pixelIndex.push_back(pixel);
+		}
+
+		void HitQueue::Clear()
+		{
+			Resize(0);
+		}
+
+		void HitQueue::Reserve(size_t size)
+		{
+			originX.reserve(size);
+			originY.reserve(size);
+			originZ.reserve(size);
+			normalX.reserve(size);
+			normalY.reserve(size);
+			normalZ.reserve(size);
+			rayDirectionX.reserve(size);
+			rayDirectionY.reserve(size);
+			rayDirectionZ.reserve(size);
+			materialId.reserve(size);
+			pixelIndex.reserve(size);
+			colorR.reserve(size);
+			colorG.reserve(size);
+			colorB.reserve(size);
+		}
+
+		void HitQueue::Resize(size_t size)
+		{
+			originX.resize(size);
+			originY.resize(size);
+			originZ.resize(size);
+			normalX.resize(size);
+			normalY.resize(size);
+			normalZ.resize(size);
+			rayDirectionX.resize(size);
+			rayDirectionY.resize(size);
+			rayDirectionZ.resize(size);
+			materialId.resize(size);
+			pixelIndex.resize(size);
+			colorR.resize(size);
+			colorG.resize(size);
+			colorB.resize(size);
+		}
+
+		void HitQueue::Push(const HitRecord& hitRecord, const Vector3& rayDirection, uint32_t pixel)
+		{
+			originX.push_back(hitRecord.origin.x);
+			originY.push_back(hitRecord.origin.y);
+			originZ.push_back(hitRecord.origin.z);
+			normalX.push_back(hitRecord.normal.x);
+			normalY.push_back(hitRecord.normal.y);
+			normalZ.push_back(hitRecord.normal.z);
+			rayDirectionX.push_back(rayDirection.x);
+			rayDirectionY.push_back(rayDirection.y);
+			rayDirectionZ.push_back(rayDirection.z);
+			materialId.push_back(hitRecord.materialId);
+			pixelIndex.push_back(pixel);
+			colorR.push_back(0.f);
+			colorG.push_back(0.f);
+			colorB.push_back(0.f);
+		}
+
+		void HitQueue::CopyEntry(const HitQueue& from, size_t fromIndex, size_t toIndex)
+		{
+			originX[toIndex] = from.originX[fromIndex];
+			originY[toIndex] = from.originY[fromIndex];
+			originZ[toIndex] = from.originZ[fromIndex];
+			normalX[toIndex] = from.normalX[fromIndex];
+			normalY[toIndex] = from.normalY[fromIndex];
+			normalZ[toIndex] = from.normalZ[fromIndex];
+			rayDirectionX[toIndex] = from.rayDirectionX[fromIndex];
+			rayDirectionY[toIndex] = from.rayDirectionY[fromIndex];
+			rayDirectionZ[toIndex] = from.rayDirectionZ[fromIndex];
+			materialId[toIndex] = from.materialId[fromIndex];
+			pixelIndex[toIndex] = from.pixelIndex[fromIndex];
+			colorR[toIndex] = from.colorR[fromIndex];
+			colorG[toIndex] = from.colorG[fromIndex];
+			colorB[toIndex] = from.colorB[fromIndex];
+		}
+
+		void HitQueue::AddColor(size_t index, const ColorRGB& color)
+		{
+			colorR[index] += color.r;
+			colorG[index] += color.g;
+			colorB[index] += color.b;
+		}
+
+		void ShadowRayQueue::Clear()
+		{
+			Resize(0);
+		}
+
+		void ShadowRayQueue::Reserve(size_t size)
+		{
+			originX.reserve(size);
+			originY.reserve(size);
+			originZ.reserve(size);
+			directionX.reserve(size);
+			directionY.reserve(size);
+			directionZ.reserve(size);
+			max.reserve(size);
+			hitIndex.reserve(size);
+			lightIndex.reserve(size);
+			weight.reserve(size);
+			occluded.reserve(size);
+		}
+
+		void ShadowRayQueue::Resize(size_t size)
+		{
+			originX.resize(size);
+			originY.resize(size);
+			originZ.resize(size);
+			directionX.resize(size);
+			directionY.resize(size);
+			directionZ.resize(size);
+			max.resize(size);
+			hitIndex.resize(size);
+			lightIndex.resize(size);
+			weight.resize(size);
+			occluded.resize(size);
+		}
+
+		void ShadowRayQueue::Push(const Vector3& origin, const Vector3& direction, float distance, uint32_t hit, uint32_t light, float lightWeight)
+		{
+			originX.push_back(origin.x);
+			originY.push_back(origin.y);
+			originZ.push_back(origin.z);
+			directionX.push_back(direction.x);
+			directionY.push_back(direction.y);
+			directionZ.push_back(direction.z);
+			max.push_back(distance);
+			hitIndex.push_back(hit);
+			lightIndex.push_back(light);
+			weight.push_back(lightWeight);
+			occluded.push_back(false);
+		}
+
+		void ShadowRayQueue::CopyEntry(size_t fromIndex, size_t toIndex)
+		{
+			originX[toIndex] = originX[fromIndex];
+			originY[toIndex] = originY[fromIndex];
+			originZ[toIndex] = originZ[fromIndex];
+			directionX[toIndex] = directionX[fromIndex];
+			directionY[toIndex] = directionY[fromIndex];
+			directionZ[toIndex] = directionZ[fromIndex];
+			max[toIndex] = max[fromIndex];
+			hitIndex[toIndex] = hitIndex[fromIndex];
+			lightIndex[toIndex] = lightIndex[fromIndex];
+			weight[toIndex] = weight[fromIndex];
+			occluded[toIndex] = occluded[fromIndex];
+		}
+
+		void Queues::Reserve(size_t amountOfMaterials, size_t maxShadowRaysPerHit)
+		{
+			constexpr size_t amountOfPixels{ TILE_SIZE * TILE_SIZE };
+
+			rays.Reserve(amountOfPixels);
+			hits.Reserve(amountOfPixels);
+			sortedHits.Reserve(amountOfPixels);
+			shadowRays.Reserve(amountOfPixels * maxShadowRaysPerHit);
+			materialOffsets.reserve(amountOfMaterials + 1);
+		}
+#pragma endregion
+
+#pragma region STAGES
+		namespace
+		{
+			//Lights further away than their radius don't get a shadow ray
+			void PushShadowRay(const Vector3& rayOrigin, uint32_t hitIndex, const std::vector<Light>& lights, uint32_t lightIndex, float weight, ShadowRayQueue& shadowRays)
+			{
+				const Light& light{ lights[lightIndex] };
+
+				Vector3 toLight{ LightUtils::GetDirectionToLight(light, rayOrigin) };
+				const float distanceToLight = toLight.Normalize();
+
+				if (distanceToLight >= light.radius) return;
+
+				shadowRays.Push(rayOrigin, toLight, distanceToLight, hitIndex, lightIndex, weight);
+			}
+		}
+
+		void GeneratePrimaryRays(const Camera& camera, const Tile& tile, int width, int height, float fov, float aspectRatio, RayQueue& rays)
+		{
+			rays.Clear();
+			rays.origin = camera.origin;
+
+			for (int py{ tile.y }; py < tile.y + tile.height; ++py)
+			{
+				for (int px{ tile.x }; px < tile.x + tile.width; ++px)
+				{
+					Vector3 rayDirection
+					{
+						(2 * (px + 0.5f) / static_cast<float>(width) - 1) * aspectRatio * fov,
+						(1 - 2 * (py + 0.5f) / static_cast<float>(height)) * fov,
+						1.f
+					};
+
+					rayDirection.Normalize();
+					rays.Push(camera.cameraToWorld.TransformVector(rayDirection), static_cast<uint32_t>(px + py * width));
+				}
+			}
+		}
+
+		void IntersectPrimaryRays(const Scene* pScene, const RayQueue& rays, HitQueue& hits)
+		{
+			hits.Clear();
+
+			const size_t amountOfRays{ rays.Size() };
+			for (size_t index{}; index < amountOfRays; ++index)
+			{
+				const Ray viewRay{ rays.origin, rays.GetDirection(index) };
+
+				HitRecord closestHit{};
+				pScene->GetClosestHit(viewRay, closestHit);
+
+				if (closestHit.didHit)
+				{
+					hits.Push(closestHit, viewRay.direction, rays.pixelIndex[index]);
+				}
+			}
+		}
+
+		void SortHitsByMaterial(const HitQueue& hits, size_t amountOfMaterials, std::vector<uint32_t>& materialOffsets, HitQueue& sortedHits)
+		{
+			materialOffsets.assign(amountOfMaterials + 1, 0);
+
+			const size_t amountOfHits{ hits.Size() };
+			for (size_t index{}; index < amountOfHits; ++index)
+			{
+				++materialOffsets[hits.materialId[index] + 1];
+			}
+
+			for (size_t materialId{ 1 }; materialId <= amountOfMaterials; ++materialId)
+			{
+				materialOffsets[materialId] += materialOffsets[materialId - 1];
+			}
+
+			sortedHits.Resize(amountOfHits);
+			for (size_t index{}; index < amountOfHits; ++index)
+			{
+				sortedHits.CopyEntry(hits, index, materialOffsets[hits.materialId[index]]++);
+			}
+		}
+
+		void EmitShadowRays(const HitQueue& hits, const std::vector<Light>& lights, const LightGrid& lightGrid, ShadowRayQueue& shadowRays)
+		{
+			shadowRays.Clear();
+
+			const size_t amountOfHits{ hits.Size() };
+			for (size_t hitIndex{}; hitIndex < amountOfHits; ++hitIndex)
+			{
+				Vector3 rayOrigin{ hits.GetOrigin(hitIndex) };
+				rayOrigin += hits.GetNormal(hitIndex) * 0.0001f;
+
+				lightGrid.ForEachLight(hits.GetOrigin(hitIndex), [&](uint32_t lightIndex)
+					{
+						PushShadowRay(rayOrigin, static_cast<uint32_t>(hitIndex), lights, lightIndex, 1.f, shadowRays);
+					});
+			}
+		}
+
+		void EmitSampledShadowRays(const HitQueue& hits, const std::vector<Light>& lights, const LightBVH& lightBVH, int samplesPerPixel, uint32_t frameIndex, bool useCosineBound, ShadowRayQueue& shadowRays)
+		{
+			shadowRays.Clear();
+
+			const size_t amountOfHits{ hits.Size() };
+			for (size_t hitIndex{}; hitIndex < amountOfHits; ++hitIndex)
+			{
+				Vector3 rayOrigin{ hits.GetOrigin(hitIndex) };
+				rayOrigin += hits.GetNormal(hitIndex) * 0.0001f;
+
+				for (const uint32_t lightIndex : lightBVH.GetGlobalLights())
+				{
+					PushShadowRay(rayOrigin, static_cast<uint32_t>(hitIndex), lights, lightIndex, 1.f, shadowRays);
+				}
+
+				uint32_t randomState{ Hash(hits.pixelIndex[hitIndex] ^ Hash(frameIndex)) };
+				for (int sampleIndex{}; sampleIndex < samplesPerPixel; ++sampleIndex)
+				{
+					uint32_t lightIndex{};
+					float pdf{};
+					if (lightBVH.Sample(hits.GetOrigin(hitIndex), hits.GetNormal(hitIndex), useCosineBound, RandomFloat(randomState), lightIndex, pdf))
+					{
+						PushShadowRay(rayOrigin, static_cast<uint32_t>(hitIndex), lights, lightIndex, 1.f / (pdf * static_cast<float>(samplesPerPixel)), shadowRays);
+					}
+				}
+			}
+		}
+
+		void TraceShadowRays(const Scene* pScene, ShadowRayQueue& shadowRays)
+		{
+			const size_t amountOfShadowRays{ shadowRays.Size() };
+			for (size_t index{}; index < amountOfShadowRays; ++index)
+			{
+				Ray lightRay{};
+				lightRay.origin = shadowRays.GetOrigin(index);
+				lightRay.direction = shadowRays.GetDirection(index);
+				lightRay.max = shadowRays.max[index];
+
+				shadowRays.occluded[index] = pScene->DoesHit(lightRay);
+			}
+		}
+#pragma endregion
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	struct Camera;
+	struct Material;
+	class Scene;
+	class LightGrid;
+	class LightBVH;
+
+	//Wavefront rendering, a tile of pixels goes through every stage before the next stage starts:
+	//generate primary rays > closest hit > sort hits by material > emit shadow rays > trace shadow rays > shade
+	//every stage reads and writes compact SoA queues so each loop runs the same work over contiguous memory
+	namespace Wavefront
+	{
+		constexpr int TILE_SIZE{ 32 }; //tile of TILE_SIZE x TILE_SIZE pixels per pass through the pipeline
+
+		struct Tile
+		{
+			int x{};
+			int y{};
+			int width{};
+			int height{};
+		};
+
+#pragma region QUEUES
+		//Primary rays, they all start at the camera origin
+		struct RayQueue
+		{
+			Vector3 origin{};
+
+			std::vector<float> directionX{};
+			std::vector<float> directionY{};
+			std::vector<float> directionZ{};
+			std::vector<uint32_t> pixelIndex{};
+
+			size_t Size() const { return pixelIndex.size(); }
+			void Clear();
+			void Reserve(size_t size);
+			void Push(const Vector3& direction, uint32_t pixel);
+
+			Vector3 GetDirection(size_t index) const { return { directionX[index], directionY[index], directionZ[index] }; }
+		};
+
+		//Closest hits of the primary rays, color accumulates the shaded lights of that hit
+		struct HitQueue
+		{
+			std::vector<float> originX{};
+			std::vector<float> originY{};
+			std::vector<float> originZ{};
+			std::vector<float> normalX{};
+			std::vector<float> normalY{};
+			std::vector<float> normalZ{};
+			std::vector<float> rayDirectionX{};
+			std::vector<float> rayDirectionY{};
+			std::vector<float> rayDirectionZ{};
+			std::vector<uint16_t> materialId{};
+			std::vector<uint32_t> pixelIndex{};
+
+			std::vector<float> colorR{};
+			std::vector<float> colorG{};
+			std::vector<float> colorB{};
+
+			size_t Size() const { return pixelIndex.size(); }
+			void Clear();
+			void Reserve(size_t size);
+			void Resize(size_t size);
+			void Push(const HitRecord& hitRecord, const Vector3& rayDirection, uint32_t pixel);
+			void CopyEntry(const HitQueue& from, size_t fromIndex, size_t toIndex);
+			void AddColor(size_t index, const ColorRGB& color);
+
+			Vector3 GetOrigin(size_t index) const { return { originX[index], originY[index], originZ[index] }; }
+			Vector3 GetNormal(size_t index) const { return { normalX[index], normalY[index], normalZ[index] }; }
+			Vector3 GetRayDirection(size_t index) const { return { rayDirectionX[index], rayDirectionY[index], rayDirectionZ[index] }; }
+			ColorRGB GetColor(size_t index) const { return { colorR[index], colorG[index], colorB[index] }; }
+		};
+
+		//One entry per hit and light (in hit then light order), direction is the normalized direction to the light
+		//weight scales the light's contribution (1 / (samples * pdf) for sampled lights)
+		struct ShadowRayQueue
+		{
+			std::vector<float> originX{};
+			std::vector<float> originY{};
+			std::vector<float> originZ{};
+			std::vector<float> directionX{};
+			std::vector<float> directionY{};
+			std::vector<float> directionZ{};
+			std::vector<float> max{};
+			std::vector<uint32_t> hitIndex{};
+			std::vector<uint32_t> lightIndex{};
+			std::vector<float> weight{};
+			std::vector<uint8_t> occluded{};
+
+			size_t Size() const { return hitIndex.size(); }
+			void Clear();
+			void Reserve(size_t size);
+			void Resize(size_t size);
+			void Push(const Vector3& origin, const Vector3& direction, float distance, uint32_t hit, uint32_t light, float lightWeight = 1.f);
+			void CopyEntry(size_t fromIndex, size_t toIndex);
+
+			Vector3 GetOrigin(size_t index) const { return { originX[index], originY[index], originZ[index] }; }
+			Vector3 GetDirection(size_t index) const { return { directionX[index], directionY[index], directionZ[index] }; }
+		};
+
+		//All queues of one worker, kept alive between tiles and frames so the buffers only grow once
+		struct Queues
+		{
+			RayQueue rays{};
+			HitQueue hits{};
+			HitQueue sortedHits{};
+			ShadowRayQueue shadowRays{};
+			std::vector<uint32_t> materialOffsets{};
+
+			//Grows every queue to what a full tile can need, so they don't grow partway through a frame depending on which tiles
+			//a worker happens to get. Does nothing once they are big enough
+			void Reserve(size_t amountOfMaterials, size_t maxShadowRaysPerHit);
+		};
+#pragma endregion
+
+#pragma region STAGES
+		void GeneratePrimaryRays(const Camera& camera, const Tile& tile, int width, int height, float fov, float aspectRatio, RayQueue& rays);
+		void IntersectPrimaryRays(const Scene* pScene, const RayQueue& rays, HitQueue& hits);
+		//Counting sort on materialId, hits of the same material end up next to each other (and so do materials of the same type when they were added together)
+		void SortHitsByMaterial(const HitQueue& hits, size_t amountOfMaterials, std::vector<uint32_t>& materialOffsets, HitQueue& sortedHits);
+		//Only the lights of the hit's light grid cell that are within their radius get a shadow ray
+		void EmitShadowRays(const HitQueue& hits, const std::vector<Light>& lights, const LightGrid& lightGrid, ShadowRayQueue& shadowRays);
+		//Directional lights plus samplesPerPixel point lights picked through the light bvh, seeded the same way as Renderer::ShadeLights
+		void EmitSampledShadowRays(const HitQueue& hits, const std::vector<Light>& lights, const LightBVH& lightBVH, int samplesPerPixel, uint32_t frameIndex, bool useCosineBound, ShadowRayQueue& shadowRays);
+		void TraceShadowRays(const Scene* pScene, ShadowRayQueue& shadowRays);
+#pragma endregion
+	}
+}
@@ -1,16 +1,23 @@
 //External includes
-#include "vld.h"
+#ifdef _WIN32
+#include "vld.h" //leak detection, AllocationTracker counts the allocations on every platform
+#endif
 #include "SDL.h"
 #include "SDL_surface.h"
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "Kernels.h"
+#include "AllocationTracker.h"
 
 using namespace dae;
 
@@ -20,11 +27,186 @@ void ShutDown(SDL_Window* pWindow)
 	SDL_Quit();
 }
 
+//One frame of the main loop, without the input handling
+AllocationTracker::FrameReport RunFrame(Timer* pTimer, Renderer* pRenderer, Scene* pScene)
+{
+	AllocationTracker::BeginFrame();
+	{
+		const AllocationTracker::ScopedPhase phase{ AllocationTracker::Phase::Update };
+		pScene->Update(pTimer);
+	}
+	pRenderer->Render(pScene);
+	pTimer->Update();
+	return AllocationTracker::EndFrame();
+}
+
+void PrintAllocations(const AllocationTracker::FrameReport& report)
+{
+	for (int phase{}; phase < static_cast<int>(AllocationTracker::Phase::Count); ++phase)
+	{
+		const AllocationTracker::Counters& counters{ report.phases[phase] };
+		if (counters.allocations == 0) continue;
+
+		std::cout << "  " << AllocationTracker::ToString(static_cast<AllocationTracker::Phase>(phase)) << ": "
+			<< counters.allocations << " allocations, " << counters.bytes << " bytes" << std::endl;
+	}
+}
+
+//Renders scene without a user (--allocation-test) in every combination of the pixel loop or wavefront and the light grid or
+//light sampling with accumulation. After a few warm up frames (buffers and caches growing to their final size) no frame may
+//allocate, returns false when one did
+bool RunAllocationTest(Timer* pTimer, Renderer* pRenderer, Scene* pScene)
+{
+	constexpr int amountOfWarmUpFrames{ 3 };
+	constexpr int amountOfTestedFrames{ 10 };
+
+	pScene->Initialize();
+	while (pScene->IsLoading())
+	{
+		pScene->Update(pTimer);
+		SDL_Delay(1);
+	}
+
+	bool succeeded{ true };
+	for (const bool lightSampling : { false, true })
+	{
+		for (const bool wavefront : { false, true })
+		{
+			if (wavefront) pRenderer->ToggleWavefront();
+			if (lightSampling)
+			{
+				pRenderer->ToggleLightSampling();
+				pRenderer->ToggleAccumulation();
+			}
+
+			for (int frame{}; frame < amountOfWarmUpFrames; ++frame)
+			{
+				RunFrame(pTimer, pRenderer, pScene);
+			}
+
+			for (int frame{}; frame < amountOfTestedFrames; ++frame)
+			{
+				const AllocationTracker::FrameReport report{ RunFrame(pTimer, pRenderer, pScene) };
+				if (report.total.allocations == 0) continue;
+
+				std::cout << pScene->GetName() << ", " << (wavefront ? "wavefront" : "pixel loop") << (lightSampling ? " with light sampling" : "")
+					<< ", frame " << frame << " allocated " << report.total.allocations << " times (" << report.total.bytes << " bytes)" << std::endl;
+				PrintAllocations(report);
+				succeeded = false;
+			}
+
+			if (wavefront) pRenderer->ToggleWavefront();
+			if (lightSampling)
+			{
+				pRenderer->ToggleLightSampling();
+				pRenderer->ToggleAccumulation();
+			}
+		}
+	}
+
+	std::cout << pScene->GetName() << ": allocation test " << (succeeded ? "passed" : "failed") << ", " << amountOfTestedFrames << " frames per path" << std::endl;
+	return succeeded;
+}
+
+//A scene of planes and spheres, a triangle mesh scene and one with hundreds of lights
+bool RunAllocationTests(Timer* pTimer, Renderer* pRenderer)
+{
+	Scene* const pScenes[]{ new Scene_W4_ReferenceScene(), new Scene_W4_BunnyScene(), new Scene_ManyLights() };
+
+	bool succeeded{ true };
+	for (Scene* pScene : pScenes)
+	{
+		succeeded = RunAllocationTest(pTimer, pRenderer, pScene) && succeeded;
+		delete pScene;
+	}
+
+	return succeeded;
+}
+
+//Renders the bunny (--streaming-test) from memory and streamed from its treelet file with the pixel loop and the wavefront,
+//returns false when an image differs. The streamed mesh holds the same packed triangles, so the hits have to be the same
+bool RunStreamingTest(Timer* pTimer, Renderer* pRenderer)
+{
+	Scene_W4_StaticBunnyScene inMemoryScene{ Scene_W4_StaticBunnyScene::MeshStorage::InMemory };
+	Scene_W4_StaticBunnyScene streamedScene{ Scene_W4_StaticBunnyScene::MeshStorage::Streamed };
+	inMemoryScene.Initialize();
+	streamedScene.Initialize();
+
+	if (!streamedScene.HasStreamedMeshes() || streamedScene.GetStreamingStatistics().amountOfTreelets == 0)
+	{
+		std::cout << "Streaming test failed, the treelet file could not be written or opened" << std::endl;
+		return false;
+	}
+
+	inMemoryScene.Update(pTimer);
+	streamedScene.Update(pTimer);
+
+	bool succeeded{ true };
+	for (const bool wavefront : { false, true })
+	{
+		if (wavefront) pRenderer->ToggleWavefront();
+
+		const Renderer::ImageError error{ pRenderer->CompareScenes(&inMemoryScene, &streamedScene) };
+		std::cout << (wavefront ? "Wavefront" : "Pixel loop") << " streamed mesh error: max " << error.maxError << ", mean " << error.meanError << std::endl;
+		succeeded = error.maxError == 0 && succeeded;
+
+		if (wavefront) pRenderer->ToggleWavefront();
+	}
+
+	const StreamingStatistics streaming{ streamedScene.GetStreamingStatistics() };
+	std::cout << "Streaming test " << (succeeded ? "passed" : "failed") << ", " << streaming.amountOfTreelets << " treelets, misses "
+		<< streaming.cacheMisses << ", evictions " << streaming.evictions << std::endl;
+	return succeeded;
+}
+
+//Renders the bunny (--compression-test) with float and with compressed attributes with the pixel loop and the wavefront. Normals
+//are off by at most 0.005 degrees (a channel by at most 1) and positions by 1/131070 of the bounds, which only moves an edge across
+//a pixel center for a handful of pixels. Returns false when more than 1 in 10000 pixels are off by more than 1
+bool RunCompressionTest(Timer* pTimer, Renderer* pRenderer)
+{
+	Scene_W4_StaticBunnyScene inMemoryScene{ Scene_W4_StaticBunnyScene::MeshStorage::InMemory };
+	Scene_W4_StaticBunnyScene compressedScene{ Scene_W4_StaticBunnyScene::MeshStorage::Compressed };
+	inMemoryScene.Initialize();
+	compressedScene.Initialize();
+	inMemoryScene.Update(pTimer);
+	compressedScene.Update(pTimer);
+
+	const int maxEdgePixels{ pRenderer->GetWidth() * pRenderer->GetHeight() / 10000 };
+
+	bool succeeded{ true };
+	for (const bool wavefront : { false, true })
+	{
+		if (wavefront) pRenderer->ToggleWavefront();
+
+		const Renderer::ImageError error{ pRenderer->CompareScenes(&inMemoryScene, &compressedScene) };
+		std::cout << (wavefront ? "Wavefront" : "Pixel loop") << " compressed mesh error: max " << error.maxError << ", mean " << error.meanError
+			<< ", PSNR " << error.psnr << " dB, " << error.amountOfEdgePixels << " pixels off by more than 1" << std::endl;
+		succeeded = error.amountOfEdgePixels <= maxEdgePixels && succeeded;
+
+		if (wavefront) pRenderer->ToggleWavefront();
+	}
+
+	std::cout << "Compression test " << (succeeded ? "passed" : "failed") << ", at most " << maxEdgePixels << " pixels off by more than 1" << std::endl;
+	return succeeded;
+}
+
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	//--allocation-test renders a few frames and fails when the steady state ones allocate,
+	//--streaming-test fails when the streamed bunny renders differently from the one in memory,
+	//--compression-test when the compressed bunny is further off than its quantization allows
+	//--shadow-ray-threshold <value> sets the contribution below which shadow rays are skipped (F10 cycles it)
+	bool allocationTest{ false };
+	bool streamingTest{ false };
+	bool compressionTest{ false };
+	float shadowRayThreshold{ 0.f };
+	for (int argIndex{ 1 }; argIndex < argc; ++argIndex)
+	{
+		if (std::strcmp(args[argIndex], "--allocation-test") == 0) allocationTest = true;
+		if (std::strcmp(args[argIndex], "--streaming-test") == 0) streamingTest = true;
+		if (std::strcmp(args[argIndex], "--compression-test") == 0) compressionTest = true;
+		if (std::strcmp(args[argIndex], "--shadow-ray-threshold") == 0 && argIndex + 1 < argc) shadowRayThreshold = std::max(std::strtof(args[++argIndex], nullptr), 0.f);
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -41,10 +223,31 @@ int main(int argc, char* args[])
 	if (!pWindow)
 		return 1;
 
+	//Intersection, shading and pixel kernels are picked once for the cpu this runs on
+	std::cout << "Kernels: " << Kernels::ToString(Kernels::GetSelectedInstructionSet())
+		<< " (supported: " << Kernels::ToString(Kernels::GetSupportedInstructionSet()) << ")" << std::endl;
+
 	//Initialize "framework"
 	const auto pTimer = new Timer();
 	const auto pRenderer = new Renderer(pWindow);
+	pRenderer->SetShadowRayThreshold(shadowRayThreshold);
 	
+	if (allocationTest || streamingTest || compressionTest)
+	{
+		pTimer->Start();
+		bool succeeded{ true };
+		if (allocationTest) succeeded = RunAllocationTests(pTimer, pRenderer) && succeeded;
+		if (streamingTest) succeeded = RunStreamingTest(pTimer, pRenderer) && succeeded;
+		if (compressionTest) succeeded = RunCompressionTest(pTimer, pRenderer) && succeeded;
+		pTimer->Stop();
+
+		delete pRenderer;
+		delete pTimer;
+
+		ShutDown(pWindow);
+		return succeeded ? 0 : 1;
+	}
+
 	const auto pScene = new Scene_W4_ReferenceScene();
 	pScene->Initialize();
 
@@ -80,30 +283,76 @@ int main(int argc, char* args[])
 					pRenderer->CycleLightingMode();
 				}
 
+				if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+				{
+					pRenderer->ToggleWavefront();
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+				{
+					pRenderer->ToggleLightSampling();
+				}
+
 				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
 				{
 					pTimer->StartBenchmark();
 				}
 
+				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+				{
+					pRenderer->ToggleAccumulation();
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+				{
+					pRenderer->CycleShadingPrecision();
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+				{
+					const Renderer::ImageError fastError{ pRenderer->MeasureShadingError(pScene, ShadingPrecision::Fast) };
+					std::cout << "Fast shading error: max " << fastError.maxError << ", mean " << fastError.meanError << ", PSNR " << fastError.psnr << " dB" << std::endl;
+
+					const Renderer::ImageError tabulatedError{ pRenderer->MeasureShadingError(pScene, ShadingPrecision::Tabulated) };
+					std::cout << "Tabulated shading error: max " << tabulatedError.maxError << ", mean " << tabulatedError.meanError << ", PSNR " << tabulatedError.psnr << " dB" << std::endl;
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+				{
+					pRenderer->CycleShadowRayThreshold();
+					std::cout << "Shadow ray threshold: " << pRenderer->GetShadowRayThreshold() << std::endl;
+				}
+
 				break;
 			}
 
 			
 		}
 
-		//--------- Update ---------
-		pScene->Update(pTimer);
-
-		//--------- Render ---------
-		pRenderer->Render(pScene);
-
-		//--------- Timer ---------
-		pTimer->Update();
+		//--------- Update, Render and Timer ---------
+		const AllocationTracker::FrameReport allocations{ RunFrame(pTimer, pRenderer, pScene) };
 		printTimer += pTimer->GetElapsed();
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			std::cout << "dFPS: " << pTimer->GetdFPS();
+			if (pRenderer->IsShadowRayCullingEnabled()) std::cout << ", skipped shadow rays: " << pRenderer->GetSkippedShadowRays();
+			std::cout << std::endl;
+
+			//the last frame, input handling and printing are outside of it
+			if (allocations.total.allocations != 0)
+			{
+				std::cout << "Allocations last frame: " << allocations.total.allocations << " (" << allocations.total.bytes << " bytes)" << std::endl;
+				PrintAllocations(allocations);
+			}
+
+			if (pScene->HasStreamedMeshes())
+			{
+				const StreamingStatistics streaming{ pScene->GetStreamingStatistics() };
+				std::cout << "Streamed treelets: " << streaming.residentTreelets << "/" << streaming.amountOfTreelets << " resident ("
+					<< (streaming.residentBytes >> 20) << "/" << (streaming.memoryBudget >> 20) << " MB), hits " << streaming.cacheHits
+					<< ", misses " << streaming.cacheMisses << ", evictions " << streaming.evictions << ", paged in " << (streaming.pagedInBytes >> 20) << " MB" << std::endl;
+			}
 		}
 
 		//Save screenshot after full render